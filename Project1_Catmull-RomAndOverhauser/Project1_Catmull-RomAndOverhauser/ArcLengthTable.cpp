@@ -0,0 +1,254 @@
+/*
+ * ArcLengthTable.cpp
+ *
+ * Arc length along the curve of a CatmullRomSpline.
+ * See ArcLengthTable.h.
+ *
+ * Software is "as-is" and carries no warranty.  It may be used without
+ *   restriction, but if you modify it, please change the filenames to
+ *   prevent confusion between different versions.
+ */
+
+#include "ArcLengthTable.h"
+#include "CatmullRomSpline.h"
+#include "ThreadPool.h"
+
+#include <assert.h>
+#include <math.h>
+#include <algorithm>
+
+// Curves per block of the prefix sum.  Fixed, so that the sums do not depend
+//    on the number of threads.
+static const int BlockCurves = 4096;
+
+// A hinted search that has to move further than this many curves
+//    falls back to binary search.
+static const int HintSteps = 8;
+
+// Newton's method stops at this fraction of the length of the curve,
+//    or after MaxNewtonSteps steps.
+static const double NewtonTolerance = 1.0e-6;
+static const int MaxNewtonSteps = 6;
+
+// The 5-point Gauss-Legendre rule on [-1,1]: exact for polynomials of degree 9
+static const double GaussNodes[5] = { -0.9061798459386640, -0.5384693101056831, 0.0,
+									  0.5384693101056831, 0.9061798459386640 };
+static const double GaussWeights[5] = { 0.2369268850561891, 0.4786286704993665, 0.5688888888888889,
+										0.4786286704993665, 0.2369268850561891 };
+
+// The speed |B'(t)| of the Bezier curve with the control points cp
+static double speed( const float cp[8], double t )
+{
+	double s = 1.0 - t;
+	double a = s * s, b = 2.0 * s * t, c = t * t;
+	double dx = a * (cp[2] - cp[0]) + b * (cp[4] - cp[2]) + c * (cp[6] - cp[4]);
+	double dy = a * (cp[3] - cp[1]) + b * (cp[5] - cp[3]) + c * (cp[7] - cp[5]);
+	return 3.0 * sqrt(dx * dx + dy * dy);
+}
+
+// The length of the Bezier curve from t0 to t1
+static double integrateSpeed( const float cp[8], double t0, double t1 )
+{
+	double half = 0.5 * (t1 - t0);
+	double mid = 0.5 * (t0 + t1);
+	double sum = 0.0;
+	for (int k = 0; k < 5; k++) {
+		sum += GaussWeights[k] * speed(cp, mid + half * GaussNodes[k]);
+	}
+	return half * sum;
+}
+
+ArcLengthTable::ArcLengthTable()
+	: spline(nullptr), numCurves(0), curveStarts(1, 0.0)
+{
+}
+
+void ArcLengthTable::Clear()
+{
+	spline = nullptr;
+	numCurves = 0;
+	curveStarts.assign(1, 0.0);
+	subLengths.clear();
+}
+
+// Stores the lengths inside curve i, and returns its length
+double ArcLengthTable::measureCurve( int i )
+{
+	float cp[8];
+	spline->SegmentControlPoints(i, cp);
+	double length = 0.0;
+	for (int k = 0; k < SubIntervals; k++) {
+		length += integrateSpeed(cp, (double)k / SubIntervals, (double)(k + 1) / SubIntervals);
+		subLengths[SubIntervals * i + k] = (float)length;
+	}
+	return length;
+}
+
+// The first pass of the prefix sum: curveStarts[i+1] is set to the distance from
+//    the start of the block of curve i to the end of curve i.
+void ArcLengthTable::measureBlocks( int firstBlock, int endBlock, std::vector<double>& blockLengths )
+{
+	for (int b = firstBlock; b < endBlock; b++) {
+		int end = Min((b + 1) * BlockCurves, numCurves);
+		double sum = 0.0;
+		for (int i = b * BlockCurves; i < end; i++) {
+			sum += measureCurve(i);
+			curveStarts[i + 1] = sum;
+		}
+		blockLengths[b] = sum;
+	}
+}
+
+void ArcLengthTable::Build( const CatmullRomSpline& theSpline )
+{
+	spline = &theSpline;
+	numCurves = Max(spline->NumDots() - 1, 0);
+	curveStarts.assign(numCurves + 1, 0.0);
+	subLengths.resize(SubIntervals * numCurves);
+
+	int numBlocks = (numCurves + BlockCurves - 1) / BlockCurves;
+	std::vector<double> blockLengths(numBlocks);
+	ThreadPool* threads = spline->Threads();
+	if (threads == nullptr || numBlocks <= 1) {
+		measureBlocks(0, numBlocks, blockLengths);
+	}
+	else {
+		threads->ParallelFor(0, numBlocks, 1, [this, &blockLengths]( int first, int end ) {
+			measureBlocks(first, end, blockLengths);
+		});
+	}
+
+	// The start of each block is the sum of the lengths of the blocks before it.
+	//    The second pass adds it to the distances in the block.
+	std::vector<double> blockStarts(numBlocks);
+	double sum = 0.0;
+	for (int b = 0; b < numBlocks; b++) {
+		blockStarts[b] = sum;
+		sum += blockLengths[b];
+	}
+	auto addBlockStarts = [this, &blockStarts]( int firstBlock, int endBlock ) {
+		for (int b = firstBlock; b < endBlock; b++) {
+			int end = Min((b + 1) * BlockCurves, numCurves);
+			for (int i = b * BlockCurves; i < end; i++) {
+				curveStarts[i + 1] += blockStarts[b];
+			}
+		}
+	};
+	if (threads == nullptr || numBlocks <= 2) {
+		addBlockStarts(1, numBlocks);
+	}
+	else {
+		threads->ParallelFor(1, numBlocks, 1, addBlockStarts);
+	}
+}
+
+ArcLengthTable::Location ArcLengthTable::Find( double distance ) const
+{
+	if (numCurves == 0) {
+		Location start = { 0, 0.0f };
+		return start;
+	}
+	// The last curve that starts at or before distance
+	int i = (int)(std::upper_bound(curveStarts.begin(), curveStarts.begin() + numCurves, distance)
+				  - curveStarts.begin()) - 1;
+	return findInCurve(Max(i, 0), distance);
+}
+
+ArcLengthTable::Location ArcLengthTable::Find( double distance, Location hint ) const
+{
+	if (numCurves == 0) {
+		return Find(distance);
+	}
+	int i = Min(Max(hint.curve, 0), numCurves - 1);
+	for (int steps = 0; i + 1 < numCurves && curveStarts[i + 1] <= distance; steps++) {
+		if (steps == HintSteps) {
+			return Find(distance);
+		}
+		i++;
+	}
+	for (int steps = 0; i > 0 && curveStarts[i] > distance; steps++) {
+		if (steps == HintSteps) {
+			return Find(distance);
+		}
+		i--;
+	}
+	return findInCurve(i, distance);
+}
+
+// Finds t in curve i.  The table brackets t in one of the SubIntervals parts
+//    of the curve, and Newton's method, kept inside the bracket, solves
+//    length(t) = distance there.
+ArcLengthTable::Location ArcLengthTable::findInCurve( int i, double distance ) const
+{
+	const float* lengths = &subLengths[SubIntervals * i];
+	double s = Min(Max(distance - curveStarts[i], 0.0), (double)lengths[SubIntervals - 1]);
+	int k = 0;
+	while (k < SubIntervals - 1 && lengths[k] < s) {
+		k++;
+	}
+	double s0 = (k > 0) ? lengths[k - 1] : 0.0;
+	double lo = (double)k / SubIntervals;
+	double hi = (double)(k + 1) / SubIntervals;
+	Location where = { i, (float)lo };
+	if (lengths[k] <= s0) {
+		return where;					// The curve does not move here
+	}
+
+	float cp[8];
+	spline->SegmentControlPoints(i, cp);
+	double t0 = lo;
+	double t = lo + (hi - lo) * (s - s0) / (lengths[k] - s0);
+	double tolerance = NewtonTolerance * lengths[SubIntervals - 1];
+	for (int step = 0; step < MaxNewtonSteps; step++) {
+		double error = s0 + integrateSpeed(cp, t0, t) - s;
+		if (fabs(error) <= tolerance) {
+			break;
+		}
+		if (error > 0.0) {
+			hi = t;
+		}
+		else {
+			lo = t;
+		}
+		double v = speed(cp, t);
+		double next = (v > 0.0) ? t - error / v : lo;
+		t = (next > lo && next < hi) ? next : 0.5 * (lo + hi);
+	}
+	where.t = (float)t;
+	return where;
+}
+
+void ArcLengthTable::PointAt( Location where, float xy[2] ) const
+{
+	spline->Evaluate(&where, 1, xy, nullptr, nullptr);
+}
+
+int ArcLengthTable::Resample( double spacing, std::vector<float>& points ) const
+{
+	assert( spacing > 0.0 );
+	if (numCurves == 0) {
+		if (spline != nullptr && spline->NumDots() == 1) {
+			points.insert(points.end(), spline->Dot(0), spline->Dot(0) + 2);
+			return 1;
+		}
+		return 0;
+	}
+	double length = Length();
+	long long numSteps = (long long)(length / spacing);
+	size_t first = points.size();
+	points.reserve(first + 2 * (numSteps + 2));
+	Location where = { 0, 0.0f };
+	float xy[2];
+	for (long long j = 0; j <= numSteps; j++) {
+		where = Find(j * spacing, where);
+		PointAt(where, xy);
+		points.push_back(xy[0]);
+		points.push_back(xy[1]);
+	}
+	if (numSteps * spacing < length) {
+		const float* end = spline->Dot(numCurves);
+		points.push_back(end[0]);
+		points.push_back(end[1]);
+	}
+	return (int)((points.size() - first) / 2);
+}
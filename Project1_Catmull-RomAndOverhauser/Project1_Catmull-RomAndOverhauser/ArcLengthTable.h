@@ -0,0 +1,80 @@
+/*
+ * ArcLengthTable.h
+ *
+ * Arc length along the curve of a CatmullRomSpline, for moving along the
+ * curve at constant speed.
+ *
+ * The points that the spline stores on each Bezier curve are uniform in the
+ * parameter t, so their spacing follows the speed of the curve.  The table
+ * keeps the distance along the curve to the start of each Bezier curve, and
+ * to SubIntervals points inside each curve, and maps a distance back to a
+ * curve and a parameter t.  The lengths are computed by Gauss-Legendre
+ * quadrature of the speed of the curve, from its control points.  In the
+ * Polyline mode the "curves" are the line segments between the dots.
+ *
+ * The lengths of the curves are computed in blocks of a fixed number of
+ * curves, and summed with a prefix sum over the blocks, on the threads of
+ * the spline (see CatmullRomSpline::SetThreadCount).  The results do not
+ * depend on the number of threads.
+ *
+ * The table refers to the spline it was built from, and must be built again
+ * after the spline changes.
+ *
+ * Software is "as-is" and carries no warranty.  It may be used without
+ *   restriction, but if you modify it, please change the filenames to
+ *   prevent confusion between different versions.
+ */
+
+#ifndef ARC_LENGTH_TABLE_H
+#define ARC_LENGTH_TABLE_H
+
+#include <vector>
+#include "CatmullRomSpline.h"
+
+class ArcLengthTable {
+
+public:
+	// A point on the curve, which CatmullRomSpline::Evaluate takes as it is
+	typedef CatmullRomSpline::CurveParameter Location;
+
+	static const int SubIntervals = 8;		// Lengths kept inside each curve
+
+public:
+	ArcLengthTable();
+
+	void Build( const CatmullRomSpline& spline );
+	void Clear();
+
+	int NumCurves() const { return numCurves; }
+	double Length() const { return curveStarts.back(); }
+	double CurveStart( int i ) const { return curveStarts[i]; }	// CurveStart(NumCurves()) is Length()
+
+	// The point at the given distance from the start of the curve, which is
+	//    clamped to [0, Length()].  Takes O(log NumCurves()) time.
+	Location Find( double distance ) const;
+
+	// The same, starting the search from hint, usually the previous result.
+	//    Takes O(1) time when the distance is in or near the curve of hint, as
+	//    for a sequence of increasing distances.
+	Location Find( double distance, Location hint ) const;
+
+	void PointAt( Location where, float xy[2] ) const;
+
+	// Appends the points at distances 0, spacing, 2*spacing, ... along the curve
+	//    to points, as (x,y) pairs, and then the end of the curve if it is not
+	//    the last of those.  Returns the number of points appended.
+	int Resample( double spacing, std::vector<float>& points ) const;
+
+private:
+	double measureCurve( int i );
+	void measureBlocks( int firstBlock, int endBlock, std::vector<double>& blockLengths );
+	Location findInCurve( int i, double distance ) const;
+
+private:
+	const CatmullRomSpline* spline;
+	int numCurves;
+	std::vector<double> curveStarts;		// numCurves+1 distances
+	std::vector<float> subLengths;			// Distance from the start of curve i to t = (k+1)/SubIntervals
+};
+
+#endif	// ARC_LENGTH_TABLE_H
@@ -0,0 +1,215 @@
+/*
+ * BezierSimd.cpp
+ *
+ * Batch tessellation of cubic Bezier curves, with AVX, SSE2 and NEON
+ * versions and a portable fallback.  See BezierSimd.h.
+ *
+ * Software is "as-is" and carries no warranty.  It may be used without
+ *   restriction, but if you modify it, please change the filenames to
+ *   prevent confusion between different versions.
+ */
+
+#include "BezierSimd.h"
+
+#if defined(BEZIER_SIMD_AVX)
+#include <immintrin.h>
+#elif defined(BEZIER_SIMD_SSE2)
+#include <emmintrin.h>
+#elif defined(BEZIER_SIMD_NEON)
+#include <arm_neon.h>
+#endif
+
+#if defined(BEZIER_SIMD_AVX)
+const int BezierSimdWidth = 8;
+const char* const BezierSimdName = "AVX";
+#elif defined(BEZIER_SIMD_SSE2) || defined(BEZIER_SIMD_NEON)
+const int BezierSimdWidth = 4;
+#if defined(BEZIER_SIMD_SSE2)
+const char* const BezierSimdName = "SSE2";
+#else
+const char* const BezierSimdName = "NEON";
+#endif
+#else
+const int BezierSimdWidth = 1;
+const char* const BezierSimdName = "scalar";
+#endif
+
+void BezierBernsteinWeights( int numPoints, float* weights )
+{
+	for (int j = 0; j < numPoints; j++) {
+		double t = (double)j / numPoints;
+		double s = 1.0 - t;
+		weights[j] = (float)(s * s * s);
+		weights[numPoints + j] = (float)(3.0 * s * s * t);
+		weights[2 * numPoints + j] = (float)(3.0 * s * t * t);
+		weights[3 * numPoints + j] = (float)(t * t * t);
+	}
+}
+
+// The vector code computes points j, ..., j+3 (or j+7 with AVX) at once, with
+//    one vector for their x's and one for their y's, and stores them as
+//    (x,y) pairs.  The control point coordinates are broadcast into vectors
+//    once per curve.
+#if defined(BEZIER_SIMD_AVX) || defined(BEZIER_SIMD_SSE2)
+static inline int evaluateSse( const float cp[8], const float* weights, int numPoints, int j, float* points )
+{
+	const float* w0 = weights;
+	const float* w1 = weights + numPoints;
+	const float* w2 = weights + 2 * numPoints;
+	const float* w3 = weights + 3 * numPoints;
+	__m128 x0 = _mm_set1_ps(cp[0]), y0 = _mm_set1_ps(cp[1]);
+	__m128 x1 = _mm_set1_ps(cp[2]), y1 = _mm_set1_ps(cp[3]);
+	__m128 x2 = _mm_set1_ps(cp[4]), y2 = _mm_set1_ps(cp[5]);
+	__m128 x3 = _mm_set1_ps(cp[6]), y3 = _mm_set1_ps(cp[7]);
+	for ( ; j + 4 <= numPoints; j += 4) {
+		__m128 w = _mm_loadu_ps(w0 + j);
+		__m128 x = _mm_mul_ps(w, x0);
+		__m128 y = _mm_mul_ps(w, y0);
+		w = _mm_loadu_ps(w1 + j);
+		x = _mm_add_ps(x, _mm_mul_ps(w, x1));
+		y = _mm_add_ps(y, _mm_mul_ps(w, y1));
+		w = _mm_loadu_ps(w2 + j);
+		x = _mm_add_ps(x, _mm_mul_ps(w, x2));
+		y = _mm_add_ps(y, _mm_mul_ps(w, y2));
+		w = _mm_loadu_ps(w3 + j);
+		x = _mm_add_ps(x, _mm_mul_ps(w, x3));
+		y = _mm_add_ps(y, _mm_mul_ps(w, y3));
+		_mm_storeu_ps(points + 2 * j, _mm_unpacklo_ps(x, y));
+		_mm_storeu_ps(points + 2 * j + 4, _mm_unpackhi_ps(x, y));
+	}
+	return j;
+}
+#endif
+
+#if defined(BEZIER_SIMD_AVX)
+static inline int evaluateVector( const float cp[8], const float* weights, int numPoints, float* points )
+{
+	const float* w0 = weights;
+	const float* w1 = weights + numPoints;
+	const float* w2 = weights + 2 * numPoints;
+	const float* w3 = weights + 3 * numPoints;
+	__m256 x0 = _mm256_set1_ps(cp[0]), y0 = _mm256_set1_ps(cp[1]);
+	__m256 x1 = _mm256_set1_ps(cp[2]), y1 = _mm256_set1_ps(cp[3]);
+	__m256 x2 = _mm256_set1_ps(cp[4]), y2 = _mm256_set1_ps(cp[5]);
+	__m256 x3 = _mm256_set1_ps(cp[6]), y3 = _mm256_set1_ps(cp[7]);
+	int j = 0;
+	for ( ; j + 8 <= numPoints; j += 8) {
+		__m256 w = _mm256_loadu_ps(w0 + j);
+		__m256 x = _mm256_mul_ps(w, x0);
+		__m256 y = _mm256_mul_ps(w, y0);
+		w = _mm256_loadu_ps(w1 + j);
+		x = _mm256_add_ps(x, _mm256_mul_ps(w, x1));
+		y = _mm256_add_ps(y, _mm256_mul_ps(w, y1));
+		w = _mm256_loadu_ps(w2 + j);
+		x = _mm256_add_ps(x, _mm256_mul_ps(w, x2));
+		y = _mm256_add_ps(y, _mm256_mul_ps(w, y2));
+		w = _mm256_loadu_ps(w3 + j);
+		x = _mm256_add_ps(x, _mm256_mul_ps(w, x3));
+		y = _mm256_add_ps(y, _mm256_mul_ps(w, y3));
+		// The unpacks interleave within each 128-bit half: lo = points 0,1,4,5 and hi = points 2,3,6,7
+		__m256 lo = _mm256_unpacklo_ps(x, y);
+		__m256 hi = _mm256_unpackhi_ps(x, y);
+		_mm256_storeu_ps(points + 2 * j, _mm256_permute2f128_ps(lo, hi, 0x20));
+		_mm256_storeu_ps(points + 2 * j + 8, _mm256_permute2f128_ps(lo, hi, 0x31));
+	}
+	return evaluateSse(cp, weights, numPoints, j, points);	// Four more points, if there are
+}
+#elif defined(BEZIER_SIMD_SSE2)
+static inline int evaluateVector( const float cp[8], const float* weights, int numPoints, float* points )
+{
+	return evaluateSse(cp, weights, numPoints, 0, points);
+}
+#elif defined(BEZIER_SIMD_NEON)
+static inline int evaluateVector( const float cp[8], const float* weights, int numPoints, float* points )
+{
+	int j = 0;
+	for ( ; j + 4 <= numPoints; j += 4) {
+		float32x4_t w = vld1q_f32(weights + j);
+		float32x4x2_t xy;
+		xy.val[0] = vmulq_n_f32(w, cp[0]);
+		xy.val[1] = vmulq_n_f32(w, cp[1]);
+		w = vld1q_f32(weights + numPoints + j);
+		xy.val[0] = vaddq_f32(xy.val[0], vmulq_n_f32(w, cp[2]));
+		xy.val[1] = vaddq_f32(xy.val[1], vmulq_n_f32(w, cp[3]));
+		w = vld1q_f32(weights + 2 * numPoints + j);
+		xy.val[0] = vaddq_f32(xy.val[0], vmulq_n_f32(w, cp[4]));
+		xy.val[1] = vaddq_f32(xy.val[1], vmulq_n_f32(w, cp[5]));
+		w = vld1q_f32(weights + 3 * numPoints + j);
+		xy.val[0] = vaddq_f32(xy.val[0], vmulq_n_f32(w, cp[6]));
+		xy.val[1] = vaddq_f32(xy.val[1], vmulq_n_f32(w, cp[7]));
+		vst2q_f32(points + 2 * j, xy);		// Stores interleaved (x,y) pairs
+	}
+	return j;
+}
+#endif
+
+// The same sum of products as the vector code, one point at a time
+static inline void evaluateScalar( const float cp[8], const float* weights, int numPoints, int j, float* points )
+{
+	float w = weights[j];
+	float x = w * cp[0];
+	float y = w * cp[1];
+	for (int k = 1; k < 4; k++) {
+		w = weights[k * numPoints + j];
+		x = x + w * cp[2 * k];
+		y = y + w * cp[2 * k + 1];
+	}
+	points[2 * j] = x;
+	points[2 * j + 1] = y;
+}
+
+// Inlined into BezierEvaluate and into each BezierEvaluateFixed, where
+//    numPoints is a constant and the loops can be unrolled.
+static inline void evaluate( const float cp[8], const float* weights, int numPoints, float* points )
+{
+	int j = 0;
+#if defined(BEZIER_SIMD_AVX) || defined(BEZIER_SIMD_SSE2) || defined(BEZIER_SIMD_NEON)
+	j = evaluateVector(cp, weights, numPoints, points);
+#endif
+	for ( ; j < numPoints; j++) {	// The points left over
+		evaluateScalar(cp, weights, numPoints, j, points);
+	}
+}
+
+// The loop over the curves is inside the kernel, so that each curve costs no call
+//    and, in BezierEvaluateFixed, the weights are addressed as constants.
+void BezierEvaluate( const float* cp, int numCurves, const float* weights, int numPoints, float* points )
+{
+	for (int c = 0; c < numCurves; c++) {
+		evaluate(cp + 6 * c, weights, numPoints, points + 2 * numPoints * c);
+	}
+}
+
+template<int NumPoints> void BezierEvaluateFixed( const float* cp, int numCurves, float* points )
+{
+	static constexpr BernsteinWeights<NumPoints> table;
+	for (int c = 0; c < numCurves; c++) {
+		evaluate(cp + 6 * c, table.weights, NumPoints, points + 2 * NumPoints * c);
+	}
+}
+
+static_assert( BernsteinWeights<20>().weights[0] == 1.0f, "The Bernstein weights are computed at compile time" );
+
+template void BezierEvaluateFixed<8>( const float* cp, int numCurves, float* points );
+template void BezierEvaluateFixed<16>( const float* cp, int numCurves, float* points );
+template void BezierEvaluateFixed<20>( const float* cp, int numCurves, float* points );
+template void BezierEvaluateFixed<32>( const float* cp, int numCurves, float* points );
+template void BezierEvaluateFixed<64>( const float* cp, int numCurves, float* points );
+
+BezierEvaluator BezierFixedEvaluator( int numPoints )
+{
+	switch (numPoints) {
+	case 8:
+		return BezierEvaluateFixed<8>;
+	case 16:
+		return BezierEvaluateFixed<16>;
+	case 20:
+		return BezierEvaluateFixed<20>;
+	case 32:
+		return BezierEvaluateFixed<32>;
+	case 64:
+		return BezierEvaluateFixed<64>;
+	default:
+		return nullptr;
+	}
+}
@@ -0,0 +1,81 @@
+/*
+ * BezierSimd.h
+ *
+ * Batch tessellation of cubic Bezier curves for the CatmullRomSpline engine.
+ *
+ * A curve is evaluated at numPoints parameter values t = j/numPoints,
+ * j = 0, ..., numPoints-1, as the sum of its four control points weighted
+ * by the Bernstein polynomials.  The weights are kept in a table laid out
+ * one weight per row ("structure of arrays"), so that the points for
+ * BezierSimdWidth consecutive parameter values are computed with a few
+ * vector multiply-adds.  The vector code uses AVX (8 floats), SSE2 or NEON
+ * (4 floats) when the compiler targets them, with a portable scalar fallback.
+ *
+ * Each call evaluates a run of consecutive curves, read straight from the
+ * control point array of the spline and stored straight into its array of
+ * points on the curve.  Vectorizing across the curves instead, four curves
+ * per vector, gives the same results but was about 1.5 times slower with
+ * SSE2: the points must then be transposed back into (x,y) pairs.
+ *
+ * For the common numbers of points (8, 16, 20, 32 and 64) the weights are
+ * constexpr tables, built by the compiler, and the evaluator is compiled for
+ * that number of points.  Other numbers of points use a table computed at
+ * run time.
+ *
+ * Software is "as-is" and carries no warranty.  It may be used without
+ *   restriction, but if you modify it, please change the filenames to
+ *   prevent confusion between different versions.
+ */
+
+#ifndef BEZIER_SIMD_H
+#define BEZIER_SIMD_H
+
+#if defined(__AVX__)
+#define BEZIER_SIMD_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BEZIER_SIMD_SSE2
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#define BEZIER_SIMD_NEON
+#endif
+
+extern const int BezierSimdWidth;		// Floats per vector instruction; 1 for the scalar fallback
+extern const char* const BezierSimdName;	// "AVX", "SSE2", "NEON" or "scalar"
+
+// Fills weights[k*numPoints + j] with the k-th Bernstein weight at t = j/numPoints,
+//    for k = 0, ..., 3.  The table has 4*numPoints floats.
+void BezierBernsteinWeights( int numPoints, float* weights );
+
+// Stores numPoints points of each of numCurves consecutive Bezier curves, as (x,y)
+//    pairs.  Consecutive curves share an end point, as in the control point array
+//    of CatmullRomSpline: curve c has the control points (cp[6c],cp[6c+1]), ...,
+//    (cp[6c+6],cp[6c+7]), and its points start at points + 2*numPoints*c.
+//    weights is a table from BezierBernsteinWeights for the same numPoints.
+void BezierEvaluate( const float* cp, int numCurves, const float* weights, int numPoints, float* points );
+
+// The same table as BezierBernsteinWeights, computed at compile time
+template<int NumPoints> struct BernsteinWeights {
+	float weights[4 * NumPoints];
+
+	constexpr BernsteinWeights() : weights()
+	{
+		for (int j = 0; j < NumPoints; j++) {
+			double t = (double)j / NumPoints;
+			double s = 1.0 - t;
+			weights[j] = (float)(s * s * s);
+			weights[NumPoints + j] = (float)(3.0 * s * s * t);
+			weights[2 * NumPoints + j] = (float)(3.0 * s * t * t);
+			weights[3 * NumPoints + j] = (float)(t * t * t);
+		}
+	}
+};
+
+// BezierEvaluate for a fixed number of points, with a constexpr table of weights.
+//    Instantiated for 8, 16, 20, 32 and 64 points.
+template<int NumPoints> void BezierEvaluateFixed( const float* cp, int numCurves, float* points );
+
+typedef void (*BezierEvaluator)( const float* cp, int numCurves, float* points );
+
+// The instance of BezierEvaluateFixed for numPoints, or nullptr if there is none.
+BezierEvaluator BezierFixedEvaluator( int numPoints );
+
+#endif	// BEZIER_SIMD_H
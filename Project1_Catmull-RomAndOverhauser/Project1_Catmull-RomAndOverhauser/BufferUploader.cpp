@@ -0,0 +1,167 @@
+/*
+ * BufferUploader.cpp
+ *
+ * Loads changed ranges of an array into an OpenGL vertex buffer.
+ * See BufferUploader.h.
+ *
+ * Software is "as-is" and carries no warranty.  It may be used without
+ *   restriction, but if you modify it, please change the filenames to
+ *   prevent confusion between different versions.
+ */
+
+// Use the static library (so glew32.dll is not needed):
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+#include <assert.h>
+#include <string.h>
+#include <algorithm>
+#include <utility>
+
+#include "BufferUploader.h"
+
+bool check_for_opengl_errors();
+
+// The storage flags of a persistently mapped buffer that is only written by the CPU
+static const GLbitfield PersistentFlags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+// glClientWaitSync waits this long, in nanoseconds, before checking again
+static const GLuint64 FenceTimeout = 1000000000;
+
+BufferUploader::BufferUploader()
+	: buffer(0), size(0), mapping(nullptr), frameFence(nullptr)
+{
+	memset(&stats, 0, sizeof(stats));
+}
+
+bool BufferUploader::HasBufferStorage()
+{
+	return GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage;
+}
+
+void BufferUploader::Allocate( size_t numBytes )
+{
+	if (HasBufferStorage()) {
+		// Storage made by glBufferStorage cannot be resized, so each size is a new buffer
+		Release();
+		glGenBuffers(1, &buffer);
+		glBindBuffer(GL_ARRAY_BUFFER, buffer);
+		GLsizeiptr storageBytes = (GLsizeiptr)std::max(numBytes, (size_t)1);	// Must not be empty
+		glBufferStorage(GL_ARRAY_BUFFER, storageBytes, (void*)0, PersistentFlags);
+		mapping = (char*)glMapBufferRange(GL_ARRAY_BUFFER, 0, storageBytes, PersistentFlags);
+	}
+	else {
+		if (buffer == 0) {
+			glGenBuffers(1, &buffer);
+		}
+		glBindBuffer(GL_ARRAY_BUFFER, buffer);
+		glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)numBytes, (void*)0, GL_DYNAMIC_DRAW);
+	}
+	size = numBytes;
+	pending.clear();
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	check_for_opengl_errors();
+}
+
+void BufferUploader::Release()
+{
+	if (frameFence != nullptr) {
+		glDeleteSync((GLsync)frameFence);
+		frameFence = nullptr;
+	}
+	if (buffer != 0) {
+		glDeleteBuffers(1, &buffer);		// Also unmaps it
+		buffer = 0;
+	}
+	mapping = nullptr;
+	size = 0;
+	pending.clear();
+}
+
+void BufferUploader::Write( size_t offset, size_t numBytes, const void* data )
+{
+	assert( offset + numBytes <= size );
+	if (numBytes > 0) {
+		PendingWrite write = { offset, numBytes, data };
+		pending.push_back(write);
+	}
+}
+
+void BufferUploader::Flush()
+{
+	if (pending.empty()) {
+		return;
+	}
+	if (mapping != nullptr) {
+		waitForFrame();
+		for (const PendingWrite& write : pending) {
+			memcpy(mapping + write.offset, write.data, write.numBytes);
+		}
+	}
+	else {
+		glBindBuffer(GL_ARRAY_BUFFER, buffer);
+		if (coversBuffer()) {
+			glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)size, (void*)0, GL_DYNAMIC_DRAW);
+			stats.orphans++;
+		}
+		for (const PendingWrite& write : pending) {
+			glBufferSubData(GL_ARRAY_BUFFER, (GLintptr)write.offset, (GLsizeiptr)write.numBytes, write.data);
+		}
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		check_for_opengl_errors();
+	}
+	for (const PendingWrite& write : pending) {
+		stats.bytes += write.numBytes;
+	}
+	stats.writes += (int)pending.size();
+	pending.clear();
+}
+
+BufferUploader::Stats BufferUploader::EndFrame()
+{
+	if (mapping != nullptr) {
+		if (frameFence != nullptr) {
+			glDeleteSync((GLsync)frameFence);
+		}
+		frameFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+	Stats frame = stats;
+	memset(&stats, 0, sizeof(stats));
+	return frame;
+}
+
+// Waits until the GPU has finished the draws of the last frame, which may read
+//    the parts of the mapping about to be written.
+void BufferUploader::waitForFrame()
+{
+	if (frameFence == nullptr) {
+		return;
+	}
+	GLenum status = glClientWaitSync((GLsync)frameFence, 0, 0);
+	if (status == GL_TIMEOUT_EXPIRED) {
+		stats.waits++;
+		do {
+			status = glClientWaitSync((GLsync)frameFence, GL_SYNC_FLUSH_COMMANDS_BIT, FenceTimeout);
+		} while (status == GL_TIMEOUT_EXPIRED);
+	}
+	glDeleteSync((GLsync)frameFence);
+	frameFence = nullptr;
+}
+
+// True if the pending writes together cover the whole buffer
+bool BufferUploader::coversBuffer() const
+{
+	std::vector<std::pair<size_t, size_t>> ranges;
+	for (const PendingWrite& write : pending) {
+		ranges.push_back(std::make_pair(write.offset, write.offset + write.numBytes));
+	}
+	std::sort(ranges.begin(), ranges.end());
+	size_t covered = 0;
+	for (const std::pair<size_t, size_t>& range : ranges) {
+		if (range.first > covered) {
+			return false;
+		}
+		covered = std::max(covered, range.second);
+	}
+	return covered >= size;
+}
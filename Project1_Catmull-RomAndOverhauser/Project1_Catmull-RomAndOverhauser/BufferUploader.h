@@ -0,0 +1,84 @@
+/*
+ * BufferUploader.h
+ *
+ * Loads changed ranges of an array into an OpenGL vertex buffer.  When the
+ * context has glBufferStorage (OpenGL 4.4 or ARB_buffer_storage), the buffer
+ * is created once with persistently mapped, coherent storage, and Flush()
+ * copies each changed range straight into the mapping, with no call into the
+ * driver and no staging copy inside it.  The GPU may still be reading the
+ * buffer for the last frame, so EndFrame() places a fence after the frame's
+ * draws and the first Flush() after it waits for that fence.
+ *
+ * Without buffer storage the buffer is a GL_DYNAMIC_DRAW buffer.  When the
+ * writes pending at a Flush() cover the whole buffer it is orphaned, so that
+ * the driver gives it new memory instead of waiting for the GPU, and smaller
+ * writes use glBufferSubData.
+ *
+ * EndFrame() also returns the number of bytes loaded since the last frame.
+ *
+ * Software is "as-is" and carries no warranty.  It may be used without
+ *   restriction, but if you modify it, please change the filenames to
+ *   prevent confusion between different versions.
+ */
+
+#ifndef BUFFER_UPLOADER_H
+#define BUFFER_UPLOADER_H
+
+#include <stddef.h>
+#include <vector>
+
+class BufferUploader {
+
+public:
+	// What was loaded into the buffer during a frame
+	struct Stats {
+		size_t bytes;
+		int writes;
+		int orphans;			// Times the whole buffer was given new storage
+		int waits;				// Times a Flush() waited for the GPU to finish a frame
+	};
+
+public:
+	BufferUploader();
+
+	// True if the current context can make persistently mapped buffers
+	static bool HasBufferStorage();
+
+	// Makes room for numBytes.  The contents are undefined until they are written
+	//    again, and the buffer object may be a new one, so Buffer() must be attached
+	//    to the vertex arrays again.  Needs a current context.
+	void Allocate( size_t numBytes );
+	void Release();
+	unsigned int Buffer() const { return buffer; }
+	size_t Size() const { return size; }
+	bool Persistent() const { return mapping != nullptr; }
+
+	// Copies numBytes from data to offset in the buffer at the next Flush().  The data
+	//    must not change before then.
+	void Write( size_t offset, size_t numBytes, const void* data );
+	void Flush();
+
+	// Call after the last draw of each frame that reads the buffer.  Returns what was
+	//    loaded since the last call.
+	Stats EndFrame();
+
+private:
+	struct PendingWrite {
+		size_t offset;
+		size_t numBytes;
+		const void* data;
+	};
+
+	void waitForFrame();
+	bool coversBuffer() const;
+
+private:
+	unsigned int buffer;
+	size_t size;
+	char* mapping;					// The persistent mapping, or nullptr
+	void* frameFence;				// The GLsync after the last frame's draws, or nullptr
+	std::vector<PendingWrite> pending;
+	Stats stats;
+};
+
+#endif	// BUFFER_UPLOADER_H
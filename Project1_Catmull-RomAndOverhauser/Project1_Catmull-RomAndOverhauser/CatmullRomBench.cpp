@@ -0,0 +1,339 @@
+/*
+ * CatmullRomBench.cpp
+ *
+ * Benchmarks of the CatmullRomSpline engine.  Each benchmark times an
+ * optimization of the engine against the code it replaced, or against the
+ * other choices, and prints the best of several runs.
+ *
+ * Usage: CatmullRomBench [name ...]
+ * Runs the named benchmarks, in the order given, or all of them.  The names are:
+ *     tessellation    de Casteljau against forward differencing
+ *     batch           de Casteljau against the batch Bernstein kernel, on 10^6 curves
+ *     transforms      the batch transforms of LinearR2.h against a loop over VectorR2's
+ *     threads         recomputing 10^6 dots with 1, 2, ... threads, up to one per core
+ *     intersections   crossings of splines with 10^4 and 10^5 segments
+ *
+ * Time the Release configuration: the Debug timings mean little.
+ *
+ * Software is "as-is" and carries no warranty.  It may be used without
+ *   restriction, but if you modify it, please change the filenames to
+ *   prevent confusion between different versions.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+#include "BezierSimd.h"
+#include "CatmullRomSpline.h"
+#include "CurveIntersection.h"
+#include "ThreadPool.h"
+
+// The best time, in milliseconds, of numRuns calls of run()
+template<class Run> double BestTime( int numRuns, Run run )
+{
+	double best = 0.0;
+	for (int k = 0; k < numRuns; k++) {
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		run();
+		double time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		best = (k == 0) ? time : std::min(best, time);
+	}
+	return best;
+}
+
+// Adds numDots random dots, with coordinates in [0,1000].  The same seed gives the same dots.
+void AddRandomDots( CatmullRomSpline& spline, int numDots, unsigned seed )
+{
+	std::mt19937 random(seed);
+	std::uniform_real_distribution<float> coordinate(0.0f, 1000.0f);
+	spline.Reserve(spline.NumDots() + numDots);
+	for (int n = 0; n < numDots; n++) {
+		float x = coordinate(random);
+		spline.AddPoint(x, coordinate(random));
+	}
+}
+
+// The largest difference between the coordinates of the points on the curves of two
+//    splines with the same dots and the same number of points on each curve
+float LargestDifference( const CatmullRomSpline& a, const CatmullRomSpline& b )
+{
+	float largest = 0.0f;
+	for (int i = 0; i < a.NumDots() - 1; i++) {
+		const float* p = a.CurvePoints(i);
+		const float* q = b.CurvePoints(i);
+		for (int j = 0; j < 2 * a.SegmentPointCount(i); j++) {
+			largest = std::max(largest, fabsf(p[j] - q[j]));
+		}
+	}
+	return largest;
+}
+
+// Recomputes centripetal curves with de Casteljau's algorithm and with forward
+//    differencing.  The time includes the control points, which both share.
+void BenchTessellation()
+{
+	const int numDots[] = { 100000, 1000 };
+	const int meshRes[] = { 20, 4096 };
+	printf("Tessellation, best of 5 recomputes of centripetal curves:\n");
+	for (int k = 0; k < 2; k++) {
+		CatmullRomSpline splines[2];
+		double times[2];
+		for (int t = 0; t < 2; t++) {
+			splines[t].SetMeshResolution(meshRes[k]);
+			AddRandomDots(splines[t], numDots[k], 1);
+			splines[t].SetTessellation(t == 0 ? CatmullRomSpline::DeCasteljau : CatmullRomSpline::ForwardDifferencing);
+			splines[t].SetMode(CatmullRomSpline::Centripetal);
+			times[t] = BestTime(5, [&]() { splines[t].Recompute(); });
+		}
+		printf("  %6d dots, MeshRes %4d: de Casteljau %7.2f ms, forward differencing %7.2f ms (%.2fx)\n",
+			   numDots[k], meshRes[k], times[0], times[1], times[0] / times[1]);
+		printf("      largest difference %g, on coordinates up to 1000\n", LargestDifference(splines[0], splines[1]));
+	}
+}
+
+// The de Casteljau loop of CatmullRomSpline, for NumPoints points on each of numCurves
+//    consecutive curves, laid out as for BezierEvaluate
+template<int NumPoints> void DeCasteljauCurves( const float* cp, int numCurves, float* points )
+{
+	for (int c = 0; c < numCurves; c++) {
+		VectorR2f p0, p1, p2, p3;
+		p0.Load(cp + 6 * c);
+		p1.Load(cp + 6 * c + 2);
+		p2.Load(cp + 6 * c + 4);
+		p3.Load(cp + 6 * c + 6);
+		for (int j = 0; j < NumPoints; j++) {
+			float alpha = (float)j / NumPoints;
+			VectorR2f r0 = (1 - alpha) * p0 + alpha * p1;
+			VectorR2f r1 = (1 - alpha) * p1 + alpha * p2;
+			VectorR2f r2 = (1 - alpha) * p2 + alpha * p3;
+			VectorR2f t0 = (1 - alpha) * r0 + alpha * r1;
+			VectorR2f t1 = (1 - alpha) * r1 + alpha * r2;
+			((1 - alpha) * t0 + alpha * t1).Dump(points + 2 * (NumPoints * c + j));
+		}
+	}
+}
+
+// Tessellates the 10^6 curves of a centripetal spline at MeshRes 20, from its control
+//    point array, with the de Casteljau loop and with the batch kernel.  Writing all
+//    of the 160 MB of points is limited by the memory bandwidth, so the curves are
+//    also tessellated 1000 at a time into the same 160 kB, which stays in the cache.
+//    Then the whole spline is recomputed with each tessellation.
+void BenchBatch()
+{
+	const int NumCurves = 1000000;
+	const int CachedCurves = 1000;
+	CatmullRomSpline spline;
+	AddRandomDots(spline, NumCurves + 1, 2);
+	spline.SetMode(CatmullRomSpline::Centripetal);
+	const float* cp = spline.ControlPoints();
+	std::vector<float> casteljau(2 * 20 * NumCurves), batch(2 * 20 * NumCurves);
+
+	printf("Batch tessellation with %s, best of 3, 10^6 curves at MeshRes 20:\n", BezierSimdName);
+	double times[2];
+	times[0] = BestTime(3, [&]() { DeCasteljauCurves<20>(cp, NumCurves, casteljau.data()); });
+	times[1] = BestTime(3, [&]() { BezierEvaluateFixed<20>(cp, NumCurves, batch.data()); });
+	float largest = 0.0f;
+	for (size_t k = 0; k < batch.size(); k++) {
+		largest = std::max(largest, fabsf(casteljau[k] - batch[k]));
+	}
+	printf("  writing 160 MB:   de Casteljau %6.1f ms, batch %6.1f ms (%.2fx)\n", times[0], times[1], times[0] / times[1]);
+
+	times[0] = BestTime(3, [&]() {
+		for (int c = 0; c < NumCurves; c += CachedCurves) {
+			DeCasteljauCurves<20>(cp + 6 * c, CachedCurves, casteljau.data());
+		}
+	});
+	times[1] = BestTime(3, [&]() {
+		for (int c = 0; c < NumCurves; c += CachedCurves) {
+			BezierEvaluateFixed<20>(cp + 6 * c, CachedCurves, batch.data());
+		}
+	});
+	printf("  in the cache:     de Casteljau %6.1f ms, batch %6.1f ms (%.2fx)\n", times[0], times[1], times[0] / times[1]);
+	printf("      largest difference %g, on coordinates up to 1000\n", largest);
+
+	for (int t = 0; t < 2; t++) {
+		spline.SetTessellation(t == 0 ? CatmullRomSpline::DeCasteljau : CatmullRomSpline::BernsteinBatch);
+		times[t] = BestTime(3, [&]() { spline.Recompute(); });
+	}
+	printf("  whole recompute:  de Casteljau %6.1f ms, batch %6.1f ms (%.2fx), with the control points\n",
+		   times[0], times[1], times[0] / times[1]);
+}
+
+// Maps n points by a 2x2 matrix: one VectorR2 or VectorR2f at a time, as the code
+//    before the batch transforms did, and with TransformPairs and TransformArrays.
+//    The points in the cache are mapped 256 times.  Prints nanoseconds per point.
+void BenchTransforms()
+{
+	const int sizes[] = { 4096, 1 << 20 };
+	LinearMapR2 map(1.5, -0.25, 0.75, 2.0);
+	LinearMapR2f mapf(1.5f, -0.25f, 0.75f, 2.0f);
+	std::mt19937 random(3);
+	std::uniform_real_distribution<float> coordinate(0.0f, 1000.0f);
+	printf("Transforms by a 2x2 matrix, best of 30, ns per point:\n");
+	for (int n : sizes) {
+		std::vector<float> pairs(2 * n), x(n), y(n), dest(2 * n), destX(n), destY(n), loop(2 * n);
+		for (int i = 0; i < n; i++) {
+			pairs[2 * i] = x[i] = coordinate(random);
+			pairs[2 * i + 1] = y[i] = coordinate(random);
+		}
+		int repeats = (n <= 4096) ? 256 : 1;
+		double times[4];
+		times[0] = BestTime(30, [&]() {
+			for (int r = 0; r < repeats; r++) {
+				for (int i = 0; i < n; i++) {
+					VectorR2 u;
+					u.Load(&pairs[2 * i]);
+					(map * u).Dump(&dest[2 * i]);
+				}
+			}
+		});
+		times[1] = BestTime(30, [&]() {
+			for (int r = 0; r < repeats; r++) {
+				for (int i = 0; i < n; i++) {
+					VectorR2f u;
+					u.Load(&pairs[2 * i]);
+					(mapf * u).Dump(&loop[2 * i]);
+				}
+			}
+		});
+		times[2] = BestTime(30, [&]() {
+			for (int r = 0; r < repeats; r++) {
+				mapf.TransformPairs(n, pairs.data(), dest.data());
+			}
+		});
+		times[3] = BestTime(30, [&]() {
+			for (int r = 0; r < repeats; r++) {
+				mapf.TransformArrays(n, x.data(), y.data(), destX.data(), destY.data());
+			}
+		});
+		bool same = memcmp(dest.data(), loop.data(), 2 * n * sizeof(float)) == 0;
+		for (int i = 0; i < n; i++) {
+			same = same && destX[i] == loop[2 * i] && destY[i] == loop[2 * i + 1];
+		}
+		double scale = 1.0e6 / ((double)n * repeats);
+		printf("  %7d points: VectorR2 %.2f, VectorR2f %.2f, TransformPairs %.2f, TransformArrays %.2f\n",
+			   n, times[0] * scale, times[1] * scale, times[2] * scale, times[3] * scale);
+		printf("      the batch transforms are %s the VectorR2f loop\n", same ? "bit-identical to" : "DIFFERENT from");
+	}
+}
+
+// Times SetMode on 10^6 dots, which recomputes the knot intervals, the control
+//    points and the points on the curve, with SetThreadCount(1), ..., one thread
+//    per core, for three of the tessellations.  Checks that the points on the
+//    curve do not depend on the number of threads.
+void BenchThreads()
+{
+	const int tessellations[] = { CatmullRomSpline::BernsteinBatch, CatmullRomSpline::DeCasteljau, CatmullRomSpline::Adaptive };
+	const char* const names[] = { "batch", "de Casteljau", "adaptive" };
+	int maxThreads = ThreadPool::HardwareThreads();
+	CatmullRomSpline spline;
+	AddRandomDots(spline, 1000000, 4);
+	printf("Threads, best of 3 calls of SetMode on 10^6 dots, ms (speedup), for 1 to %d threads:\n", maxThreads);
+	for (int k = 0; k < 3; k++) {
+		spline.SetThreadCount(1);
+		spline.SetTessellation(tessellations[k]);
+		spline.SetMode(CatmullRomSpline::Centripetal);
+		std::vector<float> oneThread(spline.PointsOnCurve(), spline.PointsOnCurve() + 2 * spline.CurvePointCapacity());
+		printf("  %-13s", names[k]);
+		double first = 0.0;
+		bool same = true;
+		for (int numThreads = 1; numThreads <= maxThreads; numThreads++) {
+			spline.SetThreadCount(numThreads);
+			double time = BestTime(3, [&]() { spline.SetMode(CatmullRomSpline::Centripetal); });
+			first = (numThreads == 1) ? time : first;
+			printf(" %.1f (%.2fx)", time, first / time);
+			same = same && memcmp(oneThread.data(), spline.PointsOnCurve(), oneThread.size() * sizeof(float)) == 0;
+		}
+		printf("\n      the points are %s with any number of threads\n", same ? "the same" : "DIFFERENT");
+	}
+}
+
+// Finds the crossings of two centripetal waves, which cross about once every
+//    30 segments, and of a centripetal random walk with itself, which crosses
+//    itself more than once per segment, with n = 10^4 and 10^5 segments.
+void BenchIntersections()
+{
+	const int sizes[] = { 10000, 100000 };
+	printf("Intersections, best of 3:\n");
+	for (int n : sizes) {
+		CatmullRomSpline waveA, waveB, walk;
+		CatmullRomSpline* splines[] = { &waveA, &waveB, &walk };
+		for (CatmullRomSpline* spline : splines) {
+			spline->SetMode(CatmullRomSpline::Centripetal);
+			spline->Reserve(n + 1);
+		}
+		std::mt19937 random(5);
+		std::uniform_real_distribution<float> step(-0.01f, 0.01f);
+		float x = 0.0f, y = 0.0f;
+		for (int i = 0; i <= n; i++) {
+			double u = -1.0 + 2.0 * i / n;
+			waveA.AddPoint((float)u, (float)(0.5 * sin(0.05 * n * u)));
+			waveB.AddPoint((float)u, (float)(0.5 * cos(0.05 * n * u + 0.3)));
+			x += step(random);
+			y += step(random);
+			walk.AddPoint(x, y);
+		}
+		std::vector<CurveIntersection> waves, self;
+		double times[2];
+		times[0] = BestTime(3, [&]() {
+			waves.clear();
+			IntersectCurves(waveA, 0, waveB, 1, waves);
+		});
+		times[1] = BestTime(3, [&]() {
+			self.clear();
+			IntersectCurves(walk, 0, self);
+		});
+		printf("  %6d segments: two waves %7.1f ms (%d crossings), random walk with itself %7.1f ms (%d crossings)\n",
+			   n, times[0], (int)waves.size(), times[1], (int)self.size());
+	}
+}
+
+struct Benchmark {
+	const char* name;
+	void (*run)();
+};
+
+const Benchmark Benchmarks[] = {
+	{ "tessellation", BenchTessellation },
+	{ "batch", BenchBatch },
+	{ "transforms", BenchTransforms },
+	{ "threads", BenchThreads },
+	{ "intersections", BenchIntersections },
+};
+const int NumBenchmarks = sizeof(Benchmarks) / sizeof(Benchmarks[0]);
+
+const Benchmark* FindBenchmark( const char* name )
+{
+	for (const Benchmark& benchmark : Benchmarks) {
+		if (strcmp(benchmark.name, name) == 0) {
+			return &benchmark;
+		}
+	}
+	return nullptr;
+}
+
+int main( int argc, char* argv[] )
+{
+	for (int k = 1; k < argc; k++) {
+		if (FindBenchmark(argv[k]) == nullptr) {
+			printf("Unknown benchmark %s.  Usage: CatmullRomBench [name ...], with the names\n", argv[k]);
+			for (const Benchmark& benchmark : Benchmarks) {
+				printf("    %s\n", benchmark.name);
+			}
+			return 1;
+		}
+	}
+	if (argc == 1) {
+		for (int k = 0; k < NumBenchmarks; k++) {
+			Benchmarks[k].run();
+		}
+	}
+	for (int k = 1; k < argc; k++) {
+		FindBenchmark(argv[k])->run();
+	}
+	return 0;
+}
@@ -0,0 +1,470 @@
+/*
+ * CatmullRomFilter.cpp
+ *
+ * Command line filter for the CatmullRomSpline engine.  Reads a stream of
+ * dots, from a file or from standard input, and writes the points on the
+ * Catmull-Rom or Overhauser curve through them, and/or its Bezier control
+ * points, as it goes.  The stream may be endless.
+ *
+ * A curve between two dots depends only on those dots and on the dot before
+ * and the dot after them.  So the spline keeps only the last 4 dots (see
+ * CatmullRomSpline::SetMaxDots), and each curve is written as soon as the
+ * dot after it has been read.  The memory used does not depend on the
+ * length of the stream.
+ *
+ * Reading, fitting and writing run on three threads, which pass batches of
+ * points through queues holding at most QueueBatches batches.  When the
+ * output cannot keep up, the queues fill up and reading waits.  The input
+ * is read with read(), which returns what is available rather than waiting
+ * for a full buffer, so the dots of a slow stream are fitted as they arrive
+ * and the output is flushed whenever the writer has nothing left to write.
+ *
+ * Usage: CatmullRomFilter [options] [inputFile]
+ *   -m mode     1 Catmull-Rom, 2 chord-length, 3 centripetal (default)
+ *   -a alpha    knot intervals d^alpha, instead of -m
+ *   -t tess     0 de Casteljau, 1 forward differencing, 2 batched (default), 3 adaptive
+ *   -r points   points per Bezier curve (default 20, at most 4096); for -t 3, the most segments
+ *   -f tol      flatness tolerance for -t 3 (default 0.001)
+ *   -o file     the points on the curve (default: standard output)
+ *   -c file     the control points p0, p0+, p1-, p1, ... (default: not written)
+ *   -n          do not write the points on the curve
+ *   -b          binary input: (x,y) pairs of 32-bit floats
+ *   -B          binary output: (x,y) pairs of 32-bit floats
+ *   -v          report counts and times on standard error
+ * "-" for a file name is standard input or output.  Text input has two
+ * numbers per line, separated by spaces, tabs or commas; blank lines and
+ * lines starting with '#' are skipped.  Text output has one point per line.
+ *
+ * Software is "as-is" and carries no warranty.  It may be used without
+ *   restriction, but if you modify it, please change the filenames to
+ *   prevent confusion between different versions.
+ */
+
+#define _CRT_SECURE_NO_WARNINGS		// For fopen in Visual Studio
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "CatmullRomSpline.h"
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+static const int ReadBufferSize = 1 << 16;	// Bytes read at a time, so at most 8192 dots per batch
+static const int QueueBatches = 4;			// Batches each queue holds before its producer waits
+
+struct Options {
+	int mode = CatmullRomSpline::Centripetal;
+	float alpha = -1.0f;					// Or the exponent for -a
+	int tessellation = CatmullRomSpline::BernsteinBatch;
+	int meshRes = CatmullRomSpline::DefaultMeshRes;
+	float tolerance = 0.001f;
+	const char* inputFile = "-";
+	const char* curveFile = "-";			// Or nullptr for -n
+	const char* controlFile = nullptr;
+	bool binaryInput = false;
+	bool binaryOutput = false;
+	bool verbose = false;
+};
+
+// A queue of at most capacity items, for one producer thread and one consumer
+//    thread.  Push waits while the queue is full, and Pop while it is empty.
+template<class T> class BoundedQueue {
+
+public:
+	explicit BoundedQueue( int capacity ) : capacity(capacity), closed(false) {}
+
+	void Push( T&& item )
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		notFull.wait(lock, [this] { return (int)items.size() < capacity; });
+		items.push_back(std::move(item));
+		notEmpty.notify_one();
+	}
+
+	// Returns false once the queue is closed and empty
+	bool Pop( T& item )
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		notEmpty.wait(lock, [this] { return !items.empty() || closed; });
+		if (items.empty()) {
+			return false;
+		}
+		item = std::move(items.front());
+		items.pop_front();
+		notFull.notify_one();
+		return true;
+	}
+
+	bool IsEmpty()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return items.empty();
+	}
+
+	void Close()							// No more items will be pushed
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		closed = true;
+		notEmpty.notify_one();
+	}
+
+private:
+	int capacity;
+	bool closed;
+	std::deque<T> items;
+	std::mutex mutex;
+	std::condition_variable notEmpty;
+	std::condition_variable notFull;
+};
+
+typedef std::vector<float> PointBatch;		// (x,y) pairs
+
+struct OutputBatch {
+	PointBatch curvePoints;
+	PointBatch controlPoints;
+};
+
+// **************************
+// Reading the dots
+// **************************
+
+// Reads what is available, up to size bytes.  Returns 0 at the end of the input, -1 on error.
+static int readAvailable( FILE* in, char* buffer, int size )
+{
+#ifdef _WIN32
+	return _read(_fileno(in), buffer, size);
+#else
+	return (int)read(fileno(in), buffer, size);
+#endif
+}
+
+static bool parseLine( char* line, float* x, float* y )
+{
+	char* p = line + strspn(line, " \t\r\n");
+	if (*p == '#' || *p == 0) {
+		return false;
+	}
+	char* end;
+	*x = strtof(p, &end);
+	if (end == p) {
+		return false;
+	}
+	p = end + strspn(end, " \t,");
+	*y = strtof(p, &end);
+	return end != p;
+}
+
+// Appends the dots in buffer[0, length) to batch, and returns the number of
+//    bytes used.  The rest, a partial line or point, waits for the next read.
+//    At the end of the input, a last line without a newline is used too.
+static int parseDots( char* buffer, int length, bool binary, bool atEnd, PointBatch& batch )
+{
+	if (binary) {
+		int numFloats = length / (2 * sizeof(float)) * 2;	// An odd float at the end is dropped
+		batch.resize(numFloats);
+		memcpy(batch.data(), buffer, numFloats * sizeof(float));
+		return atEnd ? length : numFloats * (int)sizeof(float);
+	}
+	int used = 0;
+	float xy[2];
+	for (;;) {
+		char* newline = (char*)memchr(buffer + used, '\n', length - used);
+		if (newline == nullptr) {
+			if (!atEnd && (used > 0 || length < ReadBufferSize)) {
+				return used;
+			}
+			newline = buffer + length;		// A last line, or a line longer than the buffer
+		}
+		*newline = 0;
+		if (parseLine(buffer + used, xy, xy + 1)) {
+			batch.push_back(xy[0]);
+			batch.push_back(xy[1]);
+		}
+		used = (int)(newline - buffer) + 1;
+		if (used >= length) {
+			return length;
+		}
+	}
+}
+
+// Returns false if there was an error reading the input
+static bool readDots( FILE* in, bool binary, BoundedQueue<PointBatch>& dots, long long& numRead )
+{
+	numRead = 0;
+	std::vector<char> buffer(ReadBufferSize + 1);		// Room for a terminating 0
+	int length = 0;
+	bool ok = true;
+	bool atEnd = false;
+	while (!atEnd) {
+		int n = readAvailable(in, buffer.data() + length, ReadBufferSize - length);
+		ok = (n >= 0);
+		atEnd = (n <= 0);
+		if (n > 0) {
+			length += n;
+		}
+
+		PointBatch batch;
+		int used = parseDots(buffer.data(), length, binary, atEnd, batch);
+		memmove(buffer.data(), buffer.data() + used, length - used);
+		length -= used;
+		if (!batch.empty()) {
+			numRead += batch.size() / 2;
+			dots.Push(std::move(batch));
+		}
+	}
+	dots.Close();
+	return ok;
+}
+
+// **************************
+// Fitting the curve
+// **************************
+
+// Appends curve i of the spline, without its last point, which starts the next curve
+static void appendCurve( const CatmullRomSpline& spline, int i, const Options& options, OutputBatch& out )
+{
+	if (options.curveFile != nullptr) {
+		const float* p = spline.CurvePoints(i);
+		out.curvePoints.insert(out.curvePoints.end(), p, p + 2 * (spline.SegmentPointCount(i) - 1));
+	}
+	if (options.controlFile != nullptr) {
+		const float* p = spline.CurveControlPoints(i);
+		out.controlPoints.insert(out.controlPoints.end(), p, p + 6);
+	}
+}
+
+static void fitCurve( const Options& options, BoundedQueue<PointBatch>& dots, BoundedQueue<OutputBatch>& output,
+					  long long& numDots )
+{
+	CatmullRomSpline spline;
+	spline.SetMaxDots(4);
+	spline.SetMeshResolution(options.meshRes);
+	spline.SetTessellation(options.tessellation);
+	spline.SetFlatnessTolerance(options.tolerance);
+	if (options.alpha >= 0.0f) {
+		spline.SetAlpha(options.alpha);
+	}
+	else {
+		spline.SetMode(options.mode);
+	}
+
+	// Once dot k has been added, curve k-2, from dot k-2 to dot k-1, does not
+	//    change any more.  In the window of the last 4 dots this is curve 1,
+	//    or curve 0 when there are only 3 dots.
+	numDots = 0;
+	OutputBatch out;
+	PointBatch batch;
+	while (dots.Pop(batch)) {
+		for (size_t j = 0; j < batch.size(); j += 2) {
+			if (!spline.AddPoint(batch[j], batch[j + 1])) {
+				continue;					// Repeats the last dot
+			}
+			numDots++;
+			if (spline.NumDots() >= 3) {
+				appendCurve(spline, spline.NumDots() - 3, options, out);
+			}
+		}
+		output.Push(std::move(out));
+		out = OutputBatch();
+	}
+
+	// The last curve ends with the final velocity, and the end of the curve is the last dot
+	if (spline.NumDots() >= 2) {
+		appendCurve(spline, spline.NumDots() - 2, options, out);
+	}
+	if (spline.NumDots() >= 1) {
+		const float* last = spline.Dot(spline.NumDots() - 1);
+		if (options.curveFile != nullptr) {
+			out.curvePoints.insert(out.curvePoints.end(), last, last + 2);
+		}
+		if (options.controlFile != nullptr && spline.NumDots() >= 2) {
+			out.controlPoints.insert(out.controlPoints.end(), last, last + 2);
+		}
+	}
+	output.Push(std::move(out));
+	output.Close();
+}
+
+// **************************
+// Writing the points
+// **************************
+
+static bool writePoints( FILE* file, const PointBatch& points, bool binary )
+{
+	if (file == nullptr || points.empty()) {
+		return true;
+	}
+	if (binary) {
+		return fwrite(points.data(), sizeof(float), points.size(), file) == points.size();
+	}
+	for (size_t j = 0; j < points.size(); j += 2) {
+		if (fprintf(file, "%.9g %.9g\n", points[j], points[j + 1]) < 0) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// Keeps consuming the output after an error, so that the other threads can finish
+static void writeOutput( const Options& options, FILE* curveFile, FILE* controlFile,
+						 BoundedQueue<OutputBatch>& output, long long& numWritten, bool& ok )
+{
+	numWritten = 0;
+	ok = true;
+	OutputBatch out;
+	while (output.Pop(out)) {
+		ok = ok && writePoints(curveFile, out.curvePoints, options.binaryOutput)
+				&& writePoints(controlFile, out.controlPoints, options.binaryOutput);
+		numWritten += out.curvePoints.size() / 2;
+		if (output.IsEmpty()) {
+			// Nothing more to write for now: let the reader of the output see the points so far
+			ok = ok && (curveFile == nullptr || fflush(curveFile) == 0)
+					&& (controlFile == nullptr || fflush(controlFile) == 0);
+		}
+	}
+}
+
+// **************************
+// Command line
+// **************************
+
+static void usage()
+{
+	fputs("Usage: CatmullRomFilter [options] [inputFile]\n"
+		  "  -m mode     1 Catmull-Rom, 2 chord-length, 3 centripetal (default)\n"
+		  "  -a alpha    knot intervals d^alpha, instead of -m\n"
+		  "  -t tess     0 de Casteljau, 1 forward differencing, 2 batched (default), 3 adaptive\n"
+		  "  -r points   points per Bezier curve (default 20, at most 4096); for -t 3, the most segments\n"
+		  "  -f tol      flatness tolerance for -t 3 (default 0.001)\n"
+		  "  -o file     the points on the curve (default: standard output)\n"
+		  "  -c file     the control points (default: not written)\n"
+		  "  -n          do not write the points on the curve\n"
+		  "  -b          binary input: (x,y) pairs of 32-bit floats\n"
+		  "  -B          binary output: (x,y) pairs of 32-bit floats\n"
+		  "  -v          report counts and times on standard error\n"
+		  "\"-\" for a file name is standard input or output.\n", stderr);
+}
+
+static bool parseOptions( int argc, char* argv[], Options& options )
+{
+	int k = 1;
+	for ( ; k < argc && argv[k][0] == '-' && argv[k][1] != 0; k++) {
+		char flag = argv[k][1];
+		if (argv[k][2] != 0) {
+			return false;
+		}
+		if (strchr("matrfoc", flag) != nullptr) {
+			if (++k == argc) {
+				return false;
+			}
+			const char* value = argv[k];
+			switch (flag) {
+			case 'm': options.mode = atoi(value); break;
+			case 'a': options.alpha = (float)atof(value); break;
+			case 't': options.tessellation = atoi(value); break;
+			case 'r': options.meshRes = atoi(value); break;
+			case 'f': options.tolerance = (float)atof(value); break;
+			case 'o': options.curveFile = value; break;
+			case 'c': options.controlFile = value; break;
+			}
+			continue;
+		}
+		switch (flag) {
+		case 'n': options.curveFile = nullptr; break;
+		case 'b': options.binaryInput = true; break;
+		case 'B': options.binaryOutput = true; break;
+		case 'v': options.verbose = true; break;
+		default: return false;
+		}
+	}
+	if (k < argc) {
+		options.inputFile = argv[k++];
+	}
+	return k == argc
+		&& options.mode >= CatmullRomSpline::CatmullRom && options.mode <= CatmullRomSpline::Centripetal
+		&& options.tessellation >= CatmullRomSpline::DeCasteljau && options.tessellation <= CatmullRomSpline::Adaptive
+		&& options.meshRes > 0 && options.meshRes <= CatmullRomSpline::MaxMeshRes && options.tolerance > 0.0f
+		&& (options.curveFile != nullptr || options.controlFile != nullptr);
+}
+
+static FILE* openFile( const char* name, bool input, bool binary )
+{
+	if (strcmp(name, "-") == 0) {
+		FILE* file = input ? stdin : stdout;
+#ifdef _WIN32
+		if (binary) {
+			_setmode(_fileno(file), _O_BINARY);
+		}
+#endif
+		return file;
+	}
+	const char* fileMode = input ? (binary ? "rb" : "r") : (binary ? "wb" : "w");
+	FILE* file = fopen(name, fileMode);
+	if (file == nullptr) {
+		fprintf(stderr, "CatmullRomFilter: cannot open %s\n", name);
+	}
+	return file;
+}
+
+int main( int argc, char* argv[] )
+{
+	Options options;
+	if (!parseOptions(argc, argv, options)) {
+		usage();
+		return 1;
+	}
+	if (options.curveFile != nullptr && options.controlFile != nullptr
+			&& strcmp(options.curveFile, options.controlFile) == 0) {
+		fputs("CatmullRomFilter: -o and -c must be different files\n", stderr);
+		return 1;
+	}
+
+	FILE* in = openFile(options.inputFile, true, options.binaryInput);
+	FILE* curveFile = (options.curveFile != nullptr) ? openFile(options.curveFile, false, options.binaryOutput) : nullptr;
+	FILE* controlFile = (options.controlFile != nullptr) ? openFile(options.controlFile, false, options.binaryOutput) : nullptr;
+	if (in == nullptr || (options.curveFile != nullptr && curveFile == nullptr)
+			|| (options.controlFile != nullptr && controlFile == nullptr)) {
+		return 2;
+	}
+
+	auto startTime = std::chrono::steady_clock::now();
+	BoundedQueue<PointBatch> dots(QueueBatches);
+	BoundedQueue<OutputBatch> output(QueueBatches);
+	long long numRead, numDots, numWritten;
+	bool readOk, writeOk;
+	std::thread reader([&] { readOk = readDots(in, options.binaryInput, dots, numRead); });
+	std::thread writer(writeOutput, std::cref(options), curveFile, controlFile, std::ref(output),
+					   std::ref(numWritten), std::ref(writeOk));
+	fitCurve(options, dots, output, numDots);
+	reader.join();
+	writer.join();
+
+	bool ok = readOk && writeOk;
+	if (curveFile != nullptr) {
+		ok = (fflush(curveFile) == 0) && ok;
+	}
+	if (controlFile != nullptr) {
+		ok = (fflush(controlFile) == 0) && ok;
+	}
+	if (options.verbose) {
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+		fprintf(stderr, "%lld points read, %lld dots, %lld points on the curve written in %.3f s\n",
+				numRead, numDots, numWritten, seconds);
+	}
+	if (!ok) {
+		fputs("CatmullRomFilter: error reading or writing\n", stderr);
+		return 2;
+	}
+	return 0;
+}
@@ -0,0 +1,1020 @@
+/*
+ * CatmullRomSpline.cpp
+ *
+ * Headless spline engine for the ConnectDotsModern program.
+ * Computes the Bezier control points of Catmull-Rom and Overhauser
+ * (chord-length and centripetal) splines through a sequence of dots,
+ * and tessellates the resulting Bezier curves.
+ *
+ * Software is "as-is" and carries no warranty.  It may be used without
+ *   restriction, but if you modify it, please change the filenames to
+ *   prevent confusion between different versions.
+ */
+
+#include "CatmullRomSpline.h"
+#include "BezierSimd.h"
+#include "CurveFile.h"
+#include "ThreadPool.h"
+
+#include <assert.h>
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+
+CatmullRomSpline::CatmullRomSpline()
+	: mode(Polyline), alpha(0.5f), tessellation(BernsteinBatch), meshRes(0), fixedEvaluator(nullptr),
+	  flatnessTolerance(0.001f),
+	  numDots(0), capacity(0), head(0), maxDots(0),
+	  countControlPoints(0), countPointsOnCurve(0),
+	  numDirtyCurves(0),
+	  initialVelocity_X(0.0f), initialVelocity_Y(0.0f),
+	  finalVelocity_X(0.0f), finalVelocity_Y(0.0f)
+{
+	dirtyDots.first = dirtyDots.end = 0;
+	SetMeshResolution(DefaultMeshRes);
+}
+
+CatmullRomSpline::~CatmullRomSpline()
+{
+}
+
+void CatmullRomSpline::SetMode( int newMode )
+{
+	assert( newMode >= Polyline && newMode <= GeneralAlpha );
+	mode = newMode;
+	updateKnotIntervals(0, numDots - 1);
+	Recompute();
+}
+
+void CatmullRomSpline::SetAlpha( float newAlpha )
+{
+	assert( newAlpha >= 0.0f );
+	alpha = newAlpha;
+	SetMode(alpha == 0.0f ? CatmullRom : alpha == 0.5f ? Centripetal : alpha == 1.0f ? ChordLength : GeneralAlpha);
+}
+
+float CatmullRomSpline::Alpha() const
+{
+	switch (mode) {
+	case CatmullRom:
+		return 0.0f;
+	case ChordLength:
+		return 1.0f;
+	case Centripetal:
+		return 0.5f;
+	default:
+		return alpha;
+	}
+}
+
+void CatmullRomSpline::SetTessellation( int newTessellation )
+{
+	assert( newTessellation >= DeCasteljau && newTessellation <= Adaptive );
+	tessellation = newTessellation;
+	Recompute();
+}
+
+void CatmullRomSpline::SetFlatnessTolerance( float tolerance )
+{
+	assert( tolerance > 0.0f );
+	flatnessTolerance = tolerance;
+	if (tessellation == Adaptive) {
+		Recompute();
+	}
+}
+
+void CatmullRomSpline::SetMeshResolution( int newMeshRes )
+{
+	assert( newMeshRes > 0 && newMeshRes <= MaxMeshRes );
+	if (newMeshRes == meshRes) {
+		return;
+	}
+
+	// The curve points of slot s move from index meshRes*s to newMeshRes*s
+	meshRes = newMeshRes;
+	std::vector<Point2> newPointsOnCurve(meshRes * capacity + 1);
+	pointsOnCurve.swap(newPointsOnCurve);
+	setSegmentFirsts();
+
+	// Use a compile-time table of weights if there is one
+	fixedEvaluator = BezierFixedEvaluator(meshRes);
+	if (fixedEvaluator == nullptr) {
+		bernsteinWeights.resize(4 * meshRes);
+		BezierBernsteinWeights(meshRes, bernsteinWeights.data());
+	}
+	else {
+		bernsteinWeights.clear();
+	}
+	Recompute();
+}
+
+void CatmullRomSpline::SetEndVelocities( float initialX, float initialY, float finalX, float finalY )
+{
+	initialVelocity_X = initialX;
+	initialVelocity_Y = initialY;
+	finalVelocity_X = finalX;
+	finalVelocity_Y = finalY;
+	Recompute();
+}
+
+bool CatmullRomSpline::AddPoint( float x, float y )
+{
+	// check for the repeated points
+	if (numDots > 0 && x == dot(numDots - 1)[0] && y == dot(numDots - 1)[1]) {
+		return false;
+	}
+
+	bool droppedFirst = false;
+	if (maxDots > 0 && numDots == maxDots) {
+		dropFirst();			// Rolling window: make room by removing the first dot
+		droppedFirst = true;
+	}
+	else if (numDots == capacity) {
+		int newCapacity = Max(2 * capacity, 16);
+		if (maxDots > 0) {
+			newCapacity = Min(newCapacity, maxDots);
+		}
+		growTo(newCapacity);
+	}
+	dot(numDots)[0] = x;
+	dot(numDots)[1] = y;
+	numDots++;
+	markDotsDirty(numDots - 1, numDots);
+	updateKnotIntervals(numDots - 2, numDots - 1);
+
+	// Only the last two curves change: the new one, and the one before it,
+	//    whose end velocity is no longer the final velocity.
+	// If the first dot was removed, the new first curve now starts
+	//    with the initial velocity.
+	if (droppedFirst) {
+		updateCurves(0, 1);
+	}
+	updateCurves(numDots - 3, numDots - 1);
+	syncWrapEntries();
+	return true;
+}
+
+void CatmullRomSpline::ChangePoint( int i, float x, float y )
+{
+	assert( i >= 0 && i < numDots );
+	dot(i)[0] = x;
+	dot(i)[1] = y;
+	markDotsDirty(i, i + 1);
+	updateKnotIntervals(i - 1, i + 1);
+
+	// Curve j depends on dots j-1, ..., j+2, so moving dot i
+	//    changes only curves i-2, ..., i+1.
+	updateCurves(i - 2, i + 2);
+	syncWrapEntries();
+}
+
+void CatmullRomSpline::RemoveFirstPoint()
+{
+	if (numDots == 0) {
+		return;
+	}
+	dropFirst();
+
+	// The new first curve now starts with the initial velocity
+	updateCurves(0, 1);
+	syncWrapEntries();
+}
+
+void CatmullRomSpline::RemoveLastPoint()
+{
+	if (numDots == 0) {
+		return;
+	}
+	numDots--;
+	if (numDots > 0) {
+		segmentCount[slot(numDots - 1)] = 0;	// The new last dot starts no curve
+	}
+
+	// The new last curve now ends with the final velocity
+	updateCurves(numDots - 2, numDots - 1);
+	syncWrapEntries();
+}
+
+void CatmullRomSpline::Clear()
+{
+	numDots = 0;
+	head = 0;
+	std::fill(segmentCount.begin(), segmentCount.end(), 0);
+	Recompute();
+}
+
+void CatmullRomSpline::SegmentControlPoints( int i, float cp[8] ) const
+{
+	assert( i >= 0 && i < numDots - 1 );
+	if (HasCurve()) {
+		memcpy(cp, CurveControlPoints(i), 8 * sizeof(float));
+		return;
+	}
+	const float* p0 = Dot(i);
+	const float* p3 = Dot(i + 1);
+	for (int k = 0; k < 2; k++) {
+		cp[k] = p0[k];
+		cp[2 + k] = p0[k] + (p3[k] - p0[k]) * (1.0f / 3.0f);
+		cp[4 + k] = p0[k] + (p3[k] - p0[k]) * (2.0f / 3.0f);
+		cp[6 + k] = p3[k];
+	}
+}
+
+// Parameters of a batch per chunk of work given to a thread
+static const int MinParamsPerChunk = 4096;
+
+void CatmullRomSpline::Evaluate( const CurveParameter* params, int numParams,
+								 float* positions, float* derivatives, float* curvatures ) const
+{
+	bool straight = !HasCurve();		// The lines of the Polyline mode do not turn
+	auto task = [this, params, positions, derivatives, curvatures, straight]( int first, int end ) {
+		float cp[8];
+		int curve = -1;
+		for (int k = first; k < end; k++) {
+			if (params[k].curve != curve) {
+				curve = params[k].curve;
+				SegmentControlPoints(curve, cp);
+			}
+			float t = params[k].t;
+			float s = 1.0f - t;
+			if (positions != nullptr) {
+				float b0 = s * s * s, b1 = 3.0f * s * s * t, b2 = 3.0f * s * t * t, b3 = t * t * t;
+				positions[2 * k] = b0 * cp[0] + b1 * cp[2] + b2 * cp[4] + b3 * cp[6];
+				positions[2 * k + 1] = b0 * cp[1] + b1 * cp[3] + b2 * cp[5] + b3 * cp[7];
+			}
+			if (derivatives == nullptr && curvatures == nullptr) {
+				continue;
+			}
+			float d[2], dd[2];
+			for (int j = 0; j < 2; j++) {
+				d[j] = 3.0f * (s * s * (cp[2 + j] - cp[j]) + 2.0f * s * t * (cp[4 + j] - cp[2 + j])
+							   + t * t * (cp[6 + j] - cp[4 + j]));
+				dd[j] = 6.0f * (s * (cp[4 + j] - 2.0f * cp[2 + j] + cp[j]) + t * (cp[6 + j] - 2.0f * cp[4 + j] + cp[2 + j]));
+			}
+			if (derivatives != nullptr) {
+				derivatives[2 * k] = d[0];
+				derivatives[2 * k + 1] = d[1];
+			}
+			if (curvatures != nullptr) {
+				// Zero where the curve stops, as at a cusp
+				float speed2 = d[0] * d[0] + d[1] * d[1];
+				curvatures[k] = (speed2 > 0.0f && !straight) ? (d[0] * dd[1] - d[1] * dd[0]) / (speed2 * sqrtf(speed2)) : 0.0f;
+			}
+		}
+	};
+	if (threadPool == nullptr || numParams <= MinParamsPerChunk) {
+		task(0, numParams);
+	}
+	else {
+		threadPool->ParallelFor(0, numParams, MinParamsPerChunk, task);
+	}
+}
+
+void CatmullRomSpline::SetMaxDots( int newMaxDots )
+{
+	assert( newMaxDots >= 0 );
+	maxDots = newMaxDots;
+	if (maxDots > 0 && numDots > maxDots) {
+		while (numDots > maxDots) {
+			dropFirst();
+		}
+		updateCurves(0, 1);
+		syncWrapEntries();
+	}
+}
+
+void CatmullRomSpline::SetThreadCount( int numThreads )
+{
+	assert( numThreads >= 0 );
+	if (numThreads == 0) {
+		numThreads = ThreadPool::HardwareThreads();
+	}
+	if (numThreads != ThreadCount()) {
+		threadPool.reset(numThreads > 1 ? new ThreadPool(numThreads) : nullptr);
+	}
+}
+
+int CatmullRomSpline::ThreadCount() const
+{
+	return (threadPool != nullptr) ? threadPool->NumThreads() : 1;
+}
+
+// Chunks of fewer curves are not worth handing to another thread.
+//    Adding or moving a dot recomputes at most 4 curves, on the calling thread.
+static const int MinCurvesPerChunk = 256;
+
+template<class Task> void CatmullRomSpline::forEachChunk( int firstCurve, int endCurve, Task task )
+{
+	if (threadPool == nullptr) {
+		task(firstCurve, endCurve);
+	}
+	else {
+		threadPool->ParallelFor(firstCurve, endCurve, MinCurvesPerChunk, task);
+	}
+}
+
+void CatmullRomSpline::Reserve( int newNumDots )
+{
+	if (newNumDots > capacity) {
+		growTo(newNumDots);
+	}
+}
+
+// Reallocates the arrays.  AddPoint doubles the capacity, so that adding
+//   n dots one at a time costs O(n) copying in total.
+// The dots, and their slots, are moved so that dot 0 is in slot 0.
+void CatmullRomSpline::growTo( int newCapacity )
+{
+	assert( newCapacity >= numDots );
+	std::vector<Point2> newDots(newCapacity + 1);
+	std::vector<Point2> newControlPoints(3 * newCapacity + 1);
+	std::vector<Point2> newPointsOnCurve(meshRes * newCapacity + 1);
+	std::vector<int> newSegmentCount(newCapacity, 0);
+	std::vector<float> newKnotIntervals(newCapacity);
+	for (int i = 0; i < numDots; i++) {
+		int s = slot(i);
+		newDots[i] = dotArray[s];
+		newSegmentCount[i] = segmentCount[s];
+		newKnotIntervals[i] = knotIntervals[s];
+		for (int k = 0; k < 3; k++) {
+			newControlPoints[3 * i + k] = controlPoints[3 * s + k];
+		}
+		for (int k = 0; k < meshRes; k++) {
+			newPointsOnCurve[meshRes * i + k] = pointsOnCurve[meshRes * s + k];
+		}
+	}
+	dotArray.swap(newDots);
+	controlPoints.swap(newControlPoints);
+	pointsOnCurve.swap(newPointsOnCurve);
+	segmentCount.swap(newSegmentCount);
+	knotIntervals.swap(newKnotIntervals);
+	capacity = newCapacity;
+	head = 0;
+	setSegmentFirsts();
+	syncWrapEntries();
+}
+
+void CatmullRomSpline::setSegmentFirsts()
+{
+	segmentFirst.resize(capacity);
+	for (int s = 0; s < capacity; s++) {
+		segmentFirst[s] = meshRes * s;
+	}
+}
+
+// Removes the first dot, without recomputing any curves.
+void CatmullRomSpline::dropFirst()
+{
+	assert( numDots > 0 );
+	segmentCount[head] = 0;
+	head = (head + 1 < capacity) ? head + 1 : 0;
+	numDots--;
+
+	// Dot i is now dot i-1
+	dirtyDots.first = Max(dirtyDots.first - 1, 0);
+	dirtyDots.end--;
+	for (int k = 0; k < numDirtyCurves; k++) {
+		dirtyCurves[k].first = Max(dirtyCurves[k].first - 1, 0);
+		dirtyCurves[k].end--;
+	}
+}
+
+// The last entry of each array repeats entry 0, which is the dot in slot 0.
+void CatmullRomSpline::syncWrapEntries()
+{
+	if (capacity == 0) {
+		return;
+	}
+	dotArray[capacity] = dotArray[0];
+	controlPoints[3 * capacity] = controlPoints[0] = dotArray[0];
+	pointsOnCurve[meshRes * capacity] = pointsOnCurve[0] = dotArray[0];
+}
+
+int CatmullRomSpline::PhysicalRanges( PointArray which, DirtyRange r, DirtyRange phys[2] ) const
+{
+	if (r.IsEmpty()) {
+		return 0;
+	}
+	int stride = (which == DotArray) ? 1 : (which == ControlPointArray) ? 3 : meshRes;
+	int wrap = stride * capacity;		// The entry at wrap repeats entry 0
+	int first = stride * head + r.first;
+	int end = stride * head + r.end;
+	if (end <= wrap + 1) {
+		phys[0].first = first;
+		phys[0].end = end;
+		return 1;
+	}
+	if (first >= wrap) {
+		phys[0].first = first - wrap;
+		phys[0].end = end - wrap;
+		return 1;
+	}
+	phys[0].first = first;
+	phys[0].end = wrap + 1;
+	phys[1].first = 0;
+	phys[1].end = end - wrap;
+	return 2;
+}
+
+int CatmullRomSpline::count( PointArray which ) const
+{
+	return (which == DotArray) ? numDots
+		: (which == ControlPointArray) ? countControlPoints : countPointsOnCurve;
+}
+
+int CatmullRomSpline::DrawRanges( PointArray which, DirtyRange phys[2] ) const
+{
+	DirtyRange all = { 0, count(which) };
+	return PhysicalRanges(which, all, phys);
+}
+
+void CatmullRomSpline::Recompute()
+{
+	updateCurves(0, numDots - 1);
+	syncWrapEntries();
+}
+
+// The file holds the arrays from dot 0 on, which is at most two ranges of
+//    entries of each of the circular buffers.  The first of two ranges ends
+//    with the extra entry, which repeats the first entry of the second range.
+bool CatmullRomSpline::Save( const char* filename ) const
+{
+	if (!(Alpha() >= 0.0f && Alpha() <= 1.0f)) {
+		return false;
+	}
+	CurveFileHeader header = {};
+	header.mode = mode;
+	header.tessellation = tessellation;
+	header.meshRes = meshRes;
+	header.numDots = numDots;
+	header.alpha = Alpha();
+	header.flatnessTolerance = flatnessTolerance;
+	header.initialVelocity[0] = initialVelocity_X;
+	header.initialVelocity[1] = initialVelocity_Y;
+	header.finalVelocity[0] = finalVelocity_X;
+	header.finalVelocity[1] = finalVelocity_Y;
+	header.numControlPoints = countControlPoints;
+	header.numPointsOnCurve = countPointsOnCurve;
+	int numCurves = HasCurve() ? numDots - 1 : 0;
+	header.numCurves = numCurves;
+
+	std::vector<CurveFile::Chunk> arrays[CurveFileNumArrays];
+	const PointArray pointArrays[3] = { DotArray, ControlPointArray, CurvePointArray };
+	const float* data[3] = { Dots(), ControlPoints(), PointsOnCurve() };
+	const CurveFileArray fileArrays[3] = { CurveFileDots, CurveFileControlPoints, CurveFilePointsOnCurve };
+	for (int k = 0; k < 3; k++) {
+		DirtyRange ranges[2];
+		int numRanges = DrawRanges(pointArrays[k], ranges);
+		if (numRanges == 2) {
+			ranges[1].first++;
+		}
+		for (int j = 0; j < numRanges; j++) {
+			CurveFile::Chunk chunk = { data[k] + 2 * ranges[j].first, ranges[j].Count() * sizeof(Point2) };
+			arrays[fileArrays[k]].push_back(chunk);
+		}
+	}
+	std::vector<int> firsts(numCurves), counts(numCurves);
+	for (int i = 0; i < numCurves; i++) {
+		firsts[i] = meshRes * i;
+		counts[i] = segmentCount[slot(i)];
+	}
+	CurveFile::Chunk firstsChunk = { firsts.data(), numCurves * sizeof(int) };
+	CurveFile::Chunk countsChunk = { counts.data(), numCurves * sizeof(int) };
+	arrays[CurveFileSegmentFirsts].push_back(firstsChunk);
+	arrays[CurveFileSegmentCounts].push_back(countsChunk);
+	return CurveFile::Write(filename, header, arrays);
+}
+
+bool CatmullRomSpline::Load( const CurveFile& file )
+{
+	if (!file.IsOpen()) {
+		return false;
+	}
+	const CurveFileHeader& header = file.Header();
+	numDots = 0;
+	head = 0;
+	maxDots = 0;
+	std::fill(segmentCount.begin(), segmentCount.end(), 0);
+	mode = header.mode;
+	alpha = header.alpha;
+	tessellation = header.tessellation;
+	flatnessTolerance = header.flatnessTolerance;
+	initialVelocity_X = header.initialVelocity[0];
+	initialVelocity_Y = header.initialVelocity[1];
+	finalVelocity_X = header.finalVelocity[0];
+	finalVelocity_Y = header.finalVelocity[1];
+	SetMeshResolution(header.meshRes);	// With no dots, nothing is recomputed
+	Reserve(header.numDots);
+
+	numDots = header.numDots;
+	if (numDots > 0) {
+		memcpy(dotArray.data(), file.Dots(), numDots * sizeof(Point2));
+	}
+	if (file.HasCurve()) {
+		memcpy(controlPoints.data(), file.ControlPoints(), header.numControlPoints * sizeof(Point2));
+		memcpy(pointsOnCurve.data(), file.PointsOnCurve(), header.numPointsOnCurve * sizeof(Point2));
+		memcpy(segmentCount.data(), file.SegmentCounts(), header.numCurves * sizeof(int));
+	}
+	countControlPoints = header.numControlPoints;
+	countPointsOnCurve = header.numPointsOnCurve;
+	updateKnotIntervals(0, numDots - 1);
+	syncWrapEntries();
+	MarkAllDirty();
+	return true;
+}
+
+// Recomputes curves firstCurve, ..., endCurve-1, clamped to the curves that
+//    exist, or clears the curve if there is none.
+void CatmullRomSpline::updateCurves( int firstCurve, int endCurve )
+{
+	if (!HasCurve()) {
+		countControlPoints = 0;
+		countPointsOnCurve = 0;
+		return;
+	}
+	recomputeCurves(Max(firstCurve, 0), Min(endCurve, numDots - 1));
+}
+
+// Recomputes the control points and the points on the curves
+//    firstCurve, ..., endCurve-1, and the last point of the whole curve.
+// The other curves must already be up to date.
+// Each curve writes only the entries of its own slot, so that chunks of
+//    curves can be computed at the same time.  The end of a curve is the
+//    start of the next curve, and the end of the last recomputed curve is
+//    stored here.  All the control points are computed before any of the
+//    curves are tessellated, since a curve's end is in the next slot.
+void CatmullRomSpline::recomputeCurves( int firstCurve, int endCurve )
+{
+	assert( HasCurve() && 0 <= firstCurve && firstCurve <= endCurve && endCurve <= numDots - 1 );
+	if (firstCurve == endCurve) {
+		return;
+	}
+
+	forEachChunk(firstCurve, endCurve, [this]( int first, int end ) {
+		calculateControlPoints(first, end);
+	});
+	controlPoints[3 * slot(endCurve - 1) + 3] = dot(endCurve);
+	countControlPoints = 3 * (numDots - 1) + 1;
+
+	// recalculate the points in Bezier curve
+	forEachChunk(firstCurve, endCurve, [this]( int first, int end ) {
+		storePoints_BezierCurves(first, end);
+	});
+	// add the last point of the whole curve
+	pointsOnCurve[meshRes * slot(numDots - 1)] = dot(numDots - 1);
+	countPointsOnCurve = meshRes * (numDots - 1) + 1;
+
+	markCurvesDirty(firstCurve, endCurve);
+}
+
+// Adds the range [first, end) to range r
+static void mergeRange( CatmullRomSpline::DirtyRange& r, int first, int end )
+{
+	if (r.IsEmpty()) {
+		r.first = first;
+		r.end = end;
+	}
+	else {
+		UpdateMin(first, r.first);
+		UpdateMax(end, r.end);
+	}
+}
+
+void CatmullRomSpline::markDotsDirty( int first, int end )
+{
+	mergeRange(dirtyDots, first, end);
+}
+
+void CatmullRomSpline::markCurvesDirty( int first, int end )
+{
+	if (first >= end) {
+		return;
+	}
+	// Merge with an overlapping range, if any
+	for (int k = 0; k < numDirtyCurves; k++) {
+		if (first <= dirtyCurves[k].end && dirtyCurves[k].first <= end) {
+			mergeRange(dirtyCurves[k], first, end);
+			if (numDirtyCurves == 2 && dirtyCurves[0].first <= dirtyCurves[1].end
+									&& dirtyCurves[1].first <= dirtyCurves[0].end) {
+				mergeRange(dirtyCurves[0], dirtyCurves[1].first, dirtyCurves[1].end);
+				numDirtyCurves = 1;
+			}
+			return;
+		}
+	}
+	if (numDirtyCurves < 2) {
+		dirtyCurves[numDirtyCurves].first = first;
+		dirtyCurves[numDirtyCurves].end = end;
+		numDirtyCurves++;
+		return;
+	}
+	// Merge with the nearer range
+	int gap0 = Max(dirtyCurves[0].first - end, first - dirtyCurves[0].end);
+	int gap1 = Max(dirtyCurves[1].first - end, first - dirtyCurves[1].end);
+	mergeRange(dirtyCurves[gap0 <= gap1 ? 0 : 1], first, end);
+}
+
+int CatmullRomSpline::DirtyEntries( PointArray which, DirtyRange entries[MaxDirtyEntries] ) const
+{
+	// The ranges of dots, control points or curve points that have changed.
+	//   Curve i has control points 3*i, ..., 3*i+3 and curve points
+	//   meshRes*i, ..., meshRes*i+meshRes; the last one is the first point
+	//   of the next curve, or is the last point of the whole curve.
+	DirtyRange ranges[2];
+	int numRanges = 0;
+	if (which == DotArray) {
+		ranges[numRanges++] = dirtyDots;
+	}
+	else {
+		int stride = (which == ControlPointArray) ? 3 : meshRes;
+		for (int k = 0; k < numDirtyCurves; k++) {
+			ranges[numRanges].first = stride * dirtyCurves[k].first;
+			ranges[numRanges].end = stride * dirtyCurves[k].end + 1;
+			numRanges++;
+		}
+	}
+
+	int numEntries = 0;
+	bool hasEntryZero = false;
+	bool hasLastEntry = false;
+	int lastEntry = (which == DotArray) ? capacity
+		: (which == ControlPointArray) ? 3 * capacity : meshRes * capacity;
+	for (int k = 0; k < numRanges; k++) {
+		ranges[k].end = Min(ranges[k].end, count(which));
+		int n = PhysicalRanges(which, ranges[k], entries + numEntries);
+		for (int j = numEntries; j < numEntries + n; j++) {
+			hasEntryZero = hasEntryZero || entries[j].first == 0;
+			hasLastEntry = hasLastEntry || entries[j].end == lastEntry + 1;
+		}
+		numEntries += n;
+	}
+
+	// The last entry repeats entry 0, and each must be loaded with the other.
+	if (hasEntryZero && !hasLastEntry) {
+		entries[numEntries].first = lastEntry;
+		entries[numEntries].end = lastEntry + 1;
+		numEntries++;
+	}
+	else if (hasLastEntry && !hasEntryZero) {
+		entries[numEntries].first = 0;
+		entries[numEntries].end = 1;
+		numEntries++;
+	}
+	return numEntries;
+}
+
+int CatmullRomSpline::DirtyCurves( DirtyRange curves[2] ) const
+{
+	if (!HasCurve()) {
+		curves[0].first = Max(dirtyDots.first - 1, 0);
+		curves[0].end = Min(dirtyDots.end, numDots - 1);
+		return (dirtyDots.IsEmpty() || curves[0].IsEmpty()) ? 0 : 1;
+	}
+	for (int k = 0; k < numDirtyCurves; k++) {
+		curves[k] = dirtyCurves[k];
+	}
+	return numDirtyCurves;
+}
+
+void CatmullRomSpline::ClearDirty()
+{
+	dirtyDots.first = dirtyDots.end = 0;
+	numDirtyCurves = 0;
+}
+
+void CatmullRomSpline::MarkAllDirty()
+{
+	dirtyDots.first = 0;
+	dirtyDots.end = numDots;
+	dirtyCurves[0].first = 0;
+	dirtyCurves[0].end = Max(numDots - 1, 0);
+	numDirtyCurves = 1;
+}
+
+
+// Stores the control points of the i-th Bezier curve, which runs from
+//   dot i to dot i+1.  The control points are laid out as
+//   p0, p0+, p1-, p1, p1+, p2-, p2, ..., so curve i starts at index 3*i.
+void CatmullRomSpline::storeControlPoints( int i, float x1, float y1, float x1_p, float y1_p,
+										   float x2_m, float y2_m, float x2, float y2 )
+{
+	Point2* cp = &controlPoints[3 * slot(i)];
+	cp[0][0] = x1;
+	cp[0][1] = y1;
+	cp[1][0] = x1_p;
+	cp[1][1] = y1_p;
+	cp[2][0] = x2_m;
+	cp[2][1] = y2_m;
+
+	// cp[3] is the next curve's cp[0], except in the last slot, where it is the
+	//    extra entry at the end.  See recomputeCurves.
+	if (slot(i) == capacity - 1) {
+		cp[3][0] = x2;
+		cp[3][1] = y2;
+	}
+}
+
+// The knot interval between two dots at distance d is d^alpha: 1 for
+//    Catmull-Rom, d for chord-length and sqrt(d) for centripetal.
+template<int Mode> inline float CatmullRomSpline::knotInterval( float dx, float dy ) const
+{
+	float d2 = dx * dx + dy * dy;
+	switch (Mode) {
+	case CatmullRom:
+		return 1.0f;
+	case ChordLength:
+		return sqrt(d2);
+	case Centripetal:
+		return sqrt(sqrt(d2));
+	default:
+		return (float)pow(d2, 0.5 * alpha);
+	}
+}
+
+// Recomputes the cached knot intervals firstInterval, ..., endInterval-1.
+//    Interval i, between dot i and dot i+1, is kept in slot(i).
+template<int Mode> void CatmullRomSpline::updateKnotIntervals( int firstInterval, int endInterval )
+{
+	for (int i = firstInterval; i < endInterval; i++) {
+		knotIntervals[slot(i)] = knotInterval<Mode>(dot(i + 1)[0] - dot(i)[0], dot(i + 1)[1] - dot(i)[1]);
+	}
+}
+
+void CatmullRomSpline::updateKnotIntervals( int firstInterval, int endInterval )
+{
+	firstInterval = Max(firstInterval, 0);
+	endInterval = Min(endInterval, numDots - 1);
+	forEachChunk(firstInterval, endInterval, [this]( int first, int end ) {
+		switch (mode) {
+		case CatmullRom:
+			updateKnotIntervals<CatmullRom>(first, end);
+			break;
+		case ChordLength:
+			updateKnotIntervals<ChordLength>(first, end);
+			break;
+		case Centripetal:
+			updateKnotIntervals<Centripetal>(first, end);
+			break;
+		case GeneralAlpha:
+			updateKnotIntervals<GeneralAlpha>(first, end);
+			break;
+		}
+	});
+}
+
+void CatmullRomSpline::calculateControlPoints( int firstCurve, int endCurve )
+{
+	switch (mode) {
+	case CatmullRom:
+		calculateControlPoints<CatmullRom>(firstCurve, endCurve);
+		break;
+	case ChordLength:
+		calculateControlPoints<ChordLength>(firstCurve, endCurve);
+		break;
+	case Centripetal:
+		calculateControlPoints<Centripetal>(firstCurve, endCurve);
+		break;
+	case GeneralAlpha:
+		calculateControlPoints<GeneralAlpha>(firstCurve, endCurve);
+		break;
+	}
+}
+
+// The velocity at each dot is the average of the velocities on the two sides of
+//    the dot, weighted by the knot intervals.  With knot intervals all equal to 1
+//    (Catmull-Rom) this is half the difference of the two neighbouring dots.
+// The knot intervals are read from the cache, so each is computed only once.
+template<int Mode> void CatmullRomSpline::calculateControlPoints( int firstCurve, int endCurve ) {
+	float x1, x2, y1, y2;
+	float x1_p, y1_p, x2_m, y2_m;
+
+	float velocityAtPoint1_X, velocityAtPoint1_Y,
+		velocityAtPoint2_X, velocityAtPoint2_Y;
+
+	// the time interval values: (x0,y0)-(x1,y1), (x1,y1)-(x2,y2) and (x2,y2)-(x3,y3)
+	float timeInterval1_m, timeInterval1_p, timeInterval2_p;
+
+	for (int i = firstCurve; i < endCurve; i++) {
+
+		// (x1, y1), (x2, y2) are the starting and ending control points for one piece of Bezier curve
+		x1 = dot(i)[0];
+		y1 = dot(i)[1];
+
+		x2 = dot(i + 1)[0];
+		y2 = dot(i + 1)[1];
+
+		timeInterval1_p = knotIntervals[slot(i)];
+
+		// calculate the velocity at (x1, y1)
+		if (i == 0) {
+			velocityAtPoint1_X = initialVelocity_X;
+			velocityAtPoint1_Y = initialVelocity_Y;
+		}
+		else if (Mode == CatmullRom) {
+			velocityAtPoint1_X = (x2 - dot(i - 1)[0]) / 2;
+			velocityAtPoint1_Y = (y2 - dot(i - 1)[1]) / 2;
+		}
+		else {
+			float x0 = dot(i - 1)[0];
+			float y0 = dot(i - 1)[1];
+			timeInterval1_m = knotIntervals[slot(i - 1)];
+
+			// weighted average of the velocities on the two sides of (x1, y1)
+			float velocity1_m_half_X = (x1 - x0) / timeInterval1_m;
+			float velocity1_m_half_Y = (y1 - y0) / timeInterval1_m;
+			float velocity1_p_half_X = (x2 - x1) / timeInterval1_p;
+			float velocity1_p_half_Y = (y2 - y1) / timeInterval1_p;
+			float timeInterval1 = timeInterval1_m + timeInterval1_p;
+			velocityAtPoint1_X = ((timeInterval1_m * velocity1_p_half_X) + (timeInterval1_p * velocity1_m_half_X)) / timeInterval1;
+			velocityAtPoint1_Y = ((timeInterval1_m * velocity1_p_half_Y) + (timeInterval1_p * velocity1_m_half_Y)) / timeInterval1;
+		}
+
+		// calculate the velocity at (x2, y2)
+		if (i == numDots - 2) {
+			velocityAtPoint2_X = finalVelocity_X;
+			velocityAtPoint2_Y = finalVelocity_Y;
+		}
+		else if (Mode == CatmullRom) {
+			velocityAtPoint2_X = (dot(i + 2)[0] - x1) / 2;
+			velocityAtPoint2_Y = (dot(i + 2)[1] - y1) / 2;
+		}
+		else {
+			float x3 = dot(i + 2)[0];
+			float y3 = dot(i + 2)[1];
+			timeInterval2_p = knotIntervals[slot(i + 1)];
+
+			// weighted average of the velocities on the two sides of (x2, y2)
+			float velocity2_m_half_X = (x2 - x1) / timeInterval1_p;
+			float velocity2_m_half_Y = (y2 - y1) / timeInterval1_p;
+			float velocity2_p_half_X = (x3 - x2) / timeInterval2_p;
+			float velocity2_p_half_Y = (y3 - y2) / timeInterval2_p;
+			float timeInterval2 = timeInterval1_p + timeInterval2_p;
+			velocityAtPoint2_X = ((timeInterval1_p * velocity2_p_half_X) + (timeInterval2_p * velocity2_m_half_X)) / timeInterval2;
+			velocityAtPoint2_Y = ((timeInterval1_p * velocity2_p_half_Y) + (timeInterval2_p * velocity2_m_half_Y)) / timeInterval2;
+		}
+
+		// pi+
+		x1_p = x1 + (1 / 3.0) * timeInterval1_p * velocityAtPoint1_X;
+		y1_p = y1 + (1 / 3.0) * timeInterval1_p * velocityAtPoint1_Y;
+
+		//p(i+1)-
+		x2_m = x2 - (1 / 3.0) * timeInterval1_p * velocityAtPoint2_X;
+		y2_m = y2 - (1 / 3.0) * timeInterval1_p * velocityAtPoint2_Y;
+
+		storeControlPoints(i, x1, y1, x1_p, y1_p, x2_m, y2_m, x2, y2);
+	}
+}
+
+
+// Stores the points on curve i, starting at index meshRes*i.  The points
+//    are stored as floats, so they are computed in float too.
+void CatmullRomSpline::storePoints_OneBezierCurve( int i, const VectorR2f& p0, const VectorR2f& p1,
+												   const VectorR2f& p2, const VectorR2f& p3 )
+{
+	Point2* points = &pointsOnCurve[meshRes * slot(i)];
+	for (int j = 0; j < meshRes; j++) { // the last point of the curve is not added: it starts the next curve
+		float alpha = (float)j / meshRes;
+		VectorR2f r0 = (1 - alpha) * p0 + alpha * p1;
+		VectorR2f r1 = (1 - alpha) * p1 + alpha * p2;
+		VectorR2f r2 = (1 - alpha) * p2 + alpha * p3;
+
+		VectorR2f t0 = (1 - alpha) * r0 + alpha * r1;
+		VectorR2f t1 = (1 - alpha) * r1 + alpha * r2;
+
+		VectorR2f s0 = (1 - alpha) * t0 + alpha * t1;
+
+		s0.Dump(points[j].data());
+	}
+}
+
+// Forward differencing: the curve is the cubic polynomial
+//    p0 + c*t + b*t^2 + a*t^3, and with step h = 1/meshRes its first, second
+//    and third differences d1, d2, d3 are updated with three vector additions
+//    per point.
+// Each addition can add a rounding error, and an error in d3 grows to
+//    k^3/6 times as much after k steps.  The error after k steps is thus
+//    bounded by roughly k^3 * 8 * DBL_EPSILON times the largest control point
+//    coordinate.  So the differences are recomputed from the polynomial every
+//    ForwardDifferenceSteps points, which bounds the drift by about
+//    2.5e-10 times the size of the curve, far below float precision, no
+//    matter how large meshRes is.  In float the same bound would be about
+//    the size of a pixel, so this stays in double.
+static const int ForwardDifferenceSteps = 64;
+
+void CatmullRomSpline::storePoints_ForwardDifferences( int i, const VectorR2f& p0f, const VectorR2f& p1f,
+													   const VectorR2f& p2f, const VectorR2f& p3f )
+{
+	VectorR2 p0(p0f), p1(p1f), p2(p2f), p3(p3f);
+	VectorR2 a = (p3 - p0) + 3.0 * (p1 - p2);
+	VectorR2 b = 3.0 * (p0 + p2) - 6.0 * p1;
+	VectorR2 c = 3.0 * (p1 - p0);
+	const double h = 1.0 / meshRes;
+
+	Point2* points = &pointsOnCurve[meshRes * slot(i)];
+	for (int start = 0; start < meshRes; start += ForwardDifferenceSteps) {
+		// The point and its differences at t = start*h
+		double t = start * h;
+		VectorR2 point = ((a * t + b) * t + c) * t + p0;
+		VectorR2 d1 = ((3.0 * t * t + 3.0 * t * h + h * h) * h) * a + ((2.0 * t + h) * h) * b + h * c;
+		VectorR2 d2 = ((6.0 * t + 6.0 * h) * h * h) * a + (2.0 * h * h) * b;
+		VectorR2 d3 = (6.0 * h * h * h) * a;
+
+		int end = Min(start + ForwardDifferenceSteps, meshRes);
+		for (int j = start; j < end; j++) { // the last point of the curve is not added: it starts the next curve
+			point.Dump(points[j].data());
+			point += d1;
+			d1 += d2;
+			d2 += d3;
+		}
+	}
+}
+
+// Adaptive tessellation stores the start of each line segment of curve i,
+//    then the end of the curve, and returns the number of points stored.
+// There are at most meshRes line segments.  With meshRes segments the end of
+//    the curve is the next slot's first entry, the start of the next curve,
+//    which is not stored here: see recomputeCurves.
+int CatmullRomSpline::storePoints_Adaptive( int i, const VectorR2f& p0, const VectorR2f& p1,
+											const VectorR2f& p2, const VectorR2f& p3 )
+{
+	Point2* points = &pointsOnCurve[meshRes * slot(i)];
+	int numSegments = subdivide(p0, p1, p2, p3, meshRes, points);
+	if (numSegments < meshRes) {
+		points[numSegments] = controlPoints[3 * slot(i) + 3];
+	}
+	return numSegments + 1;
+}
+
+// Stores the starts of at most maxSegments line segments approximating the
+//    curve, and returns the number of segments.  A curve is flat enough when
+//    u = 3*p1 - 2*p0 - p3 and v = 3*p2 - p0 - 2*p3 satisfy
+//    max(ux^2, vx^2) + max(uy^2, vy^2) <= 16*tolerance^2: this bounds the
+//    distance from the curve to the segment p0-p3, point by point.
+// Otherwise the curve is split in half by de Casteljau's algorithm, and the
+//    segments not used by the first half are left for the second half.
+int CatmullRomSpline::subdivide( const VectorR2f& p0, const VectorR2f& p1, const VectorR2f& p2, const VectorR2f& p3,
+								 int maxSegments, Point2* points ) const
+{
+	VectorR2f u = 3.0f * p1 - 2.0f * p0 - p3;
+	VectorR2f v = 3.0f * p2 - p0 - 2.0f * p3;
+	float flatness = Max(u.x * u.x, v.x * v.x) + Max(u.y * u.y, v.y * v.y);
+	float tolerance = flatnessTolerance;
+	if (maxSegments == 1 || flatness <= 16.0f * tolerance * tolerance) {
+		p0.Dump(points[0].data());
+		return 1;
+	}
+
+	VectorR2f r0 = 0.5f * (p0 + p1);
+	VectorR2f r1 = 0.5f * (p1 + p2);
+	VectorR2f r2 = 0.5f * (p2 + p3);
+	VectorR2f t0 = 0.5f * (r0 + r1);
+	VectorR2f t1 = 0.5f * (r1 + r2);
+	VectorR2f mid = 0.5f * (t0 + t1);
+
+	int numFirst = subdivide(p0, r0, t0, mid, maxSegments / 2, points);
+	return numFirst + subdivide(mid, t1, r2, p3, maxSegments - numFirst, points + numFirst);
+}
+
+void CatmullRomSpline::storePoints_BezierCurves( int firstCurve, int endCurve ) {
+	VectorR2f p0, p1, p2, p3;
+
+	if (tessellation == BernsteinBatch) {
+		// The curves in consecutive slots are evaluated in one batch: their control
+		//    points are 6 floats apart and their points 2*meshRes floats apart.
+		//    A range of curves wraps around the end of the arrays at most once.
+		while (firstCurve < endCurve) {
+			int s = slot(firstCurve);
+			int numCurves = Min(endCurve - firstCurve, capacity - s);
+			const float* cp = controlPoints[3 * s].data();
+			float* points = pointsOnCurve[meshRes * s].data();
+			if (fixedEvaluator != nullptr) {
+				fixedEvaluator(cp, numCurves, points);
+			}
+			else {
+				BezierEvaluate(cp, numCurves, bernsteinWeights.data(), meshRes, points);
+			}
+			std::fill(segmentCount.begin() + s, segmentCount.begin() + s + numCurves, meshRes + 1);
+			firstCurve += numCurves;
+		}
+	}
+
+	for (int i = firstCurve; i < endCurve; i++) {
+		const Point2* cp = &controlPoints[3 * slot(i)];
+		p0.Load(cp[0].data());
+		p1.Load(cp[1].data());
+		p2.Load(cp[2].data());
+		p3.Load(cp[3].data());
+
+		if (tessellation == ForwardDifferencing) {
+			storePoints_ForwardDifferences(i, p0, p1, p2, p3);
+		}
+		else if (tessellation == Adaptive) {
+			segmentCount[slot(i)] = storePoints_Adaptive(i, p0, p1, p2, p3);
+			continue;
+		}
+		else {
+			storePoints_OneBezierCurve(i, p0, p1, p2, p3);
+		}
+		segmentCount[slot(i)] = meshRes + 1;
+	}
+}
@@ -0,0 +1,291 @@
+/*
+ * CatmullRomSpline.h
+ *
+ * Headless spline engine for the ConnectDotsModern program.
+ *
+ * A CatmullRomSpline owns a sequence of dots, the choice of
+ * parametrization (uniform Catmull-Rom, chord-length or centripetal
+ * Overhauser, or knot intervals d^alpha for any alpha), the Bezier
+ * control points computed from the dots and the tessellated points on
+ * the curve.  It has no dependency on OpenGL or GLFW, so it can be used
+ * from batch programs and benchmarks.
+ *
+ * All point arrays are stored as interleaved (x,y) float pairs so that
+ * they can be loaded directly into a VBO.  There is no limit on the
+ * number of dots: the arrays grow geometrically, and Reserve() can be
+ * used to size them up front.
+ *
+ * Edits recompute only the Bezier curves they affect, and the spline keeps
+ * track of which parts of its arrays have changed (see DirtyRange) so that
+ * only those parts need to be loaded into a VBO again.
+ *
+ * The arrays are circular buffers of "slots", one slot per dot.  Slot s
+ * holds a dot, the 3 control points at indices 3*s, 3*s+1, 3*s+2 and the
+ * M = MeshResolution() curve points starting at index M*s, that is, the dot and
+ * the Bezier curve that starts at it.  Dot i is in slot (Head()+i) mod
+ * Capacity(), so removing the first dot, or adding a dot to a curve
+ * limited to MaxDots() dots, takes O(1) time.  Each array has one extra
+ * entry at its end which repeats its entry 0: a curve in the last slot
+ * thus has all 4 control points, and all its points, in consecutive entries.
+ * PhysicalRanges() gives the (at most two) ranges of entries holding a
+ * range of dots, control points or curve points, and DrawRanges() and
+ * DirtyEntries() give the entries to draw and to load into a VBO.
+ *
+ * Each curve depends only on the dots next to it and is stored at a fixed
+ * place in the arrays, so with SetThreadCount() the work of recomputing many
+ * curves at once is split among several threads.
+ *
+ * Software is "as-is" and carries no warranty.  It may be used without
+ *   restriction, but if you modify it, please change the filenames to
+ *   prevent confusion between different versions.
+ */
+
+#ifndef CATMULL_ROM_SPLINE_H
+#define CATMULL_ROM_SPLINE_H
+
+#include <array>
+#include <memory>
+#include <vector>
+#include "LinearR2.h"
+#include "BezierSimd.h"
+
+class CurveFile;
+class ThreadPool;
+
+class CatmullRomSpline {
+
+public:
+	// mode0 - straight lines; mode1 - Catmull_Rom; mode2 - chord-length; mode3 - centripetal;
+	//    mode4 - knot intervals d^alpha for the distance d between dots, for any alpha
+	enum Parametrization { Polyline = 0, CatmullRom = 1, ChordLength = 2, Centripetal = 3, GeneralAlpha = 4 };
+
+	// How the points on each Bezier curve are computed.  The default,
+	//    BernsteinBatch, uses the vector code in BezierSimd.h when available.
+	//    The first three use MeshResolution() points on every curve.  Adaptive
+	//    subdivides each curve until it is within FlatnessTolerance() of its
+	//    points, using at most MeshResolution() line segments per curve.
+	enum Tessellation { DeCasteljau = 0, ForwardDifferencing = 1, BernsteinBatch = 2, Adaptive = 3 };
+
+	enum PointArray { DotArray, ControlPointArray, CurvePointArray };
+
+	// A point on the curve: parameter t, in [0,1], of Bezier curve i
+	struct CurveParameter {
+		int curve;
+		float t;
+	};
+
+	// A range [first, end) of indices into one of the point arrays
+	struct DirtyRange {
+		int first, end;
+		bool IsEmpty() const { return first >= end; }
+		int Count() const { return end - first; }
+	};
+
+	static const int MaxDirtyEntries = 5;	// Most ranges DirtyEntries() can return
+
+	static constexpr int DefaultMeshRes = 20;	// Default number of points on each Bezier curve
+	static constexpr int MaxMeshRes = 4096;		// Largest number, also for curve files
+
+public:
+	CatmullRomSpline();
+	~CatmullRomSpline();
+
+	void SetMode( int newMode );		// Changes the parametrization and recomputes the curve
+	int GetMode() const { return mode; }
+
+	// Sets the mode with knot intervals d^alpha: Catmull-Rom for 0, centripetal
+	//    for 0.5, chord-length for 1 and GeneralAlpha for other values.
+	void SetAlpha( float newAlpha );
+	float Alpha() const;				// The exponent of the current mode
+	bool HasCurve() const { return mode != Polyline && numDots > 1; }
+
+	void SetTessellation( int newTessellation );	// Recomputes the points on the curve
+	int GetTessellation() const { return tessellation; }
+
+	// Largest distance between a curve and its line segments, for Adaptive.
+	void SetFlatnessTolerance( float tolerance );	// Recomputes the points on the curve
+	float FlatnessTolerance() const { return flatnessTolerance; }
+
+	// Number of points on each Bezier curve, from 1 to MaxMeshRes.  8, 16, 20, 32 and 64 use
+	//    compile-time tables of Bernstein weights; other values use a table computed at run time.
+	void SetMeshResolution( int newMeshRes );		// Recomputes the points on the curve
+	int MeshResolution() const { return meshRes; }
+
+	// Velocities at the first and at the last dot.  Default is zero.
+	void SetEndVelocities( float initialX, float initialY, float finalX, float finalY );
+
+	bool AddPoint( float x, float y );	// Returns false if (x,y) repeats the last dot
+	void ChangePoint( int i, float x, float y );	// Recomputes curves i-2, ..., i+1 only
+	void RemoveFirstPoint();			// Constant time
+	void RemoveLastPoint();				// Constant time
+	void Clear();
+
+	// Limits the curve to its last maxDots dots (zero means no limit).  Once the limit
+	//    is reached, AddPoint removes the first dot, in constant time.
+	void SetMaxDots( int maxDots );
+	int MaxDots() const { return maxDots; }
+
+	// Recomputing many curves (Recompute, SetMode, SetMeshResolution, ...) is split
+	//    among numThreads threads, counting the calling thread; 0 uses one thread
+	//    per core.  The default is 1.  The results do not depend on the number of threads.
+	void SetThreadCount( int numThreads );
+	int ThreadCount() const;
+	ThreadPool* Threads() const { return threadPool.get(); }	// nullptr when there is one thread
+
+	void Recompute();					// Recomputes all control points and curve points
+
+	// Writes the curve to a curve file (see CurveFile.h).  Returns false on failure, and
+	//    without writing if Alpha() is outside [0,1], which curve files do not allow.
+	bool Save( const char* filename ) const;
+
+	// Replaces the curve and its settings with those of an open curve file.  The
+	//    arrays are copied and not recomputed.  Clears MaxDots().  Returns false
+	//    if the file is not open.
+	bool Load( const CurveFile& file );
+
+	// The ranges of entries of an array changed since the last call to ClearDirty().
+	//    Returns the number of ranges.
+	int DirtyEntries( PointArray which, DirtyRange entries[MaxDirtyEntries] ) const;
+
+	// The ranges of curves changed since the last call to ClearDirty(), at most two.
+	//    In the Polyline mode these are the lines next to the dots that changed.
+	int DirtyCurves( DirtyRange curves[2] ) const;
+	void ClearDirty();
+	void MarkAllDirty();
+
+	// Storage.  The arrays hold Capacity() dots, with room for their control
+	//    points and curve points, before they need to be reallocated.
+	void Reserve( int numDots );
+	int Capacity() const { return capacity; }
+	int Head() const { return head; }		// Slot of the first dot
+	int DotCapacity() const { return capacity + 1; }	// Number of entries in each array
+	int ControlPointCapacity() const { return 3 * capacity + 1; }
+	int CurvePointCapacity() const { return meshRes * capacity + 1; }
+
+	// Maps a range r of dots, control points or curve points to at most two
+	//    ranges of entries of the array, in order.  Returns the number of ranges.
+	//    Drawing the ranges as line strips draws the whole range as one strip.
+	int PhysicalRanges( PointArray which, DirtyRange r, DirtyRange phys[2] ) const;
+	int DrawRanges( PointArray which, DirtyRange phys[2] ) const;	// All the points
+
+	int NumDots() const { return numDots; }
+	const float* Dot( int i ) const { return dotArray[slot(i)].data(); }
+
+	// The control points are p0, p0+, p1-, p1, p1+, p2-, p2, ...
+	// Curve i runs from dot i to dot i+1; its 4 control points are consecutive.
+	int NumControlPoints() const { return countControlPoints; }
+	const float* CurveControlPoints( int i ) const { return controlPoints[3 * slot(i)].data(); }
+
+	// Copies the 4 control points of curve i, for 0 <= i < NumDots()-1.  In the Polyline
+	//    mode, and before the curve is computed, these are the control points of the
+	//    line segment from dot i to dot i+1, so the lines can be treated as curves.
+	void SegmentControlPoints( int i, float cp[8] ) const;
+
+	// Evaluates the curve at numParams parameters, anywhere on it, instead of at the
+	//    MeshResolution() points of each curve: for each, the position and the first
+	//    derivative with respect to t, as (x,y) pairs, and the signed curvature, which
+	//    is positive where the curve turns left.  Arrays that are nullptr are skipped.
+	//    Parameters on the same curve as the one before them, as in sorted input, reuse
+	//    its control points.  Large batches are split among the threads.
+	void Evaluate( const CurveParameter* params, int numParams,
+				   float* positions, float* derivatives, float* curvatures ) const;
+
+	// MeshResolution() points per Bezier curve, plus the last dot.
+	int NumPointsOnCurve() const { return countPointsOnCurve; }
+	const float* CurvePoints( int i ) const { return pointsOnCurve[meshRes * slot(i)].data(); }
+
+	// The points of curve i, including both its ends, are the SegmentPointCount(i)
+	//    entries starting at CurvePoints(i).  This is MeshResolution()+1 except
+	//    with Adaptive tessellation, where the rest of the curve's slot is unused.
+	int SegmentPointCount( int i ) const { return segmentCount[slot(i)]; }
+
+	// The first entry, and the number of entries, of the curve in each slot, or zero
+	//    if the slot has no curve: Capacity() line strips for glMultiDrawArrays.
+	//    They are valid only if HasCurve().
+	const int* SegmentFirsts() const { return segmentFirst.data(); }
+	const int* SegmentCounts() const { return segmentCount.data(); }
+
+	// The arrays themselves, with DotCapacity(), ControlPointCapacity() and
+	//    CurvePointCapacity() entries respectively.
+	const float* Dots() const { return reinterpret_cast<const float*>(dotArray.data()); }
+	const float* ControlPoints() const { return reinterpret_cast<const float*>(controlPoints.data()); }
+	const float* PointsOnCurve() const { return reinterpret_cast<const float*>(pointsOnCurve.data()); }
+
+private:
+	typedef std::array<float, 2> Point2;	// An (x,y) pair, laid out as two floats
+
+	int slot( int i ) const { int s = head + i; return (s < capacity) ? s : s - capacity; }
+	Point2& dot( int i ) { return dotArray[slot(i)]; }
+
+	void growTo( int newCapacity );
+	void dropFirst();
+	void syncWrapEntries();
+	void markDotsDirty( int first, int end );
+	void markCurvesDirty( int first, int end );
+	int count( PointArray which ) const;
+	void updateCurves( int firstCurve, int endCurve );
+	void recomputeCurves( int firstCurve, int endCurve );
+
+	template<int Mode> float knotInterval( float dx, float dy ) const;
+	template<int Mode> void updateKnotIntervals( int firstInterval, int endInterval );
+	void updateKnotIntervals( int firstInterval, int endInterval );
+
+	// Curve i runs from dot i to dot i+1.  This computes curves firstCurve to endCurve-1,
+	//    for the parametrization Mode.
+	template<int Mode> void calculateControlPoints( int firstCurve, int endCurve );
+	void calculateControlPoints( int firstCurve, int endCurve );
+	void storeControlPoints( int i, float x1, float y1, float x1_p, float y1_p,
+							 float x2_m, float y2_m, float x2, float y2 );
+
+	void storePoints_OneBezierCurve( int i, const VectorR2f& p0, const VectorR2f& p1,
+									 const VectorR2f& p2, const VectorR2f& p3 );
+	void storePoints_ForwardDifferences( int i, const VectorR2f& p0, const VectorR2f& p1,
+										 const VectorR2f& p2, const VectorR2f& p3 );
+	int storePoints_Adaptive( int i, const VectorR2f& p0, const VectorR2f& p1,
+							  const VectorR2f& p2, const VectorR2f& p3 );
+	int subdivide( const VectorR2f& p0, const VectorR2f& p1, const VectorR2f& p2, const VectorR2f& p3,
+				   int maxSegments, Point2* points ) const;
+	void storePoints_BezierCurves( int firstCurve, int endCurve );
+	void setSegmentFirsts();
+
+	// Calls task(first, end) on chunks of [firstCurve, endCurve), on threadPool if any
+	template<class Task> void forEachChunk( int firstCurve, int endCurve, Task task );
+
+private:
+	int mode;
+	float alpha;					// Exponent of the knot intervals for GeneralAlpha
+	int tessellation;
+	int meshRes;					// Number of points on each Bezier curve
+	BezierEvaluator fixedEvaluator;	// For meshRes, or nullptr to use bernsteinWeights
+	std::vector<float> bernsteinWeights;
+	float flatnessTolerance;
+	int numDots;					// Current number of points
+	int capacity;					// Number of dots the arrays have room for
+	int head;						// Slot of dot 0
+	int maxDots;					// Limit on numDots, or zero for no limit
+	std::vector<Point2> dotArray;
+
+	std::vector<Point2> controlPoints;
+	std::vector<Point2> pointsOnCurve;
+
+	int countControlPoints;			// counts the number of elements in the controlPoints array
+	int countPointsOnCurve;			// counts the number of elements in the pointsOnCurve array
+
+	std::vector<int> segmentFirst;	// meshRes*s, for each slot s
+	std::vector<int> segmentCount;	// Entries used by the curve in slot s, or zero
+	std::vector<float> knotIntervals;	// Knot interval from the dot in slot s to the next dot
+
+	// Dots and curves changed since ClearDirty().  Two ranges of curves are
+	//    kept so that, with a rolling window, the first and the last curves
+	//    can change without marking all of the curves in between.
+	DirtyRange dirtyDots;
+	DirtyRange dirtyCurves[2];
+	int numDirtyCurves;
+
+	float initialVelocity_X, initialVelocity_Y;
+	float finalVelocity_X, finalVelocity_Y;
+
+	std::unique_ptr<ThreadPool> threadPool;	// nullptr when there is one thread
+};
+
+#endif	// CATMULL_ROM_SPLINE_H
@@ -39,58 +39,125 @@ bool check_for_opengl_errors();     // Function prototype (should really go in a
 // Enable standard input and output via printf(), etc.
 // Put this include *after* the includes for glew and GLFW!
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 #include <math.h>
-#include "LinearR2.h"
+#include "CatmullRomSpline.h"
+#include "ArcLengthTable.h"
+#include "BezierSimd.h"
+#include "BufferUploader.h"
+#include "CurveBVH.h"
+#include "CurveIntersection.h"
+#include "CurveStroker.h"
+#include "CurveFile.h"
+#include "DotGrid.h"
+#include "FrameTimer.h"
+#include "GlStateCache.h"
+#include "HeadlessContext.h"
+#include "SceneScript.h"
 
-#define MeshRes 20 // number of the points on each Bezier curve
-#define numOfArrays 4 // number of VBO vetertexes need to be generated 
 // ********************
 // Animation controls and state infornation
 // ********************
 
- 
-
-constexpr int MaxNumDots = 100;     // Maximum allowed number of dots
-int NumDots = 0;                    // Currenmbt number of points
-float dotArray[MaxNumDots][2];
-
+CatmullRomSpline theCurve;          // The dots, the control points and the points on the curve
+constexpr int InitialNumDots = 100; // Initial room for dots; the storage grows as needed
+constexpr int LiveTraceNumDots = 100;   // Number of dots kept in "live trace" mode
+const char* const TessellationNames[] = { "de Casteljau", "forward differencing", "batched", "adaptive" };
+const char* curveFileName = "ConnectDots.curve";	// Or the file named on the command line
+
+// Animation of a marker moving along the curve at constant speed
+ArcLengthTable arcLengths;          // Built again when the curve has changed
+bool arcLengthsValid = false;
+bool animating = false;
+double animationStart;              // Time at which the marker was at the start of the curve
+ArcLengthTable::Location markerLocation = { 0, 0.0f };
+constexpr double MarkerSpeed = 0.5; // Distance per second; the window is 2 units wide
+
+// Snapping: a marker shows the point on the curve nearest the cursor
+CurveBVH curveBVH;                  // Refit when a dot is moved, built again after other changes
+bool curveBVHValid = false;
+bool snapping = false;
+float cursorX, cursorY;             // Position of the cursor, in the coordinates of the dots
 
 int windowWidth, windowHeight;
 
 int selectedVert = -1;          // Either currently selected vertex or -1 (none selected)
+constexpr float PickPixels = 4.0f;  // A right click selects the nearest dot within this many pixels
+DotGrid dotGrid;                    // The dots of theCurve, for picking; updated with each edit
 
-float controlPoints[3 * (MaxNumDots - 1) + 1][2];
-
-float pointsOnCurve [MeshRes * (MaxNumDots - 1) + 1][2]; // in this arrray, it doesn't count the point of the p0 to pn
-
-int countControlPoins = 0; // countControlPoins counts the number of elements in the controlPoints array
-int countPointsOnCurve = 0; // countPointsOnCurve counts the number of elements in the pointsOnCurve array
-
-float initialVelocity_X = 0.0;
-float finalVelocity_X = -0.0;
+// The curve, or the lines between the dots, is drawn as triangle strips this many pixels wide
+CurveStroker curveStroke;           // Updated with the curve, before its dirty ranges are cleared
+constexpr float StrokePixels = 5.0f;
 
-float initialVelocity_Y = 0.0;
-float finalVelocity_Y = -0.0;
-
-float alpha = 0.5; // the constant of linear interpolatation
-
-//int countRecursion = 0; 
+int showingControlPoints = 0; 
+constexpr float PointPixels = 8.0f;     // Diameter of the dots, control points and points on the curve
+constexpr float MarkerPixels = 14.0f;   // Diameter of the markers
 
-int mode; // mode1 - Catmull_Rom; mode2 -chord-length; mode3 - centripetal 
+// ************************
+// Frame scheduling.
+// The input callbacks do not change theCurve: they record their edits in pendingEdits.
+//    Once per frame, just before myRenderScene(), UpdateFrame() makes the edits, in
+//    the order of the events, and loads the changes into the VBO.  So the curve is
+//    recomputed at most once per frame for each edit, and all of the cursor events
+//    of a drag that arrive during a frame make one update, to the last position.
+//    The keys that read the curve ('i' and 's') and picking a dot make the pending
+//    edits first.  A frame is drawn only when something has changed, or while the
+//    marker is animated, and frames start at least frameBudget seconds apart.
+// ************************
 
-int showingControlPoints = 0; 
+// An edit of theCurve, made by UpdateFrame().  The keys that step a setting record
+//    the step, so that several presses in one frame add up.
+enum EditKind { AddDot, DragDot, RemoveFirstDot, RemoveLastDot, ToggleLiveTrace, ChooseMode,
+                NextTessellation, StepMeshRes, StepAlpha, SetTolerance, LoadFile };
+struct CurveEdit {
+	EditKind kind;
+	int value;                    // The dot for DragDot and RemoveLastDot, the mode, or the step
+	float x, y;                   // The position for AddDot and DragDot; x is the tolerance for SetTolerance
+};
+std::vector<CurveEdit> pendingEdits;
+
+bool vboStale = false;            // theCurve or curveStroke has changes not yet loaded into the VBO
+bool redrawNeeded = true;         // The window no longer shows the scene
+int swapInterval = 1;             // Screen refreshes per buffer swap; 0 turns off vsync.  "-vsync n"
+double frameBudget = 1.0 / 60.0;  // Least time between the starts of frames, in seconds.  "-budget milliseconds"
+
+// A headless replay draws the frames of a script into a framebuffer object, with no window.
+//    Its clock advances frameBudget per frame, so its images do not depend on how fast
+//    the frames are drawn.
+const char* sceneFileName = nullptr;  // The script.  "-headless script"
+bool recordingImages = false;     // Write the images of the script instead of comparing them.  "-record"
+double replayTime = 0.0;
+
+// The time in seconds, for the animation
+double Now() {
+	return (sceneFileName != nullptr) ? replayTime : glfwGetTime();
+}
 
 // ************************
 // General data helping with setting up VAO (Vertex Array Objects)
 //    and Vertex Buffer Objects.
+// All of the arrays are ranges of one VBO, read through one VAO, so a frame binds
+//    them at most once, and draws the lines and the points with glMultiDrawArrays.
 // ***********************
 
-//unsigned int myVBO;  // Vertex Buffer Object - holds an array of data
-//unsigned int myVAO;  // Vertex Array Object - holds info about an array of vertex data;
-
-unsigned int myVBO[numOfArrays];  // a Vertex Buffer Object holds an array of data
-unsigned int myVAO[numOfArrays];  // a Vertex Array Object - holds info about an array of vertex data;
+// The ranges of the VBO: the arrays of theCurve, in the order of CatmullRomSpline::PointArray,
+//    the triangle strips of curveStroke, and a point for each marker.
+enum VboRange { DotRange, ControlPointRange, CurvePointRange, StrokeRange, MarkerRange, NumVboRanges };
+enum Marker { AnimationMarker, SnapMarker, NumMarkers };
+int vboFirst[NumVboRanges + 1];   // The first vertex of each range, and the number of vertices
+
+unsigned int myVBO;               // a Vertex Buffer Object holds an array of data
+unsigned int myVAO;               // a Vertex Array Object - holds info about an array of vertex data;
+BufferUploader vboUpload;         // Makes and loads the VBO
+GlStateCache glState;             // Skips the GL calls that would not change the state, and counts them
+std::vector<int> segmentFirsts;   // theCurve.SegmentFirsts(), as vertices of the VBO
+std::vector<int> stripFirsts;     // curveStroke.StripFirsts(), as vertices of the VBO
+bool reportingFrames = false;     // Print the bytes loaded and the GL calls per frame, once a second
+int vboCapacity = 0;              // Number of dots the VBO has room for
+int vboMeshRes = 0;               // Number of points per Bezier curve the VBO has room for
+int strokeVboCapacity = 0;        // Number of vertices of curveStroke the VBO has room for
 
 // We create one shader program: it consists of a vertex shader and a fragment shader
 unsigned int shaderProgram1;
@@ -100,11 +167,13 @@ const unsigned int vertColor_loc = 1; // Corresponds to "location = 1" in the ve
 
 
 // function declaration 
-//void rerangePointsOnCurveArray_increasing(int startingIndex, int endingIndex);
 void renderCurve();
-void RemoveFirstPoint();
 void renderControlPoints();
+void renderMarker();
+void renderSnapPoint();
+void drawMarker(const float marker[2], Marker which);
 void  myRenderScene();
+void LoadPointsIntoVBO();
 
 // *************************
 // mySetupGeometries defines the scene data, especially vertex  positions and colors.
@@ -118,683 +187,316 @@ void mySetupGeometries() {
 	//   ModelView matrices. Hence, all x, y, z positions
 	//   should be in the range [-1,1].
 
-    // Allocate Vertex Array Objects (VAOs) and Vertex Buffer Objects (VBOs).
-    glGenVertexArrays(numOfArrays, &myVAO[0]);
-    glGenBuffers(numOfArrays, &myVBO[0]);
-
-    // Bind (and initialize) the Vertex Array Object and Vertex Buffer Object
-    // The glBufferData command allocates space in the VBO for the vertex data, but does
-    //    not any data into the VBO.  For this, the third parameter is the null pointer, (void*)0.
-    // The VBO will hold only the vertex positions.  The color will be a generic attribute.
-    glBindVertexArray(myVAO[0]);
-    glBindBuffer(GL_ARRAY_BUFFER, myVBO[0]);
-    glBufferData(GL_ARRAY_BUFFER, MaxNumDots*2*sizeof(float), (void*)0, GL_STATIC_DRAW);
-    glVertexAttribPointer(vertPos_loc, 2, GL_FLOAT, GL_FALSE, 2*sizeof(float), (void*)0);	
-    glEnableVertexAttribArray(vertPos_loc);									                
-
-	glBindBuffer(GL_ARRAY_BUFFER, 0);  
-	glBindVertexArray(0);
-
-
-	// Bind VAO, VBO for array controlPoints
-	glBindVertexArray(myVAO[1]);
-	glBindBuffer(GL_ARRAY_BUFFER, myVBO[1]);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(controlPoints), (void*)0, GL_STATIC_DRAW);
-	glVertexAttribPointer(vertPos_loc, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0); 
-	glEnableVertexAttribArray(vertPos_loc);
-
-	glBindBuffer(GL_ARRAY_BUFFER, 0);   
-	glBindVertexArray(0);
-
+    // Allocate the Vertex Array Object (VAO).  The VBO is made by LoadPointsIntoVBO()
+    //    below, which attaches it to the VAO, and holds only the vertex positions.
+    //    The color will be a generic attribute.
+    glGenVertexArrays(1, &myVAO);
 
-	// Bind VAO, VBO for array pointsOnCurve
-	glBindVertexArray(myVAO[2]);
-	glBindBuffer(GL_ARRAY_BUFFER, myVBO[2]);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(pointsOnCurve), (void*)0, GL_STATIC_DRAW);
-	glVertexAttribPointer(vertPos_loc, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0); 
-	glEnableVertexAttribArray(vertPos_loc);
-
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindVertexArray(0);
+	theCurve.Reserve(InitialNumDots);
+	theCurve.SetThreadCount(0);		// One thread per core for recomputing the whole curve
+	LoadPointsIntoVBO();
 
     check_for_opengl_errors();  
 }
 
 
-void calculateControlPoints_CatMull_Rom() {
-	float x1, x2, x3, y1, y2, y3;
-	float x1_p = 0, y1_p = 0, x2_m = 0, y2_m = 0;
-	float velocityAtPoint1_X, velocityAtPoint1_Y, 
-		velocityAtPoint2_X, velocityAtPoint2_Y;
-
-	for (int i = 0; i <= NumDots - 2; i++) {
-		
-		// (x1, y1), (x2, y2) are the starting and ending control points for one piece of Bezier curve 
-		x1 = dotArray[i][0];
-		y1 = dotArray[i][1];
-
-		x2 = dotArray[i + 1][0];
-		y2 = dotArray[i + 1][1];
-
-		x3 = dotArray[i + 2][0];
-		y3 = dotArray[i + 2][1];
-
-		// drawing the first Bezier curve
-		if (i == 0) {
-
-			// calculate the velocity
-			velocityAtPoint1_X = initialVelocity_X;
-			velocityAtPoint1_Y = initialVelocity_Y;
-			velocityAtPoint2_X = (x3 - x1) / 2;
-			velocityAtPoint2_Y = (y3 - y1) / 2;
-		}
-		else if (i == NumDots - 2) {
-			float x0 = dotArray[i - 1][0];
-			float y0 = dotArray[i - 1][1];
-
-			// calculate the velocity 
-			velocityAtPoint1_X = (x2 - x0) / 2;
-			velocityAtPoint1_Y = (y2 - y0) / 2;
-			velocityAtPoint2_X = finalVelocity_X;
-			velocityAtPoint2_Y = finalVelocity_Y;
-		}
-		else {
-			float x0 = dotArray[i - 1][0];
-			float y0 = dotArray[i - 1][1];
-			// calculate the velocity 
-			velocityAtPoint1_X = (x2 - x0) / 2;
-			velocityAtPoint1_Y = (y2 - y0) / 2;
-			velocityAtPoint2_X = (x3 - x1) / 2;
-			velocityAtPoint2_Y = (y3 - y1) / 2;
-		}
-		
-		// calculating the x, y coordinates for the pi, pi+, p(i+1), (i+1)- 
-		// pi is x1
-
-		// pi+
-		x1_p = x1 + 1 / 3.0 * velocityAtPoint1_X;
-		y1_p = y1 + 1 / 3.0 * velocityAtPoint1_Y;
-
-		//p(i+1) is x2
-
-		//p(i+1)-
-		x2_m = x2 - 1 / 3.0 * velocityAtPoint2_X;
-		y2_m = y2 - 1 / 3.0 * velocityAtPoint2_Y;
-
-		
-		// ewven though it iterates through all of the points 
-		// but it should not all of the points in each iteration 
-		if (i == 0) {
-
-			// add vectors to array
-			controlPoints[countControlPoins][0] = x1;
-			controlPoints[countControlPoins++][1] = y1;
-
-			controlPoints[countControlPoins][0] = x1_p;
-			controlPoints[countControlPoins++][1] = y1_p;
-
-			controlPoints[countControlPoins][0] = x2_m;
-			controlPoints[countControlPoins++][1] = y2_m;
-
-			controlPoints[countControlPoins][0] = x2;
-			controlPoints[countControlPoins++][1] = y2;
-		}
-		else {
-			controlPoints[countControlPoins][0] = x1_p;
-			controlPoints[countControlPoins++][1] = y1_p;
-
-			controlPoints[countControlPoins][0] = x2_m;
-			controlPoints[countControlPoins++][1] = y2_m;
-
-			controlPoints[countControlPoins][0] = x2;
-			controlPoints[countControlPoins++][1] = y2;
-		}
+// *************************
+// AllocateVBO sizes the VBO to match the capacity of theCurve and of curveStroke,
+//    and attaches it to the VAO.
+// The VBO is persistently mapped when the OpenGL version allows it, and is
+//    otherwise a GL_DYNAMIC_DRAW buffer, since it changes as the dots are moved.
+//    It may be a new buffer object (see BufferUploader.h), and all of it must
+//    be loaded again.
+// The storage of theCurve grows geometrically, so this is called only
+//    O(log n) times while n dots are added.
+// *************************
+void AllocateVBO() {
+	vboCapacity = theCurve.Capacity();
+	vboMeshRes = theCurve.MeshResolution();
+	strokeVboCapacity = curveStroke.VertexCapacity();
+
+	const int numVertices[NumVboRanges] = { theCurve.DotCapacity(), theCurve.ControlPointCapacity(),
+											theCurve.CurvePointCapacity(), strokeVboCapacity, NumMarkers };
+	vboFirst[0] = 0;
+	for (int k = 0; k < NumVboRanges; k++) {
+		vboFirst[k + 1] = vboFirst[k] + numVertices[k];
+	}
+	vboUpload.Allocate(vboFirst[NumVboRanges] * 2 * sizeof(float));
+	myVBO = vboUpload.Buffer();
+	static const float noMarkers[2 * NumMarkers] = {};
+	vboUpload.Write(vboFirst[MarkerRange] * 2 * sizeof(float), sizeof(noMarkers), noMarkers);
+
+	glState.BindVertexArray(myVAO);
+	glBindBuffer(GL_ARRAY_BUFFER, myVBO);
+	glVertexAttribPointer(vertPos_loc, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+	glEnableVertexAttribArray(vertPos_loc);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
 
-		if (countControlPoins > (MaxNumDots - 1) * 3 + 1) {
-			countControlPoins = (MaxNumDots - 1) * 3 + 1;
-		}
+	// The strips of the curve and of the stroke start at fixed places in their ranges
+	segmentFirsts.resize(theCurve.Capacity());
+	for (int s = 0; s < theCurve.Capacity(); s++) {
+		segmentFirsts[s] = vboFirst[CurvePointRange] + theCurve.SegmentFirsts()[s];
 	}
-	
+	stripFirsts.resize(curveStroke.NumStrips());
+	for (int s = 0; s < curveStroke.NumStrips(); s++) {
+		stripFirsts[s] = vboFirst[StrokeRange] + curveStroke.StripFirsts()[s];
+	}
+	check_for_opengl_errors();
 }
 
 
-void calculateControlPoints_Chord() {
-	float x1, x2, x3, y1, y2, y3;
-	float x1_p = 0, y1_p = 0, x2_m = 0, y2_m = 0;
-
-	float velocity1_m_half_X, velocity1_m_half_Y,
-		velocity1_p_half_X, velocity1_p_half_Y;
-
-	float velocity2_m_half_X, velocity2_m_half_Y,
-		velocity2_p_half_X, velocity2_p_half_Y;
-
-	float velocityAtPoint1_X, velocityAtPoint1_Y,
-		velocityAtPoint2_X, velocityAtPoint2_Y;
-
-	float timeInterval2_m = 1, timeInterval2_p = 1, timeInterval2,
-		timeInterval1_m = 1, timeInterval1_p = 1, timeInterval1; // the time interval value
-
-	for (int i = 0; i <= NumDots - 2; i++) {
-
-		// (x1, y1), (x2, y2) are the starting and ending control points for one piece of Bezier curve 
-		x1 = dotArray[i][0];
-		y1 = dotArray[i][1];
-
-		x2 = dotArray[i + 1][0];
-		y2 = dotArray[i + 1][1];
-
-		x3 = dotArray[i + 2][0];
-		y3 = dotArray[i + 2][1];
-
-		// those are the time interval value regrading p2(x2, y2) as the pi,
-		//p1(x1, x1) as p(i-1), and p3(x3, y3) as p(i+1)
-		timeInterval2_m = sqrt((x2 - x1) * (x2 - x1) + (y2 - y1) * (y2 - y1));
-		timeInterval2_p = sqrt((x2 - x3) * (x2 - x3) + (y2 - y3) * (y2 - y3));
-		timeInterval2 = sqrt((x3 - x1) * (x3 - x1) + (y3 - y1) * (y3 - y1));
-
-		// drawing the first Bezier curve
-		if (i == 0) {
-
-			// calculate the velocity for the starting point
-			velocityAtPoint1_X = initialVelocity_X;
-			velocityAtPoint1_Y = initialVelocity_Y;
-
-			// following steps are the process of calculating the velocity at point (x2, y2)
-			// calculate velocity2_m_half
-			velocity2_m_half_X = (x2 - x1) / timeInterval2_m;
-			velocity2_m_half_Y = (y2 - y1) / timeInterval2_m;
-
-			// calculate velocity2_p_half
-			velocity2_p_half_X = (x3 - x2) / timeInterval2_p;
-			velocity2_p_half_Y = (y3 - y2) / timeInterval2_p;
-
-			// calculate the real velocity at point (x2, y2)
-			velocityAtPoint2_X = ( (timeInterval2_m * velocity2_p_half_X) + (timeInterval2_p * velocity2_m_half_X) ) / timeInterval2;
-			velocityAtPoint2_Y = ( (timeInterval2_m * velocity2_p_half_Y) + (timeInterval2_p * velocity2_m_half_Y) ) / timeInterval2;
-
-		}
-		else if (i == NumDots - 2) {
-			// introducing p0 for calculating the velocity at P1(x1, y1)
-			float x0 = dotArray[i - 1][0];
-			float y0 = dotArray[i - 1][1];
-
-			// those are the time interval value regrading p1(x1, y1) as the pi,
-			//p0(x0, x0) as p(i-1), and p2(x2, y2) as p(i+1)
-			timeInterval1_m = sqrt((x1 - x0) * (x1 - x0) + (y1 - y0) * (y1 - y0));
-			timeInterval1_p = sqrt((x2 - x1) * (x2 - x1) + (y2 - y1) * (y2 - y1));
-			//timeInterval1 = sqrt((x2 - x0) * (x2 - x0) + (y2 - y0) * (y2 - y0));   wrong!!!!!!
-			timeInterval1 = timeInterval1_m + timeInterval1_p;
-
-			// calculate the velocityAtP2  
-			velocityAtPoint2_X = finalVelocity_X;
-			velocityAtPoint2_Y = finalVelocity_Y;
-
-			// following steps are the process of calculating the velocity at point (x1, y1)
-			// calculate velocity1_m_half
-			velocity1_m_half_X = (x1 - x0) / timeInterval2_m;
-			velocity1_m_half_Y = (y1 - y0) / timeInterval2_m;
-
-			// calculate velocity1_p_half
-			velocity1_p_half_X = (x2 - x1) / timeInterval2_p;
-			velocity1_p_half_Y = (y2 - y1) / timeInterval2_p;
-
-			// calculate the real velocity at point (x1, y1)
-			velocityAtPoint1_X = ((timeInterval1_m * velocity1_p_half_X) + (timeInterval1_p * velocity1_m_half_X)) / timeInterval1;
-			velocityAtPoint1_Y = ((timeInterval1_m * velocity1_p_half_Y) + (timeInterval1_p * velocity1_m_half_Y)) / timeInterval1;
-
-		}
-		else {
-			// introducing p0 for calculating the velocity at P1(x1, y1)
-			float x0 = dotArray[i - 1][0];
-			float y0 = dotArray[i - 1][1];
-
-			// those are the time interval value regrading p1(x1, y1) as the pi,
-			//p0(x0, x0) as p(i-1), and p2(x2, y2) as p(i+1)
-			timeInterval1_m = sqrt((x1 - x0) * (x1 - x0) + (y1 - y0) * (y1 - y0));
-			timeInterval1_p = sqrt((x2 - x1) * (x2 - x1) + (y2 - y1) * (y2 - y1));
-			//timeInterval1 = sqrt((x2 - x0) * (x2 - x0) + (y2 - y0) * (y2 - y0));  worng!!!!!!!!
-			timeInterval1 = timeInterval1_m + timeInterval1_p;
-
-			// following steps are the process of calculating the velocity at point (x1, y1)
-			// calculate velocity1_m_half
-			velocity1_m_half_X = (x1 - x0) / timeInterval2_m;
-			velocity1_m_half_Y = (y1 - y0) / timeInterval2_m;
-
-			// calculate velocity1_p_half
-			velocity1_p_half_X = (x2 - x1) / timeInterval2_p;
-			velocity1_p_half_Y = (y2 - y1) / timeInterval2_p;
-
-			// calculate the real velocity at point (x1, y1)
-			velocityAtPoint1_X = ((timeInterval1_m * velocity1_p_half_X) + (timeInterval1_p * velocity1_m_half_X)) / timeInterval1;
-			velocityAtPoint1_Y = ((timeInterval1_m * velocity1_p_half_Y) + (timeInterval1_p * velocity1_m_half_Y)) / timeInterval1;
-
-
-
-			// following steps are the process of calculating the velocity at point (x2, y2)
-			// calculate velocity2_m_half
-			velocity2_m_half_X = (x2 - x1) / timeInterval2_m;
-			velocity2_m_half_Y = (y2 - y1) / timeInterval2_m;
-
-			// calculate velocity2_p_half
-			velocity2_p_half_X = (x3 - x2) / timeInterval2_p;
-			velocity2_p_half_Y = (y3 - y2) / timeInterval2_p;
-
-			// calculate the real velocity at point (x2, y2)
-			velocityAtPoint2_X = ((timeInterval2_m * velocity2_p_half_X) + (timeInterval2_p * velocity2_m_half_X)) / timeInterval2;
-			velocityAtPoint2_Y = ((timeInterval2_m * velocity2_p_half_Y) + (timeInterval2_p * velocity2_m_half_Y)) / timeInterval2;
-		}
-
-		// calculating the x, y coordinates for the pi, pi+, p(i+1), (i+1)- 
-		// pi is x1
-
-		// pi+
-		x1_p = x1 + (1 / 3.0) * timeInterval1_p * velocityAtPoint1_X;
-		y1_p = y1 + (1 / 3.0) * timeInterval1_p * velocityAtPoint1_Y;
-
-		//p(i+1) is x2
-
-		//p(i+1)-
-		x2_m = x2 - (1 / 3.0) * timeInterval2_m * velocityAtPoint2_X;
-		y2_m = y2 - (1 / 3.0) * timeInterval2_m * velocityAtPoint2_Y;
-
-
-
-
-		/*Is it ok to use timeInterval1_p = 1 for the first case?*/
-
-
-		// ewven though it iterates through all of the points 
-		// but it should not all of the points in each iteration 
-		if (i == 0) {
-
-			controlPoints[countControlPoins][0] = x1;
-			controlPoints[countControlPoins++][1] = y1;
-
-			controlPoints[countControlPoins][0] = x1_p;
-			controlPoints[countControlPoins++][1] = y1_p;
-
-			controlPoints[countControlPoins][0] = x2_m;
-			controlPoints[countControlPoins++][1] = y2_m;
-
-			controlPoints[countControlPoins][0] = x2;
-			controlPoints[countControlPoins++][1] = y2;
-		}
-		else {
-
-			controlPoints[countControlPoins][0] = x1_p;
-			controlPoints[countControlPoins++][1] = y1_p;
-
-			controlPoints[countControlPoins][0] = x2_m;
-			controlPoints[countControlPoins++][1] = y2_m;
-
-			controlPoints[countControlPoins][0] = x2;
-			controlPoints[countControlPoins++][1] = y2;
-		}
-
-		if (countControlPoins > (MaxNumDots - 1) * 3 + 1) {
-			countControlPoins = (MaxNumDots - 1) * 3 + 1;
-		}
-
+// Loads the changed entries of range which of the VBO at the next vboUpload.Flush().
+//    data holds the whole range.
+void LoadDirtyIntoVBO(VboRange which, const CatmullRomSpline::DirtyRange* entries, int numEntries, const float* data)
+{
+	for (int k = 0; k < numEntries; k++) {
+		vboUpload.Write((vboFirst[which] + entries[k].first) * 2 * sizeof(float),
+						entries[k].Count() * 2 * sizeof(float), data + 2 * entries[k].first);
 	}
-
 }
 
+// Loads the changed entries of one of theCurve's arrays into its range of the VBO.
+void LoadDirtyIntoVBO(CatmullRomSpline::PointArray which, const float* data)
+{
+	CatmullRomSpline::DirtyRange entries[CatmullRomSpline::MaxDirtyEntries];
+	int numEntries = theCurve.DirtyEntries(which, entries);
+	LoadDirtyIntoVBO((VboRange)which, entries, numEntries, data);
+}
 
-
-
-void calculateControlPoints_Centrpetal() {
-	float x1, x2, x3, y1, y2, y3;
-	float x1_p = 0, y1_p = 0, x2_m = 0, y2_m = 0;
-
-	float velocity1_m_half_X, velocity1_m_half_Y,
-		velocity1_p_half_X, velocity1_p_half_Y;
-
-	float velocity2_m_half_X, velocity2_m_half_Y,
-		velocity2_p_half_X, velocity2_p_half_Y;
-
-	float velocityAtPoint1_X, velocityAtPoint1_Y,
-		velocityAtPoint2_X, velocityAtPoint2_Y;
-
-	float timeInterval2_m = 1, timeInterval2_p = 1, timeInterval2,
-		timeInterval1_m = 1, timeInterval1_p = 1, timeInterval1; // the time interval value
-
-	for (int i = 0; i <= NumDots - 2; i++) {
-
-		// (x1, y1), (x2, y2) are the starting and ending control points for one piece of Bezier curve 
-		x1 = dotArray[i][0];
-		y1 = dotArray[i][1];
-
-		x2 = dotArray[i + 1][0];
-		y2 = dotArray[i + 1][1];
-
-		x3 = dotArray[i + 2][0];
-		y3 = dotArray[i + 2][1];
-
-		// those are the time interval value regrading p2(x2, y2) as the pi,
-		//p1(x1, x1) as p(i-1), and p3(x3, y3) as p(i+1)
-		timeInterval2_m = sqrt( sqrt((x2 - x1) * (x2 - x1) + (y2 - y1) * (y2 - y1)) );
-		timeInterval2_p = sqrt( sqrt((x2 - x3) * (x2 - x3) + (y2 - y3) * (y2 - y3)) );
-		//timeInterval2 = sqrt( sqrt((x3 - x1) * (x3 - x1) + (y3 - y1) * (y3 - y1)) );   worng!!!!!!!
-		timeInterval2 = timeInterval2_m + timeInterval2_p;
-
-		// drawing the first Bezier curve
-		if (i == 0) {
-
-			// calculate the velocity for the starting point
-			velocityAtPoint1_X = initialVelocity_X;
-			velocityAtPoint1_Y = initialVelocity_Y;
-
-			// following steps are the process of calculating the velocity at point (x2, y2)
-			// calculate velocity2_m_half
-			velocity2_m_half_X = (x2 - x1) / timeInterval2_m;
-			velocity2_m_half_Y = (y2 - y1) / timeInterval2_m;
-
-			// calculate velocity2_p_half
-			velocity2_p_half_X = (x3 - x2) / timeInterval2_p;
-			velocity2_p_half_Y = (y3 - y2) / timeInterval2_p;
-
-			// calculate the real velocity at point (x2, y2)
-			velocityAtPoint2_X = ((timeInterval2_m * velocity2_p_half_X) + (timeInterval2_p * velocity2_m_half_X)) / timeInterval2;
-			velocityAtPoint2_Y = ((timeInterval2_m * velocity2_p_half_Y) + (timeInterval2_p * velocity2_m_half_Y)) / timeInterval2;
-
-		}
-		else if (i == NumDots - 2) {
-			// introducing p0 for calculating the velocity at P1(x1, y1)
-			float x0 = dotArray[i - 1][0];
-			float y0 = dotArray[i - 1][1];
-
-			// those are the time interval value regrading p1(x1, y1) as the pi,
-			//p0(x0, x0) as p(i-1), and p2(x2, y2) as p(i+1)
-			timeInterval1_m = sqrt( sqrt((x1 - x0) * (x1 - x0) + (y1 - y0) * (y1 - y0)) );
-			timeInterval1_p = sqrt( sqrt((x2 - x1) * (x2 - x1) + (y2 - y1) * (y2 - y1)) );
-			//timeInterval1 = sqrt( sqrt((x2 - x0) * (x2 - x0) + (y2 - y0) * (y2 - y0)) );
-			timeInterval1 = timeInterval1_m + timeInterval1_p;
-
-			// calculate the velocityAtP2  
-			velocityAtPoint2_X = finalVelocity_X;
-			velocityAtPoint2_Y = finalVelocity_Y;
-
-			// following steps are the process of calculating the velocity at point (x1, y1)
-			// calculate velocity1_m_half
-			velocity1_m_half_X = (x1 - x0) / timeInterval2_m;
-			velocity1_m_half_Y = (y1 - y0) / timeInterval2_m;
-
-			// calculate velocity1_p_half
-			velocity1_p_half_X = (x2 - x1) / timeInterval2_p;
-			velocity1_p_half_Y = (y2 - y1) / timeInterval2_p;
-
-			// calculate the real velocity at point (x1, y1)
-			velocityAtPoint1_X = ((timeInterval1_m * velocity1_p_half_X) + (timeInterval1_p * velocity1_m_half_X)) / timeInterval1;
-			velocityAtPoint1_Y = ((timeInterval1_m * velocity1_p_half_Y) + (timeInterval1_p * velocity1_m_half_Y)) / timeInterval1;
-
-		}
-		else {
-			// introducing p0 for calculating the velocity at P1(x1, y1)
-			float x0 = dotArray[i - 1][0];
-			float y0 = dotArray[i - 1][1];
-
-			// those are the time interval value regrading p1(x1, y1) as the pi,
-			//p0(x0, x0) as p(i-1), and p2(x2, y2) as p(i+1)
-			timeInterval1_m = sqrt( sqrt((x1 - x0) * (x1 - x0) + (y1 - y0) * (y1 - y0)) );
-			timeInterval1_p = sqrt( sqrt((x2 - x1) * (x2 - x1) + (y2 - y1) * (y2 - y1)) );
-			//timeInterval1 = sqrt( sqrt((x2 - x0) * (x2 - x0) + (y2 - y0) * (y2 - y0)) );
-			timeInterval1 = timeInterval1_m + timeInterval1_p;
-
-			// following steps are the process of calculating the velocity at point (x1, y1)
-			// calculate velocity1_m_half
-			velocity1_m_half_X = (x1 - x0) / timeInterval2_m;
-			velocity1_m_half_Y = (y1 - y0) / timeInterval2_m;
-
-			// calculate velocity1_p_half
-			velocity1_p_half_X = (x2 - x1) / timeInterval2_p;
-			velocity1_p_half_Y = (y2 - y1) / timeInterval2_p;
-
-			// calculate the real velocity at point (x1, y1)
-			velocityAtPoint1_X = ((timeInterval1_m * velocity1_p_half_X) + (timeInterval1_p * velocity1_m_half_X)) / timeInterval1;
-			velocityAtPoint1_Y = ((timeInterval1_m * velocity1_p_half_Y) + (timeInterval1_p * velocity1_m_half_Y)) / timeInterval1;
-
-
-
-			// following steps are the process of calculating the velocity at point (x2, y2)
-			// calculate velocity2_m_half
-			velocity2_m_half_X = (x2 - x1) / timeInterval2_m;
-			velocity2_m_half_Y = (y2 - y1) / timeInterval2_m;
-
-			// calculate velocity2_p_half
-			velocity2_p_half_X = (x3 - x2) / timeInterval2_p;
-			velocity2_p_half_Y = (y3 - y2) / timeInterval2_p;
-
-			// calculate the real velocity at point (x2, y2)
-			velocityAtPoint2_X = ((timeInterval2_m * velocity2_p_half_X) + (timeInterval2_p * velocity2_m_half_X)) / timeInterval2;
-			velocityAtPoint2_Y = ((timeInterval2_m * velocity2_p_half_Y) + (timeInterval2_p * velocity2_m_half_Y)) / timeInterval2;
-		}
-
-		// calculating the x, y coordinates for the pi, pi+, p(i+1), (i+1)- 
-		// pi is x1
-
-		// pi+
-		x1_p = x1 + (1 / 3.0) * timeInterval1_p * velocityAtPoint1_X;
-		y1_p = y1 + (1 / 3.0) * timeInterval1_p * velocityAtPoint1_Y;
-
-		//p(i+1) is x2
-
-		//p(i+1)-
-		x2_m = x2 - (1 / 3.0) * timeInterval2_m * velocityAtPoint2_X;
-		y2_m = y2 - (1 / 3.0) * timeInterval2_m * velocityAtPoint2_Y;
-
-
-		// ewven though it iterates through all of the points 
-		// but it should not all of the points in each iteration 
-		if (i == 0) {
-
-			controlPoints[countControlPoins][0] = x1;
-			controlPoints[countControlPoins++][1] = y1;
-
-			controlPoints[countControlPoins][0] = x1_p;
-			controlPoints[countControlPoins++][1] = y1_p;
-
-			controlPoints[countControlPoins][0] = x2_m;
-			controlPoints[countControlPoins++][1] = y2_m;
-
-			controlPoints[countControlPoins][0] = x2;
-			controlPoints[countControlPoins++][1] = y2;
-		}
-		else {
-
-			controlPoints[countControlPoins][0] = x1_p;
-			controlPoints[countControlPoins++][1] = y1_p;
-
-			controlPoints[countControlPoins][0] = x2_m;
-			controlPoints[countControlPoins++][1] = y2_m;
-
-			controlPoints[countControlPoins][0] = x2;
-			controlPoints[countControlPoins++][1] = y2;
-		}
-
-		if (countControlPoins > (MaxNumDots - 1) * 3 + 1) {
-			countControlPoins = (MaxNumDots - 1) * 3 + 1;
-		}
-
+// Draws all the points of one of theCurve's arrays.  The arrays are circular
+//    buffers, so this draws one or two ranges, with one call.
+void DrawCurveArray(GLenum drawMode, CatmullRomSpline::PointArray which)
+{
+	CatmullRomSpline::DirtyRange ranges[2];
+	int numRanges = theCurve.DrawRanges(which, ranges);
+	int firsts[2], counts[2];
+	for (int i = 0; i < numRanges; i++) {
+		firsts[i] = vboFirst[which] + ranges[i].first;
+		counts[i] = ranges[i].Count();
 	}
-
+	glState.MultiDrawArrays(drawMode, firsts, counts, numRanges);
 }
 
+// Draws the points on the curve, one strip per Bezier curve, with one call.
+//    With adaptive tessellation the curves have different numbers of points.
+void DrawCurveSegments(GLenum drawMode)
+{
+	glState.MultiDrawArrays(drawMode, segmentFirsts.data(), theCurve.SegmentCounts(), theCurve.Capacity());
+}
 
-void storePoints_OneBezierCurve(VectorR2 p0, VectorR2 p1, VectorR2 p2, VectorR2 p3) {
+// Draws the triangle strips of curveStroke, one per Bezier curve, with one call.
+void DrawStroke()
+{
+	glState.MultiDrawArrays(GL_TRIANGLE_STRIP, stripFirsts.data(), curveStroke.StripCounts(), curveStroke.NumStrips());
+}
 
-	for ( int i = 0; i < MeshRes; i++) { // because here doesn't have equal sign, so the last point of the curve won't be add to the array
-		float alpha = (float) i / 20.0;
-		VectorR2 r0 = (1 - alpha) * p0 + alpha * p1;
-		VectorR2 r1 = (1 - alpha) * p1 + alpha * p2;
-		VectorR2 r2 = (1 - alpha) * p2 + alpha * p3;
+// Loads the changed parts of the dots, controlPoints and pointsOnCurve arrays into the VBO,
+//    and strokes again the parts of the curve that have changed and loads their triangle
+//    strips.  The stroke is updated before theCurve.ClearDirty().
+void LoadPointsIntoVBO() 
+{
+	curveStroke.Update(theCurve);
+	if (theCurve.Capacity() != vboCapacity || theCurve.MeshResolution() != vboMeshRes
+		|| curveStroke.VertexCapacity() != strokeVboCapacity) {
+		AllocateVBO();		// The storage of theCurve has grown, or been resized
+		theCurve.MarkAllDirty();
+		curveStroke.MarkAllDirty();
+	}
 
-		VectorR2 t0 = (1 - alpha) * r0 + alpha * r1;
-		VectorR2 t1 = (1 - alpha) * r1 + alpha * r2;
+    // Only the changed ranges are copied, into the VBO sized earlier by AllocateVBO()
+	LoadDirtyIntoVBO(CatmullRomSpline::DotArray, theCurve.Dots());
 
-		VectorR2 s0 = (1 - alpha) * t0 + alpha * t1;
+	// controlPoints Array
+	LoadDirtyIntoVBO(CatmullRomSpline::ControlPointArray, theCurve.ControlPoints());
 
-		pointsOnCurve[countPointsOnCurve][0] = s0.x;
-		pointsOnCurve[countPointsOnCurve++][1] = s0.y;
-	}
+	// pointsOnCurve Array
+	LoadDirtyIntoVBO(CatmullRomSpline::CurvePointArray, theCurve.PointsOnCurve());
 
+	// The triangle strips
+	const std::vector<CurveStroker::DirtyRange>& strokeEntries = curveStroke.DirtyEntries();
+	LoadDirtyIntoVBO(StrokeRange, strokeEntries.data(), (int)strokeEntries.size(), curveStroke.Vertices());
 
+	vboUpload.Flush();
+	curveStroke.ClearDirty();
+	theCurve.ClearDirty();
 }
 
+// Records that theCurve has changed.  The VBO is loaded, and the arc lengths and the
+//    bounding volumes are built again, when the next frame needs them.
+void CurveChanged()
+{
+	vboStale = true;
+	redrawNeeded = true;
+	arcLengthsValid = false;
+	curveBVHValid = false;
+}
 
-void storePoints_AllBezierCurves() {
-	VectorR2 p0, p1, p2, p3;
-	int numberOfCurves = NumDots - 1;
-	countPointsOnCurve = 0;
-
-	for (int i = 0; i < numberOfCurves; i++) {
-		if (i == 0) {
-			p0 = VectorR2(controlPoints[0][0], controlPoints[0][1]);
-			p1 = VectorR2(controlPoints[1][0], controlPoints[1][1]);
-			p2 = VectorR2(controlPoints[2][0], controlPoints[2][1]);
-			p3 = VectorR2(controlPoints[3][0], controlPoints[3][1]);
-		}
-		else {
-			p0 = VectorR2(controlPoints[i * 4 - i][0], controlPoints[i * 4 - i][1]);
-			p1 = VectorR2(controlPoints[i * 4 - i + 1][0], controlPoints[i * 4 - i + 1][1]);
-			p2 = VectorR2(controlPoints[i * 4 - i + 2][0], controlPoints[i * 4 - i + 2][1]);
-			p3 = VectorR2(controlPoints[i * 4 - i + 3][0], controlPoints[i * 4 - i + 3][1]);
-		}
-
-		storePoints_OneBezierCurve(p0, p1, p2, p3);
+// Moves a dot, recomputing only the (at most four) curves through it
+void MovePoint(int i, float x, float y)
+{
+	theCurve.ChangePoint(i, x, y);
+	dotGrid.MoveDot(i, x, y);
+	vboStale = true;
+	redrawNeeded = true;
+	arcLengthsValid = false;
+	if (curveBVHValid) {
+		curveBVH.RefitDot(i);		// Only the boxes of the curves through the dot change
 	}
-
-	// add the last point of the whole curve
-	float p_last_x = dotArray[NumDots - 1][0];
-	float p_last_y = dotArray[NumDots - 1][1];
-
-	pointsOnCurve[countPointsOnCurve][0] = p_last_x;
-	pointsOnCurve[countPointsOnCurve++][1] = p_last_y;
 }
 
-
-
-void LoadPointsIntoVBO() 
+void AddPoint(float x, float y)
 {
-    // Using glBufferSubData (with "Sub") does not resize the VBO.  
-    // The VBO was sized earlier with glBufferData
-    glBindBuffer(GL_ARRAY_BUFFER, myVBO[0]);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, NumDots * 2 * sizeof(float), dotArray);
-    check_for_opengl_errors();
-
-	// controlPoints Array
-	glBindBuffer(GL_ARRAY_BUFFER, myVBO[1]);
-	glBufferSubData(GL_ARRAY_BUFFER, 0, (3 * (NumDots - 1) + 1) * 2 * sizeof(float), controlPoints);
-	check_for_opengl_errors();
-
-	// pointsOnCurve Array
-	glBindBuffer(GL_ARRAY_BUFFER, myVBO[2]);
-	glBufferSubData(GL_ARRAY_BUFFER, 0, (20 * (NumDots - 1)) * 2 * sizeof(float), pointsOnCurve);
-	check_for_opengl_errors();
+	int numDots = theCurve.NumDots();
+	if (!theCurve.AddPoint(x, y)) {
+		return;			// repeated point
+	}
+	if (theCurve.NumDots() == numDots) {
+		dotGrid.RemoveFirstDot();	// In "live trace" mode the first dot made room for the new one
+	}
+	dotGrid.AddDot(x, y);
+	CurveChanged();
 }
 
 
+void RemoveFirstPoint()
+{
+    if (theCurve.NumDots() == 0) {
+        return;
+    }
+    theCurve.RemoveFirstPoint();
+    dotGrid.RemoveFirstDot();
+    CurveChanged();
+}
 
-
-
-void AddPoint(float x, float y)
+void RemoveLastPoint()
 {
+    theCurve.RemoveLastPoint();
+    dotGrid.RemoveLastDot();
+    // The dots are already loaded, but the curve through them has changed.
+    CurveChanged();
+}
 
-	// check for the reapted points 
-	if (x == dotArray[NumDots - 1][0] && y == dotArray[NumDots - 1][1]) {
+// The curve file is mapped, and its arrays are copied into theCurve without
+//    recomputing the curve.
+void LoadCurveFile()
+{
+	CurveFile file;
+	if (!file.Open(curveFileName) || !theCurve.Load(file)) {
+		printf("Could not load %s.\n", curveFileName);
 		return;
 	}
+	printf("Loaded %d dots from %s.\n", theCurve.NumDots(), curveFileName);
+	dotGrid.Build(theCurve);
+	CurveChanged();
+}
 
-    if (NumDots < MaxNumDots) {
-        dotArray[NumDots][0] = x;
-        dotArray[NumDots][1] = y;
-        NumDots++;
-        LoadPointsIntoVBO();
-    }
-	else { // if the current number of points are
-		//more than than the maximum points 
-		RemoveFirstPoint();
-		dotArray[NumDots][0] = x;
-		dotArray[NumDots][1] = y;
+// Records an edit, to be made by the next frame.  A drag of the same dot, or a new
+//    tolerance, right after the last one replaces it.
+void RecordEdit(EditKind kind, int value = 0, float x = 0.0f, float y = 0.0f)
+{
+	if (!pendingEdits.empty() && pendingEdits.back().kind == kind
+		&& ((kind == DragDot && pendingEdits.back().value == value) || kind == SetTolerance)) {
+		pendingEdits.pop_back();
 	}
+	CurveEdit edit = { kind, value, x, y };
+	pendingEdits.push_back(edit);
+}
 
+// The selected dot moves at the next frame, to the last position it is dragged to
+void DragPoint(float x, float y)
+{
+	assert(selectedVert >= 0);
+	RecordEdit(DragDot, selectedVert, x, y);
+}
 
-	// every time add new points recalculate the controlPoints array and 
-	// draw the Bezier curves 
-	countControlPoins = 0;
-
-	switch (mode) {
-	case 1:
-		calculateControlPoints_CatMull_Rom();
+void ApplyEdit(const CurveEdit& edit)
+{
+	switch (edit.kind) {
+	case AddDot:
+		AddPoint(edit.x, edit.y);
 		break;
-	case 2:
-		calculateControlPoints_Chord();
+	case DragDot:
+		MovePoint(edit.value, edit.x, edit.y);
 		break;
-	case 3: 
-		calculateControlPoints_Centrpetal();
+	case RemoveFirstDot:
+		RemoveFirstPoint();
 		break;
-	}
-
-	// recalculate the points in Bezier curve
-	storePoints_AllBezierCurves();
-
-	// load the points in VBO
-	LoadPointsIntoVBO();
-	
-	// redraw the curve
-	renderCurve();
-}
-
-
-void ChangePoint(int i, float x, float y)
-{
-	if (mode == 0) {
-		assert(i >= 0 && i < NumDots);
-		dotArray[i][0] = x;
-		dotArray[i][1] = y;
-		LoadPointsIntoVBO();
-	}
-	else {
-		assert(i >= 0 && i < MeshRes * (MaxNumDots - 1) + 1);
-		dotArray[i][0] = x;
-		dotArray[i][1] = y;
-
-		countControlPoins = 0;
-		if (mode == 1) {
-			calculateControlPoints_CatMull_Rom();
+	case RemoveLastDot:
+		if (edit.value < theCurve.NumDots() - 1) {   // Don't allow removing "selected" vertex
+			RemoveLastPoint();
 		}
-		else if (mode == 2) {
-			calculateControlPoints_Chord();
+		break;
+	case ToggleLiveTrace:
+		theCurve.SetMaxDots(theCurve.MaxDots() == 0 ? LiveTraceNumDots : 0);
+		dotGrid.Build(theCurve);		// The first dots may have been removed
+		CurveChanged();
+		break;
+	case ChooseMode:
+		theCurve.SetMode(edit.value);
+		CurveChanged();				// The strips and the markers follow the curve, or the straight lines
+		break;
+	case NextTessellation: {
+		theCurve.SetTessellation((theCurve.GetTessellation() + 1) % 4);
+		int numVertices = 0;
+		for (int i = 0; i < theCurve.NumDots() - 1; i++) {
+			numVertices += theCurve.SegmentPointCount(i);
 		}
-		else if (mode == 3) {
-			calculateControlPoints_Centrpetal();
+		printf("Tessellation: %s, %d vertices\n", TessellationNames[theCurve.GetTessellation()], numVertices);
+		CurveChanged();
+		break;
+	}
+	case StepMeshRes: {
+		int meshRes = theCurve.MeshResolution() + edit.value;
+		if (meshRes > 0 && meshRes <= CatmullRomSpline::MaxMeshRes) {
+			theCurve.SetMeshResolution(meshRes);
+			printf("%d points per Bezier curve\n", meshRes);
+			CurveChanged();
 		}
-
-		storePoints_AllBezierCurves();
-		LoadPointsIntoVBO();
-
+		break;
+	}
+	case StepAlpha:
+		if (theCurve.GetMode() != CatmullRomSpline::Polyline) {
+			float alpha = theCurve.Alpha() + 0.125f * edit.value;
+			if (alpha >= 0.0f && alpha <= 1.0f) {
+				theCurve.SetAlpha(alpha);
+				printf("alpha = %g\n", alpha);
+				CurveChanged();
+			}
+		}
+		break;
+	case SetTolerance:
+		theCurve.SetFlatnessTolerance(edit.x);
+		CurveChanged();
+		break;
+	case LoadFile:
+		LoadCurveFile();
+		break;
 	}
 }
 
+// Makes the pending edits, in the order they were recorded
+void ApplyEdits()
+{
+	for (const CurveEdit& edit : pendingEdits) {
+		ApplyEdit(edit);
+	}
+	pendingEdits.clear();
+}
 
-void RemoveFirstPoint()
+// Makes the edits recorded since the last frame.  Called once per frame, before myRenderScene().
+void UpdateFrame()
 {
-    if (NumDots == 0) {
-        return;
-    }
-    for (int i = 0; i < NumDots - 1; i++) {
-        dotArray[i][0] = dotArray[i + 1][0];
-        dotArray[i][1] = dotArray[i + 1][1];
-    }
-    NumDots--;
-    if (NumDots > 0) {
-        LoadPointsIntoVBO();
-    }
+	ApplyEdits();
+	if (vboStale) {
+		LoadPointsIntoVBO();
+		vboStale = false;
+	}
 }
 
-void RemoveLastPoint()
+// True if the next frame has something to draw or to update
+bool FrameNeeded()
 {
-    NumDots = (NumDots > 0) ? NumDots - 1 : 0;
-    // No need to load points into the VBO again: they are already loaded.
+	return redrawNeeded || !pendingEdits.empty() || vboStale || animating;
 }
 
 
@@ -811,6 +513,9 @@ void myRenderScene() {
     const float clearDepth = 1.0f;
     glClearBufferfv(GL_DEPTH, 0, &clearDepth);	// Must pass in a pointer to the depth value!
 
+	int NumDots = theCurve.NumDots();
+	int mode = theCurve.GetMode();
+
 	// render the control points  
 	if (NumDots > 0) {
 		if (showingControlPoints == 1 && mode != 0) {
@@ -832,39 +537,44 @@ void myRenderScene() {
         return;
     }
 
-	glUseProgram(shaderProgram1);
-    glBindVertexArray(myVAO[0]);
+	glState.UseProgram(shaderProgram1);
+    glState.BindVertexArray(myVAO);
 
     // Draw the line segments
     if (NumDots > 0 && mode == 0) {
-        glVertexAttrib3f(vertColor_loc, 1.0f, 0.7f, 0.9f);		
-        glDrawArrays(GL_LINE_STRIP, 0, NumDots);
+        glState.Color(vertColor_loc, 1.0f, 0.7f, 0.9f);		
+        DrawStroke();
     }
 
     // Draw the dots
-	glVertexAttrib3f(vertColor_loc, 1.0f, 0.7f, 0.9f);		
-	glDrawArrays(GL_POINTS, 0, NumDots);
+	glState.Color(vertColor_loc, 1.0f, 0.7f, 0.9f);		
+	glState.PointSize(PointPixels);
+	DrawCurveArray(GL_POINTS, CatmullRomSpline::DotArray);
 
-	glBindVertexArray(0);
 	check_for_opengl_errors();   // Really a great idea to check for errors -- esp. good for debugging!
 
-
+	if (animating) {
+		renderMarker();
+	}
+	if (snapping) {
+		renderSnapPoint();
+	}
 }
 
 
 void renderControlPoints() {
 
-	if (NumDots <= 1) {
+	if (!theCurve.HasCurve()) {
 		return;
 	}
-	glUseProgram(shaderProgram1);
-	glBindVertexArray(myVAO[1]);
+	glState.UseProgram(shaderProgram1);
+	glState.BindVertexArray(myVAO);
 
 	// Draw the dots
-	glVertexAttrib3f(vertColor_loc, 0.0f, 0.5f, 0.8f);		// dark blue
-	glDrawArrays(GL_POINTS, 0, 3 * (NumDots - 1) + 1);
+	glState.Color(vertColor_loc, 0.0f, 0.5f, 0.8f);		// dark blue
+	glState.PointSize(PointPixels);
+	DrawCurveArray(GL_POINTS, CatmullRomSpline::ControlPointArray);
 
-	glBindVertexArray(0);
 	check_for_opengl_errors();
 
 }
@@ -872,50 +582,106 @@ void renderControlPoints() {
 
 void renderCurve() {
 
-	if (NumDots <= 1) {
+	if (!theCurve.HasCurve()) {
 		return;
 	}
+	int mode = theCurve.GetMode();
 
-	glUseProgram(shaderProgram1);
-	glBindVertexArray(myVAO[2]);
-
+	glState.UseProgram(shaderProgram1);
+	glState.BindVertexArray(myVAO);
 
-	// Draw the line segments
-	if (NumDots > 0 && (mode == 1 || mode == 2 || mode == 3)) {
+	// Draw the line segments, as triangle strips
+	if (mode == 1 || mode == 2 || mode == 3 || mode == 4) {
 		if (mode == 1) {
-			glVertexAttrib3f(vertColor_loc, 0.7f, 0.5f, 0.8f);  //purple
-			glDrawArrays(GL_LINE_STRIP, 0, MeshRes * (NumDots - 1));
+			glState.Color(vertColor_loc, 0.7f, 0.5f, 0.8f);  //purple
+			DrawStroke();
 		}
 		else if (mode == 2) {
-			glVertexAttrib3f(vertColor_loc, 1.0f, 1.0f, 0.0f);  // yellow
-			glDrawArrays(GL_LINE_STRIP, 0, MeshRes * (NumDots - 1));
+			glState.Color(vertColor_loc, 1.0f, 1.0f, 0.0f);  // yellow
+			DrawStroke();
+		}
+		else if (mode == 3) {
+			glState.Color(vertColor_loc, 0.5f, 0.8f, 0.5f);  // green
+			DrawStroke();
 		}
 		else {
-			glVertexAttrib3f(vertColor_loc, 0.5f, 0.8f, 0.5f);  // green
-			glDrawArrays(GL_LINE_STRIP, 0, MeshRes * (NumDots - 1));
+			glState.Color(vertColor_loc, 1.0f, 0.6f, 0.2f);  // orange
+			DrawStroke();
 		}
 	}
 
 
-	if (mode == 1 || mode == 2 || mode == 3) {
+	// Draw the points on the curve
+	glState.PointSize(PointPixels);
+	if (mode == 1 || mode == 2 || mode == 3 || mode == 4) {
 		if (mode == 1) {
-			glVertexAttrib3f(vertColor_loc, 0.8f, 0.8f, 0.8f);
-			glDrawArrays(GL_POINTS, 0, MeshRes * (NumDots - 1));
+			glState.Color(vertColor_loc, 0.8f, 0.8f, 0.8f);
+			DrawCurveSegments(GL_POINTS);
 		}
 		else if (mode == 2) {
-			glVertexAttrib3f(vertColor_loc, 0.8f, 0.8f, 0.8f);
-			glDrawArrays(GL_POINTS, 0, MeshRes * (NumDots - 1));
+			glState.Color(vertColor_loc, 0.8f, 0.8f, 0.8f);
+			DrawCurveSegments(GL_POINTS);
 		}
 		else {
-			glVertexAttrib3f(vertColor_loc, 0.8f, 0.8f, 0.8f);
-			glDrawArrays(GL_POINTS, 0, MeshRes * (NumDots - 1));
+			glState.Color(vertColor_loc, 0.8f, 0.8f, 0.8f);
+			DrawCurveSegments(GL_POINTS);
 		}
 	}
-	glBindVertexArray(0);
 	check_for_opengl_errors();
 
 }
 
+// Draws the marker at the distance along the curve it has moved since the
+//    animation started, going back to the start when it reaches the end.
+//    Successive distances are close, so the hinted search takes O(1) time.
+void renderMarker() {
+
+	if (!arcLengthsValid) {
+		arcLengths.Build(theCurve);
+		arcLengthsValid = true;
+	}
+	if (arcLengths.Length() <= 0.0) {
+		return;
+	}
+	double distance = fmod(MarkerSpeed * (Now() - animationStart), arcLengths.Length());
+	markerLocation = arcLengths.Find(distance, markerLocation);
+	float marker[2];
+	arcLengths.PointAt(markerLocation, marker);
+	glState.Color(vertColor_loc, 0.9f, 0.1f, 0.1f);		// red
+	drawMarker(marker, AnimationMarker);
+}
+
+// Draws a marker at the point on the curve nearest the cursor.
+void renderSnapPoint() {
+
+	if (!curveBVHValid) {
+		curveBVH.Build(theCurve);
+		curveBVHValid = true;
+	}
+	CurveBVH::Hit hit = curveBVH.Closest(cursorX, cursorY);
+	if (hit.curve < 0) {
+		return;
+	}
+	float marker[2] = { hit.x, hit.y };
+	glState.Color(vertColor_loc, 0.1f, 0.6f, 0.2f);		// green
+	drawMarker(marker, SnapMarker);
+}
+
+// Draws one large point, in the current color.  Each marker has its own vertex,
+//    so drawing one does not change the vertex of a marker drawn before it.
+void drawMarker(const float marker[2], Marker which) {
+
+	int first = vboFirst[MarkerRange] + which;
+	vboUpload.Write(first * 2 * sizeof(float), 2 * sizeof(float), marker);
+	vboUpload.Flush();
+
+	glState.UseProgram(shaderProgram1);
+	glState.BindVertexArray(myVAO);
+	glState.PointSize(MarkerPixels);
+	glState.DrawArrays(GL_POINTS, first, 1);
+	check_for_opengl_errors();
+}
+
 void my_setup_SceneData() {
 	mySetupGeometries();
 
@@ -932,59 +698,90 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
 	if (action == GLFW_RELEASE) {
 		return;			// Ignore key up (key release) events
 	}
+	redrawNeeded = true;
 	if (key == GLFW_KEY_ESCAPE || key == GLFW_KEY_X) {
 		glfwSetWindowShouldClose(window, true);
 	}
     else if (key == GLFW_KEY_F) {
         if (selectedVert != 0) {   // Don't allow removing "selected" vertex
-            RemoveFirstPoint();
+            RecordEdit(RemoveFirstDot);
             selectedVert = (selectedVert<0) ? selectedVert : selectedVert - 1;
         }
     }
     else if (key == GLFW_KEY_L) {
-        if (selectedVert < NumDots - 1) {   // Don't allow removing "selected" vertex
-            RemoveLastPoint();
-        }
+        RecordEdit(RemoveLastDot, selectedVert);   // Keeps the "selected" vertex
     }
-	else if (key == '0') {
-		mode = 0; 
-
+	else if (key == GLFW_KEY_W) {
+		// Toggle "live trace" mode: only the last LiveTraceNumDots dots are kept
+		if (selectedVert == -1) {
+			RecordEdit(ToggleLiveTrace);
+		}
 	}
-	else if (key == '1') {
-		mode = 1;
-
-		// recalculate the controlPoints array every time press 1
-		countControlPoins = 0;
-		calculateControlPoints_CatMull_Rom();
-
-		storePoints_AllBezierCurves();
-		
-		LoadPointsIntoVBO();
-	
+	else if (key == '0' || key == '1' || key == '2' || key == '3') {
+		// '0' - polyline; '1' - Catmull_Rom; '2' - chord-length; '3' - centripetal
+		// recalculate the controlPoints array every time the mode is chosen
+		RecordEdit(ChooseMode, key - '0');
 	}
-	else if (key == '2') {
-		mode = 2;
-
-		// recalculate the controlPoints array every time press 2
-		countControlPoins = 0;
-		calculateControlPoints_Chord();
-
-		storePoints_AllBezierCurves();
-
-		LoadPointsIntoVBO();
-
+	else if (key == 'T' || key == 't') {
+		// Cycle through de Casteljau, forward differencing, batched Bernstein weights and adaptive
+		RecordEdit(NextTessellation);
 	}
-	else if (key == '3') {
-		mode = 3;
-
-		// recalculate the controlPoints array every time press 3
-		countControlPoins = 0;
-		calculateControlPoints_Centrpetal();
-
-		storePoints_AllBezierCurves();
-
-		LoadPointsIntoVBO();
-
+	else if (key == GLFW_KEY_EQUAL || key == GLFW_KEY_MINUS) {
+		// '+' and '-' change the number of points on each Bezier curve
+		RecordEdit(StepMeshRes, key == GLFW_KEY_EQUAL ? 1 : -1);
+	}
+	else if (key == GLFW_KEY_LEFT_BRACKET || key == GLFW_KEY_RIGHT_BRACKET) {
+		// '[' and ']' change the exponent alpha of the knot intervals by 1/8
+		RecordEdit(StepAlpha, key == GLFW_KEY_RIGHT_BRACKET ? 1 : -1);
+	}
+	else if (key == GLFW_KEY_J) {
+		// Toggle between round joins and caps and mitered joins with butt caps
+		bool round = (curveStroke.Join() == CurveStroker::RoundJoin);
+		curveStroke.SetJoin(round ? CurveStroker::MiterJoin : CurveStroker::RoundJoin);
+		curveStroke.SetCap(round ? CurveStroker::ButtCap : CurveStroker::RoundCap);
+		vboStale = true;			// Only the strips change
+	}
+	else if (key == GLFW_KEY_U) {
+		// Toggle reporting the bytes loaded into the VBO and the GL calls each frame
+		reportingFrames = !reportingFrames;
+		printf("The VBO is loaded by %s.\n", vboUpload.Persistent() ? "persistent mapping" : "glBufferSubData, orphaning when all of it changes");
+	}
+	else if (key == GLFW_KEY_A) {
+		// Toggle the marker moving along the curve at constant speed
+		animating = !animating;
+		animationStart = Now();
+		markerLocation.curve = 0;
+	}
+	else if (key == GLFW_KEY_N) {
+		// Toggle showing the point on the curve nearest the cursor
+		snapping = !snapping;
+	}
+	else if (key == GLFW_KEY_I) {
+		// Find the points where the curve crosses itself
+		ApplyEdits();
+		std::vector<CurveIntersection> crossings;
+		double start = FrameTimer::Seconds();
+		IntersectCurves(theCurve, 0, crossings);
+		double milliseconds = 1000.0 * (FrameTimer::Seconds() - start);
+		printf("The curve crosses itself %d times (%.2f ms)\n", (int)crossings.size(), milliseconds);
+		for (size_t k = 0; k < crossings.size() && k < 10; k++) {
+			printf("    curve %d at t = %g and curve %d at t = %g: (%g, %g)\n", crossings[k].segA, crossings[k].tA,
+				   crossings[k].segB, crossings[k].tB, crossings[k].x, crossings[k].y);
+		}
+	}
+	else if (key == GLFW_KEY_S) {
+		ApplyEdits();				// Saves the curve as it is shown after this frame
+		if (theCurve.Save(curveFileName)) {
+			printf("Saved %d dots to %s.\n", theCurve.NumDots(), curveFileName);
+		}
+		else {
+			printf("Could not save %s.  On Windows, another program may have it open.\n", curveFileName);
+		}
+	}
+	else if (key == GLFW_KEY_O) {
+		if (selectedVert == -1) {
+			RecordEdit(LoadFile);
+		}
 	}
 	else if (key == 'C' || key == 'c') {
 		if (showingControlPoints) {
@@ -996,6 +793,23 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
 	}
 }
 
+// The position of the cursor, in the coordinates of the dots.  A headless replay
+//    has no window, and moves the cursor with cursor_pos_callback().
+void GetCursorDot(GLFWwindow* window, float* dotX, float* dotY)
+{
+    if (window == nullptr) {
+        *dotX = cursorX;
+        *dotY = cursorY;
+        return;
+    }
+    double xpos, ypos;
+    glfwGetCursorPos(window, &xpos, &ypos);
+    // Scale x and y values into the range [-1,1]. 
+    // Note that y values are negated since mouse measures y position from top of the window
+    *dotX = (2.0f*(float)xpos / (float)(windowWidth-1)) - 1.0f;
+    *dotY = 1.0f - (2.0f*(float)ypos / (float)(windowHeight-1));
+}
+
 // *******************************************************
 // Process all mouse button events.
 // This routine is called each time a mouse button is pressed or released.
@@ -1003,39 +817,26 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
 void mouse_button_callback(GLFWwindow* window, int button, int action, int mods)
 {
     if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS) {
-        double xpos, ypos;
-        glfwGetCursorPos(window, &xpos, &ypos);
-        // Scale x and y values into the range [-1,1]. 
-        // Note that y values are negated since mouse measures y position from top of the window
-        float dotX = (2.0f*(float)xpos / (float)(windowWidth-1)) - 1.0f;
-        float dotY = 1.0f - (2.0f*(float)ypos / (float)(windowHeight-1));
-
-        AddPoint(dotX, dotY);
+        float dotX, dotY;
+        GetCursorDot(window, &dotX, &dotY);
+
+        RecordEdit(AddDot, 0, dotX, dotY);
     }
 
     else if (button == GLFW_MOUSE_BUTTON_RIGHT) {
         if (action == GLFW_PRESS) {
             assert(selectedVert == -1);
-            double xpos, ypos;
-            glfwGetCursorPos(window, &xpos, &ypos);
-            float dotX = (2.0f*(float)xpos / (float)(windowWidth - 1)) - 1.0f;
-            float dotY = 1.0f - (2.0f*(float)ypos / (float)(windowHeight - 1));
-            // Find closest extant point, if any. (distances minDist and thisDist are measured in pixels)
-            float minDist = 10000.0f;
-            int minI;
-            for (int i = 0; i < NumDots; i++) {
-                float thisDistX = 0.5f*(dotX - dotArray[i][0])*(float)windowWidth;
-                float thisDistY = 0.5f*(dotY - dotArray[i][1])*(float)windowHeight;
-                float thisDist = sqrtf(thisDistX*thisDistX + thisDistY * thisDistY);
-                if (thisDist < minDist) {
-                    minDist = thisDist;
-                    minI = i;
-                }
-            }
-            if (minDist <= 4.0) {      // If clicked within 4 pixels of the vertex
+            float dotX, dotY;
+            GetCursorDot(window, &dotX, &dotY);
+            ApplyEdits();       // Picks among the dots as they are after the earlier events
+            // Find closest extant point within PickPixels pixels, if any.
+            // The grid looks only at the dots near (dotX, dotY), however many dots there are.
+            int minI = dotGrid.Nearest(dotX, dotY, PickPixels * 2.0f / (float)windowWidth,
+                                       PickPixels * 2.0f / (float)windowHeight);
+            if (minI >= 0) {
                 selectedVert = minI;
 				
-				ChangePoint(selectedVert, dotX, dotY);
+				DragPoint(dotX, dotY);
             }
         }
         else if (action == GLFW_RELEASE) {
@@ -1045,13 +846,18 @@ void mouse_button_callback(GLFWwindow* window, int button, int action, int mods)
 }
 
 void cursor_pos_callback(GLFWwindow* window, double x, double y) {
+    float dotX = (2.0f*(float)x / (float)(windowWidth - 1)) - 1.0f;
+    float dotY = 1.0f - (2.0f*(float)y / (float)(windowHeight - 1));
+    cursorX = dotX;
+    cursorY = dotY;
+    if (snapping) {
+        redrawNeeded = true;    // The nearest point follows the cursor
+    }
     if (selectedVert == -1) {
         return;
     }
-    float dotX = (2.0f*(float)x / (float)(windowWidth - 1)) - 1.0f;
-    float dotY = 1.0f - (2.0f*(float)y / (float)(windowHeight - 1));
 
-	ChangePoint(selectedVert, dotX, dotY);
+	DragPoint(dotX, dotY);      // Moved once per frame, however many events arrive
 	
 }
 
@@ -1067,6 +873,16 @@ void window_size_callback(GLFWwindow* window, int width, int height) {
 	glViewport(0, 0, width, height);		// Draw into entire window
     windowWidth = width;
     windowHeight = height;
+
+	// Picking looks at 3x3 cells when the cells are as large as the pick radius
+	dotGrid.SetCellSize(PickPixels * 2.0f / (float)Max(Min(width, height), 1));
+
+	// Adaptive tessellation keeps the curve within half a pixel of its line segments
+	RecordEdit(SetTolerance, 0, 0.5f * 2.0f / (float)Max(Max(width, height), 1));
+
+	// The strips keep their width in pixels; the window is 2 units wide and 2 high
+	curveStroke.SetWidth(StrokePixels, 0.5f * (float)Max(width, 1), 0.5f * (float)Max(height, 1));
+	CurveChanged();
 }
 
 void my_setup_OpenGL() {
@@ -1077,21 +893,19 @@ void my_setup_OpenGL() {
 // TRY IT OUT: How do the results look different if you disable the next block
 // of code. (By changing "#if 1" to "#if 0"
 #if 1
-	// The following commands should induce OpenGL to create round points and 
-	//	antialias points and lines.  (This is implementation dependent unfortunately.)
+	// The following commands should induce OpenGL to create round points.
+	//	(This is implementation dependent unfortunately.)  The curve is drawn
+	//	as triangles by curveStroke, and does not depend on the width of lines.
 	glEnable(GL_POINT_SMOOTH);
-	glEnable(GL_LINE_SMOOTH);
 	glHint(GL_POINT_SMOOTH_HINT, GL_NICEST);	// Make round points, not square points
-	glHint(GL_LINE_SMOOTH_HINT, GL_NICEST);		// Antialias the lines
 	glEnable(GL_BLEND);
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 #endif
 
-	// Specify the diameter of points, and the width of lines. Measured in pixels.
-    // Results can be implementation dependent.
+	// Specify the diameter of points. Measured in pixels.
+    // Results can be implementation dependent.  The width of the curve is StrokePixels.
 	// TRY IT OUT: Experiment with increasing and decreasing these values.
-	glPointSize(8);
-	glLineWidth(5);
+	glPointSize(PointPixels);
 	
 }
 
@@ -1113,11 +927,235 @@ void setup_callbacks(GLFWwindow* window) {
     glfwSetCursorPosCallback(window, cursor_pos_callback);
 }
 
+// What a frame loaded into the VBO, and its GL calls
+struct FrameStats {
+	BufferUploader::Stats upload;
+	GlStateCache::Counts gl;
+};
+
+// Marks the end of the draws of a frame for the VBO uploads, and prints the
+//    bytes loaded and the GL calls per frame once a second when reportingFrames.
+FrameStats EndFrame() {
+	static int frames = 0;
+	static size_t totalBytes = 0, mostBytes = 0;
+	static int orphans = 0, waits = 0;
+	static int calls = 0, skipped = 0;
+	static double reportTime = 0.0;
+
+	BufferUploader::Stats stats = vboUpload.EndFrame();
+	GlStateCache::Counts counts = glState.EndFrame();
+	frames++;
+	totalBytes += stats.bytes;
+	mostBytes = Max(mostBytes, stats.bytes);
+	orphans += stats.orphans;
+	waits += stats.waits;
+	calls += counts.calls;
+	skipped += counts.skipped;
+
+	double now = Now();
+	if (now - reportTime >= 1.0) {
+		if (reportingFrames) {
+			printf("%d frames: %zu bytes loaded per frame, at most %zu; %d orphaned, %d waits for the GPU; "
+				   "%.1f GL calls per frame, %.1f skipped\n", frames, totalBytes / frames, mostBytes, orphans, waits,
+				   (double)calls / frames, (double)skipped / frames);
+		}
+		frames = 0;
+		totalBytes = mostBytes = 0;
+		orphans = waits = 0;
+		calls = skipped = 0;
+		reportTime = now;
+	}
+	FrameStats frame = { stats, counts };
+	return frame;
+}
+
 // **********************
 // Here is the main program
 // **********************
 
-int main() {
+// Waits for the events of the next frame.  While nothing changes it sleeps until an
+//    event arrives.  Then it goes on collecting events until frameBudget seconds after
+//    the start of the last frame, so that a burst of events makes one update.
+void WaitForFrame(GLFWwindow* window, double frameStart) {
+	glfwPollEvents();
+	while (!FrameNeeded() && !glfwWindowShouldClose(window)) {
+		glfwWaitEvents();
+	}
+	double wait;
+	while ((wait = frameStart + frameBudget - glfwGetTime()) > 0.0 && !glfwWindowShouldClose(window)) {
+		glfwWaitEventsTimeout(wait);
+	}
+}
+
+// *************************************************
+// Replays the script sceneFileName without a window, drawing into the framebuffer
+//    object of an offscreen context, then prints the CPU and GL times, the bytes
+//    loaded and the GL calls of each frame.  The images of the script are compared
+//    with the golden images, or written when recordingImages.
+// Returns the exit code: nonzero if the script fails or an image differs.
+// *************************************************
+int RunHeadless(bool curveFileNamed) {
+	SceneScript script;
+	if (!script.Open(sceneFileName)) {
+		return -1;
+	}
+	HeadlessContext context;
+	if (!context.Create(script.Width(), script.Height())) {
+		printf("Could not make an offscreen OpenGL context.\n");
+		return -1;
+	}
+	printf("Renderer: %s\n", glGetString(GL_RENDERER));
+	printf("OpenGL version supported %s\n", glGetString(GL_VERSION));
+	printf("Replaying %s: %d frames of %dx%d pixels.\n", sceneFileName, script.NumFrames(), context.Width(), context.Height());
+
+	window_size_callback(nullptr, context.Width(), context.Height());
+	my_setup_OpenGL();
+	my_setup_SceneData();
+	if (curveFileNamed) {
+		RecordEdit(LoadFile);
+	}
+
+	FrameTimer timer;
+	timer.Start();
+	std::vector<FrameStats> frameStats;
+	float cursorPixelX = 0.0f, cursorPixelY = 0.0f;
+	int failures = 0;
+	bool ended = false;
+	for (size_t k = 0; k < script.Steps().size() && !ended; k++) {
+		const SceneScript::Step& step = script.Steps()[k];
+		switch (step.command) {
+		case SceneScript::Key:
+			if (step.key == GLFW_KEY_ESCAPE || step.key == GLFW_KEY_X) {
+				ended = true;			// The keys that close the window
+			}
+			else {
+				key_callback(nullptr, step.key, 0, GLFW_PRESS, 0);
+			}
+			break;
+		case SceneScript::Click:
+		case SceneScript::Drag:
+		case SceneScript::Move:
+			cursorPixelX = step.x;
+			cursorPixelY = step.y;
+			cursor_pos_callback(nullptr, cursorPixelX, cursorPixelY);
+			if (step.command == SceneScript::Click) {
+				mouse_button_callback(nullptr, GLFW_MOUSE_BUTTON_LEFT, GLFW_PRESS, 0);
+				mouse_button_callback(nullptr, GLFW_MOUSE_BUTTON_LEFT, GLFW_RELEASE, 0);
+			}
+			else if (step.command == SceneScript::Drag && selectedVert == -1) {
+				mouse_button_callback(nullptr, GLFW_MOUSE_BUTTON_RIGHT, GLFW_PRESS, 0);
+			}
+			break;
+		case SceneScript::MoveBy:
+			for (int i = 0; i < step.count; i++) {
+				cursorPixelX += step.x;
+				cursorPixelY += step.y;
+				cursor_pos_callback(nullptr, cursorPixelX, cursorPixelY);
+			}
+			break;
+		case SceneScript::Release:
+			mouse_button_callback(nullptr, GLFW_MOUSE_BUTTON_RIGHT, GLFW_RELEASE, 0);
+			break;
+		case SceneScript::Frame:
+			// Each frame is drawn, changed or not, so that the frames can be compared
+			for (int i = 0; i < step.count; i++) {
+				replayTime += frameBudget;
+				timer.BeginFrame();
+				UpdateFrame();
+				myRenderScene();
+				timer.EndFrame();			// Waits for the frame to be drawn
+				frameStats.push_back(EndFrame());	// Its fence would flush the frame inside the CPU time
+				redrawNeeded = false;
+			}
+			break;
+		case SceneScript::Image:
+			if (recordingImages) {
+				if (context.SaveImage(step.file.c_str())) {
+					printf("Wrote %s.\n", step.file.c_str());
+				}
+				else {
+					printf("Could not write %s.\n", step.file.c_str());
+					failures++;
+				}
+			}
+			else {
+				HeadlessContext::Difference difference;
+				if (!context.CompareImage(step.file.c_str(), step.tolerance, &difference)) {
+					printf("Could not read %s, or it is not a %dx%d PPM image.\n", step.file.c_str(), context.Width(), context.Height());
+					failures++;
+				}
+				else if (difference.pixels > 0) {
+					printf("The frame differs from %s: %d pixels by more than %d, by at most %d.\n",
+						   step.file.c_str(), difference.pixels, step.tolerance, difference.largest);
+					failures++;
+				}
+				else {
+					printf("The frame matches %s (differing by at most %d).\n", step.file.c_str(), difference.largest);
+				}
+			}
+			break;
+		}
+	}
+
+	// The GPU time is -1 where the timer query gave none (see FrameTimer.h)
+	const std::vector<FrameTimer::Timing>& timings = timer.Timings();
+	printf("frame   CPU ms  finish ms   GPU ms     bytes  GL calls\n");
+	for (size_t i = 0; i < timings.size(); i++) {
+		printf("%5d %8.3f %10.3f %8.3f %9zu %9d\n", (int)i + 1, timings[i].cpuMilliseconds, timings[i].finishMilliseconds,
+			   timings[i].gpuMilliseconds, frameStats[i].upload.bytes, frameStats[i].gl.calls);
+	}
+	const char* const measureNames[] = { "CPU", "finish", "GPU" };
+	printf("%d frames.\n", (int)timings.size());
+	for (int m = FrameTimer::Cpu; m <= FrameTimer::Gpu; m++) {
+		FrameTimer::Summary summary = timer.Summarize((FrameTimer::Measure)m);
+		printf("    %s ms: mean %.3f, median %.3f, largest %.3f\n", measureNames[m], summary.mean, summary.median, summary.largest);
+	}
+	if (failures > 0) {
+		printf("%d images failed.\n", failures);
+	}
+	timer.Release();
+	vboUpload.Release();
+	return (failures > 0) ? 1 : 0;
+}
+
+// The options are "-vsync n", "-budget milliseconds", "-headless script", "-record"
+//    and the name of a curve file.  Returns false if they cannot be read.
+bool ReadOptions(int argc, char* argv[], bool* curveFileNamed) {
+	*curveFileNamed = false;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-vsync") == 0 && i + 1 < argc) {
+			swapInterval = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "-budget") == 0 && i + 1 < argc) {
+			frameBudget = 0.001 * atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "-headless") == 0 && i + 1 < argc) {
+			sceneFileName = argv[++i];
+		}
+		else if (strcmp(argv[i], "-record") == 0) {
+			recordingImages = true;
+		}
+		else if (argv[i][0] != '-' && !*curveFileNamed) {
+			curveFileName = argv[i];
+			*curveFileNamed = true;
+		}
+		else {
+			return false;
+		}
+	}
+	return swapInterval >= 0 && frameBudget >= 0.0 && (sceneFileName != nullptr || !recordingImages);
+}
+
+int main(int argc, char* argv[]) {
+	bool curveFileNamed;
+	if (!ReadOptions(argc, argv, &curveFileNamed)) {
+		printf("Usage: %s [-vsync swapInterval] [-budget milliseconds] [curveFile]\n", argv[0]);
+		printf("       %s -headless sceneScript [-record] [-budget milliseconds] [curveFile]\n", argv[0]);
+		return -1;
+	}
+	if (sceneFileName != nullptr) {
+		return RunHeadless(curveFileNamed);
+	}
 	glfwSetErrorCallback(error_callback);	// Supposed to be called in event of errors. (doesn't work?)
 	glfwInit();
 	//glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
@@ -1134,6 +1172,7 @@ int main() {
 		return -1;
 	}
 	glfwMakeContextCurrent(window);
+	glfwSwapInterval(swapInterval);
 
 	glewInit();
 
@@ -1149,8 +1188,18 @@ int main() {
 	printf("Left-click with mouse to add points.\n");
     printf("Right-click and hold and move mouse to select and move vertices.\n");
     printf("Press 'f' or 'l' to remove the first point or the last point.\n");
-    printf("Maximum of %d points permitted.\n", MaxNumDots);
+    printf("Press 't' to switch between de Casteljau, forward differencing, batched (%s) and adaptive tessellation.\n", BezierSimdName);
+    printf("Press '[' or ']' to change the exponent alpha of the knot intervals.\n");
+    printf("Press '+' or '-' to change the number of points on each Bezier curve.\n");
+    printf("Press 'w' to toggle keeping only the last %d points.\n", LiveTraceNumDots);
+    printf("Press 'a' to animate a marker moving along the curve at constant speed.\n");
+    printf("Press 'n' to show the point on the curve nearest the cursor.\n");
+    printf("Press 'i' to list the points where the curve crosses itself.\n");
+    printf("Press 'j' to switch between round and mitered joins in the curve.\n");
+    printf("Press 'u' to report the bytes loaded into the VBO and the GL calls per frame.\n");
+    printf("Press 's' to save the curve to %s, and 'o' to load it again.\n", curveFileName);
     printf("Press ESCAPE or 'X' or 'x' to exit.\n");
+    printf("Frames are at least %g ms apart, with %d screen refreshes per swap.\n", 1000.0 * frameBudget, swapInterval);
 	
     setup_callbacks(window);
     window_size_callback(window, initWidth, initHeight);
@@ -1158,17 +1207,27 @@ int main() {
 	// Initialize OpenGL, the scene and the shaders
     my_setup_OpenGL();
 	my_setup_SceneData();
+
+	// A curve file named on the command line is loaded by the first frame
+	if (curveFileNamed) {
+		RecordEdit(LoadFile);
+	}
  
     // Loop while program is not terminated.
 	while (!glfwWindowShouldClose(window)) {
-	
-		myRenderScene();				// Render into the current buffer
-		glfwSwapBuffers(window);		// Displays what was just rendered (using double buffering).
+		double frameStart = glfwGetTime();
+
+		UpdateFrame();					// Applies the edits made since the last frame
+		if (redrawNeeded || animating) {
+			myRenderScene();			// Render into the current buffer
+			EndFrame();
+			glfwSwapBuffers(window);	// Displays what was just rendered (using double buffering).
+			redrawNeeded = false;
+		}
 
-		// Poll events (key presses, mouse events)
-		glfwWaitEvents();					// Use this if no animation.
-		//glfwWaitEventsTimeout(1.0/60.0);	// Use this to animate at 60 frames/sec (timing is NOT reliable)
-		// glfwPollEvents();				// Use this version when animating as fast as possible
+		// Wait for events (key presses, mouse events).  While animating, the next
+		//    frame starts frameBudget after this one (the marker's position comes from glfwGetTime).
+		WaitForFrame(window, frameStart);
 	}
 
 	glfwTerminate();
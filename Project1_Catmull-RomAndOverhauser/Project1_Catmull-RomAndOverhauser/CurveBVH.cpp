@@ -0,0 +1,435 @@
+/*
+ * CurveBVH.cpp
+ *
+ * Bounding volume hierarchy over the Bezier curves of a CatmullRomSpline.
+ * See CurveBVH.h.
+ *
+ * Software is "as-is" and carries no warranty.  It may be used without
+ *   restriction, but if you modify it, please change the filenames to
+ *   prevent confusion between different versions.
+ */
+
+#include "CurveBVH.h"
+#include "CatmullRomSpline.h"
+#include "ThreadPool.h"
+
+#include <assert.h>
+#include <math.h>
+#include <stdint.h>
+#include <algorithm>
+
+// The distance to a curve is sampled at this many intervals, and each local
+//    minimum of the samples is refined by Newton's method.
+static const int ClosestSamples = 16;
+static const int MaxNewtonSteps = 16;
+static const double NewtonTolerance = 1.0e-9;		// Of a step, in t
+
+// Leaves, and queries of the batch, per chunk of work given to a thread
+static const int MinLeavesPerChunk = 1024;
+static const int MinPointsPerChunk = 256;
+
+// A box that contains nothing, and is further than any point
+static const float EmptyBox[4] = { FLT_MAX, FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+// Position, first and second derivatives of the Bezier curve with the control points cp
+static void evaluate( const float cp[8], double t, double p[2], double d1[2], double d2[2] )
+{
+	double s = 1.0 - t;
+	for (int k = 0; k < 2; k++) {
+		double a = cp[k], b = cp[2 + k], c = cp[4 + k], d = cp[6 + k];
+		p[k] = s * s * s * a + 3.0 * s * t * (s * b + t * c) + t * t * t * d;
+		d1[k] = 3.0 * (s * s * (b - a) + 2.0 * s * t * (c - b) + t * t * (d - c));
+		d2[k] = 6.0 * (s * (c - 2.0 * b + a) + t * (d - 2.0 * c + b));
+	}
+}
+
+static double distance2At( const float cp[8], double t, float x, float y )
+{
+	double p[2], d1[2], d2[2];
+	evaluate(cp, t, p, d1, d2);
+	return (p[0] - x) * (p[0] - x) + (p[1] - y) * (p[1] - y);
+}
+
+// Solves g(t) = (B(t) - q) . B'(t) = 0 for a local minimum of the distance in
+//    [lo, hi], by Newton's method, falling back to bisection when a step leaves
+//    the interval.  At an end of the curve the minimum may be the end itself.
+static double refine( const float cp[8], double lo, double hi, double t, float x, float y )
+{
+	for (int step = 0; step < MaxNewtonSteps; step++) {
+		double p[2], d1[2], d2[2];
+		evaluate(cp, t, p, d1, d2);
+		double ex = p[0] - x, ey = p[1] - y;
+		double g = ex * d1[0] + ey * d1[1];
+		double dg = d1[0] * d1[0] + d1[1] * d1[1] + ex * d2[0] + ey * d2[1];
+		if (g == 0.0 && dg > 0.0) {
+			return t;
+		}
+		// g is also zero where the curve stops, as at an end with zero velocity
+		if (g > 0.0) {
+			hi = t;
+		}
+		else {
+			lo = t;
+		}
+		double next = (dg > 0.0) ? t - g / dg : 0.5 * (lo + hi);
+		if (!(next >= lo && next <= hi)) {
+			next = 0.5 * (lo + hi);
+		}
+		if (fabs(next - t) <= NewtonTolerance) {
+			return next;
+		}
+		t = next;
+	}
+	return t;
+}
+
+// The squared distance from (x,y) to the line segment from a to b
+static double segmentDistance2( const float a[2], const float b[2], double x, double y )
+{
+	double ux = b[0] - a[0], uy = b[1] - a[1];
+	double vx = x - a[0], vy = y - a[1];
+	double len2 = ux * ux + uy * uy;
+	double s = (len2 > 0.0) ? Min(Max((ux * vx + uy * vy) / len2, 0.0), 1.0) : 0.0;
+	double dx = vx - s * ux, dy = vy - s * uy;
+	return dx * dx + dy * dy;
+}
+
+// True if a point at distance sqrt(d2) from the query point, and with all
+//    the points within reach of it, are further away than sqrt(best2)
+static bool beyondReach( double d2, double reach, double best2 )
+{
+	return d2 > reach * reach && (sqrt(d2) - reach) * (sqrt(d2) - reach) >= best2;
+}
+
+// The nearest point of one Bezier curve, if nearer than best2 (squared).
+//    Returns true and updates best2 and t if it is.
+static bool closestOnCurve( const float cp[8], float x, float y, double& best2, double& bestT )
+{
+	// The speed of the curve is at most 3 times the longest leg of its control
+	//    polygon, so each point of the curve is within speed*dt of the point at t.
+	double speed = 0.0;
+	for (int k = 0; k < 6; k += 2) {
+		double dx = cp[k + 2] - cp[k], dy = cp[k + 3] - cp[k + 1];
+		speed = Max(speed, dx * dx + dy * dy);
+	}
+	speed = 3.0 * sqrt(speed);
+
+	// The convex hull of the control points, and so the curve, is within the
+	//    larger distance of the middle control points from the chord
+	double bulge2 = Max(segmentDistance2(cp, cp + 6, cp[2], cp[3]), segmentDistance2(cp, cp + 6, cp[4], cp[5]));
+	if (beyondReach(segmentDistance2(cp, cp + 6, x, y), sqrt(bulge2), best2)) {
+		return false;			// The whole curve is too far away
+	}
+
+	double samples[ClosestSamples + 1];
+	for (int k = 0; k <= ClosestSamples; k++) {
+		samples[k] = distance2At(cp, (double)k / ClosestSamples, x, y);
+	}
+	bool found = false;
+	for (int k = 0; k <= ClosestSamples; k++) {
+		if ((k > 0 && samples[k - 1] < samples[k]) || (k < ClosestSamples && samples[k + 1] < samples[k])) {
+			continue;			// Not a local minimum of the samples
+		}
+		if (beyondReach(samples[k], speed / ClosestSamples, best2)) {
+			continue;			// No point near sample k is nearer than the best so far
+		}
+		double lo = (double)Max(k - 1, 0) / ClosestSamples;
+		double hi = (double)Min(k + 1, ClosestSamples) / ClosestSamples;
+		double t = refine(cp, lo, hi, (double)k / ClosestSamples, x, y);
+		double d2 = distance2At(cp, t, x, y);
+		if (samples[k] < d2) {
+			d2 = samples[k];
+			t = (double)k / ClosestSamples;
+		}
+		if (d2 < best2) {
+			best2 = d2;
+			bestT = t;
+			found = true;
+		}
+	}
+	return found;
+}
+
+CurveBVH::CurveBVH()
+	: spline(nullptr), numCurves(0), numGroups(0), firstLeaf(1)
+{
+}
+
+void CurveBVH::Clear()
+{
+	spline = nullptr;
+	numCurves = 0;
+	numGroups = 0;
+	firstLeaf = 1;
+	boxes.clear();
+	leafGroups.clear();
+	groupLeaves.clear();
+}
+
+// Calls task(first, end) on chunks of [first, end), on the threads if any
+template<class Task> static void forEachChunk( ThreadPool* threads, int first, int end, int minChunk, Task task )
+{
+	if (threads == nullptr || end - first <= minChunk) {
+		task(first, end);
+	}
+	else {
+		threads->ParallelFor(first, end, minChunk, task);
+	}
+}
+
+float CurveBVH::distance2( const Box& box, float x, float y )
+{
+	float dx = Max(Max(box.minX - x, x - box.maxX), 0.0f);
+	float dy = Max(Max(box.minY - y, y - box.maxY), 0.0f);
+	return dx * dx + dy * dy;
+}
+
+CurveBVH::Box CurveBVH::controlPointBox( const float cp[8] )
+{
+	Box box = { Min(Min(cp[0], cp[2]), Min(cp[4], cp[6])), Min(Min(cp[1], cp[3]), Min(cp[5], cp[7])),
+				Max(Max(cp[0], cp[2]), Max(cp[4], cp[6])), Max(Max(cp[1], cp[3]), Max(cp[5], cp[7])) };
+	return box;
+}
+
+// The box around the control points of the curves of group g
+CurveBVH::Box CurveBVH::groupBox( int g ) const
+{
+	Box box = { EmptyBox[0], EmptyBox[1], EmptyBox[2], EmptyBox[3] };
+	int endCurve = Min(LeafCurves * (g + 1), numCurves);
+	for (int i = LeafCurves * g; i < endCurve; i++) {
+		float cp[8];
+		spline->SegmentControlPoints(i, cp);
+		Box b = controlPointBox(cp);
+		box.minX = Min(box.minX, b.minX);
+		box.minY = Min(box.minY, b.minY);
+		box.maxX = Max(box.maxX, b.maxX);
+		box.maxY = Max(box.maxY, b.maxY);
+	}
+	return box;
+}
+
+// Spreads the 16 bits of n to the even bits of the result
+static uint32_t spreadBits( uint32_t n )
+{
+	n = (n | (n << 8)) & 0x00ff00ff;
+	n = (n | (n << 4)) & 0x0f0f0f0f;
+	n = (n | (n << 2)) & 0x33333333;
+	n = (n | (n << 1)) & 0x55555555;
+	return n;
+}
+
+// Sorts the points, (x,y) pairs, by their Morton codes in the box bounds, with
+//    16 bits for x and for y.  Points with the same code stay in their order,
+//    so the order does not depend on the threads.
+static void mortonOrder( const float* points, int numPoints, const float bounds[4],
+						 ThreadPool* threads, int minChunk, std::vector<int>& order )
+{
+	float scaleX = (bounds[2] > bounds[0]) ? 65535.0f / (bounds[2] - bounds[0]) : 0.0f;
+	float scaleY = (bounds[3] > bounds[1]) ? 65535.0f / (bounds[3] - bounds[1]) : 0.0f;
+	std::vector<uint64_t> keys(numPoints);			// Morton code, then index
+	forEachChunk(threads, 0, numPoints, minChunk, [&]( int first, int end ) {
+		for (int k = first; k < end; k++) {
+			uint32_t cx = (uint32_t)Min(Max((points[2 * k] - bounds[0]) * scaleX, 0.0f), 65535.0f);
+			uint32_t cy = (uint32_t)Min(Max((points[2 * k + 1] - bounds[1]) * scaleY, 0.0f), 65535.0f);
+			keys[k] = ((uint64_t)(spreadBits(cx) | (spreadBits(cy) << 1)) << 32) | (uint32_t)k;
+		}
+	});
+	std::sort(keys.begin(), keys.end());
+	order.resize(numPoints);
+	for (int k = 0; k < numPoints; k++) {
+		order[k] = (int)(keys[k] & 0xffffffff);
+	}
+}
+
+void CurveBVH::fitParents( int firstNode, int endNode )
+{
+	for (int n = firstNode; n < endNode; n++) {
+		const Box& a = boxes[2 * n];
+		const Box& b = boxes[2 * n + 1];
+		Box& box = boxes[n];
+		box.minX = Min(a.minX, b.minX);
+		box.minY = Min(a.minY, b.minY);
+		box.maxX = Max(a.maxX, b.maxX);
+		box.maxY = Max(a.maxY, b.maxY);
+	}
+}
+
+void CurveBVH::Build( const CatmullRomSpline& theSpline )
+{
+	spline = &theSpline;
+	numCurves = Max(spline->NumDots() - 1, 0);
+	numGroups = (numCurves + LeafCurves - 1) / LeafCurves;
+	firstLeaf = 1;
+	while (firstLeaf < numGroups) {
+		firstLeaf *= 2;
+	}
+	Box empty = { EmptyBox[0], EmptyBox[1], EmptyBox[2], EmptyBox[3] };
+	boxes.assign(2 * firstLeaf, empty);
+
+	// The boxes of the groups, and the centers of the boxes, for the Morton codes
+	std::vector<Box> groupBoxes(numGroups);
+	std::vector<float> centers(2 * numGroups);
+	ThreadPool* threads = spline->Threads();
+	forEachChunk(threads, 0, numGroups, MinLeavesPerChunk, [this, &groupBoxes, &centers]( int first, int end ) {
+		for (int g = first; g < end; g++) {
+			groupBoxes[g] = groupBox(g);
+			centers[2 * g] = 0.5f * (groupBoxes[g].minX + groupBoxes[g].maxX);
+			centers[2 * g + 1] = 0.5f * (groupBoxes[g].minY + groupBoxes[g].maxY);
+		}
+	});
+	float bounds[4] = { EmptyBox[0], EmptyBox[1], EmptyBox[2], EmptyBox[3] };
+	for (int g = 0; g < numGroups; g++) {
+		bounds[0] = Min(bounds[0], centers[2 * g]);
+		bounds[1] = Min(bounds[1], centers[2 * g + 1]);
+		bounds[2] = Max(bounds[2], centers[2 * g]);
+		bounds[3] = Max(bounds[3], centers[2 * g + 1]);
+	}
+	mortonOrder(centers.data(), numGroups, bounds, threads, MinLeavesPerChunk, leafGroups);
+
+	groupLeaves.resize(numGroups);
+	for (int leaf = 0; leaf < numGroups; leaf++) {
+		groupLeaves[leafGroups[leaf]] = leaf;
+		boxes[firstLeaf + leaf] = groupBoxes[leafGroups[leaf]];
+	}
+	for (int level = firstLeaf / 2; level >= 1; level /= 2) {
+		fitParents(level, 2 * level);
+	}
+}
+
+void CurveBVH::Refit( int firstCurve, int endCurve )
+{
+	assert( spline != nullptr && numCurves == Max(spline->NumDots() - 1, 0) );
+	firstCurve = Max(firstCurve, 0);
+	endCurve = Min(endCurve, numCurves);
+	if (firstCurve >= endCurve) {
+		return;
+	}
+	for (int g = firstCurve / LeafCurves; g <= (endCurve - 1) / LeafCurves; g++) {
+		int n = firstLeaf + groupLeaves[g];
+		boxes[n] = groupBox(g);
+		for (n /= 2; n >= 1; n /= 2) {
+			fitParents(n, n + 1);
+		}
+	}
+}
+
+// A node of the hierarchy and the squared distance to its box
+struct NodeDistance {
+	float distance2;
+	int node;
+};
+
+// Ties are broken by node, so that the search does not depend on the heap
+static bool fartherNode( const NodeDistance& a, const NodeDistance& b )
+{
+	return a.distance2 > b.distance2 || (a.distance2 == b.distance2 && a.node > b.node);
+}
+
+CurveBVH::Hit CurveBVH::Closest( float x, float y, float maxDistance ) const
+{
+	Hit hit = { -1, 0.0f, maxDistance, x, y };
+	if (numCurves == 0) {
+		return hit;
+	}
+	double best2 = (double)maxDistance * maxDistance;
+	double bestT = 0.0;
+
+	// The nodes still to visit, nearest first, with the distances to their boxes.
+	//    Stops when the nearest of them is further than the nearest point so far.
+	std::vector<NodeDistance> heap;
+	heap.reserve(64);
+	NodeDistance root = { distance2(boxes[1], x, y), 1 };
+	heap.push_back(root);
+	while (!heap.empty() && heap.front().distance2 <= best2) {
+		std::pop_heap(heap.begin(), heap.end(), fartherNode);
+		int n = heap.back().node;
+		heap.pop_back();
+		if (n < firstLeaf) {
+			for (int child = 2 * n; child <= 2 * n + 1; child++) {
+				NodeDistance next = { distance2(boxes[child], x, y), child };
+				if (next.distance2 <= best2) {
+					heap.push_back(next);
+					std::push_heap(heap.begin(), heap.end(), fartherNode);
+				}
+			}
+			continue;
+		}
+		int g = leafGroups[n - firstLeaf];
+		int endCurve = Min(LeafCurves * (g + 1), numCurves);
+		for (int i = LeafCurves * g; i < endCurve; i++) {
+			float cp[8];
+			spline->SegmentControlPoints(i, cp);
+			if (distance2(controlPointBox(cp), x, y) > best2) {
+				continue;
+			}
+			if (closestOnCurve(cp, x, y, best2, bestT)) {
+				hit.curve = i;
+				hit.t = (float)bestT;
+			}
+		}
+	}
+	if (hit.curve >= 0) {
+		float cp[8];
+		spline->SegmentControlPoints(hit.curve, cp);
+		double p[2], d1[2], d2[2];
+		evaluate(cp, bestT, p, d1, d2);
+		hit.distance = (float)sqrt(best2);
+		hit.x = (float)p[0];
+		hit.y = (float)p[1];
+	}
+	return hit;
+}
+
+// The points are taken in the order of their Morton codes, so that each thread
+//    works on points near each other, which visit the same parts of the hierarchy.
+void CurveBVH::Closest( const float* points, int numPoints, Hit* hits, float maxDistance ) const
+{
+	if (numCurves == 0 || numPoints <= MinPointsPerChunk) {
+		for (int k = 0; k < numPoints; k++) {
+			hits[k] = Closest(points[2 * k], points[2 * k + 1], maxDistance);
+		}
+		return;
+	}
+	ThreadPool* threads = spline->Threads();
+	std::vector<int> order;
+	const float bounds[4] = { boxes[1].minX, boxes[1].minY, boxes[1].maxX, boxes[1].maxY };
+	mortonOrder(points, numPoints, bounds, threads, MinPointsPerChunk, order);
+	forEachChunk(threads, 0, numPoints, MinPointsPerChunk, [this, points, hits, maxDistance, &order]( int first, int end ) {
+		for (int j = first; j < end; j++) {
+			int k = order[j];
+			hits[k] = Closest(points[2 * k], points[2 * k + 1], maxDistance);
+		}
+	});
+}
+
+void CurveBVH::Overlapping( float minX, float minY, float maxX, float maxY, std::vector<int>& curves ) const
+{
+	if (numCurves == 0) {
+		return;
+	}
+	int stack[64];				// At most one node per level waits on the stack
+	int top = 0;
+	stack[top++] = 1;
+	while (top > 0) {
+		int n = stack[--top];
+		const Box& box = boxes[n];
+		if (box.minX > maxX || box.maxX < minX || box.minY > maxY || box.maxY < minY) {
+			continue;
+		}
+		if (n < firstLeaf) {
+			stack[top++] = 2 * n + 1;
+			stack[top++] = 2 * n;
+			continue;
+		}
+		int g = leafGroups[n - firstLeaf];
+		int endCurve = Min(LeafCurves * (g + 1), numCurves);
+		for (int i = LeafCurves * g; i < endCurve; i++) {
+			float cp[8];
+			spline->SegmentControlPoints(i, cp);
+			Box b = controlPointBox(cp);
+			if (b.minX <= maxX && b.maxX >= minX && b.minY <= maxY && b.maxY >= minY) {
+				curves.push_back(i);
+			}
+		}
+	}
+}
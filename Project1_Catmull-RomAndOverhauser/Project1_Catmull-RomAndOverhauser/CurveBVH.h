@@ -0,0 +1,98 @@
+/*
+ * CurveBVH.h
+ *
+ * Bounding volume hierarchy over the Bezier curves of a CatmullRomSpline,
+ * for finding the point on the curve nearest a given point: snapping the
+ * cursor to the curve, or projecting many measured points onto a curve.
+ *
+ * A Bezier curve lies in the convex hull of its control points, so the box
+ * around its 4 control points bounds it.  Each leaf holds LeafCurves
+ * consecutive curves, which are next to each other, so its box is tight.
+ * Build() sorts the leaves by the Morton codes of the centers of their
+ * boxes, which keeps leaves that are near each other together even where
+ * the curve comes back to the same place.  The hierarchy is a complete
+ * binary tree over the leaves in that order, stored as an implicit heap:
+ * node n has children 2n and 2n+1, so it needs no pointers.  A query
+ * visits the boxes nearest first, and stops at the first box that is
+ * further away than the nearest point found so far.
+ *
+ * Moving a dot changes the boxes of 4 curves, and Refit() updates those
+ * boxes and their ancestors in O(log NumCurves()) time.  The leaves keep
+ * their places, so after many large moves Build() gives tighter boxes.
+ * Other edits change the number or the order of the curves, and the
+ * hierarchy must then be built again.  In the Polyline mode the "curves"
+ * are the line segments between the dots.
+ *
+ * Software is "as-is" and carries no warranty.  It may be used without
+ *   restriction, but if you modify it, please change the filenames to
+ *   prevent confusion between different versions.
+ */
+
+#ifndef CURVE_BVH_H
+#define CURVE_BVH_H
+
+#include <float.h>
+#include <vector>
+
+class CatmullRomSpline;
+
+class CurveBVH {
+
+public:
+	// The point at parameter t of Bezier curve i, and its distance from the query point.
+	//    curve is -1 if no point on the curve was within the maximum distance.
+	struct Hit {
+		int curve;
+		float t;
+		float distance;
+		float x, y;
+	};
+
+	static const int LeafCurves = 4;		// Curves in each leaf
+
+public:
+	CurveBVH();
+
+	// Builds the boxes, on the threads of the spline (see CatmullRomSpline::SetThreadCount)
+	void Build( const CatmullRomSpline& spline );
+	void Clear();
+
+	int NumCurves() const { return numCurves; }
+
+	// Updates the boxes of curves firstCurve, ..., endCurve-1, which have changed.
+	//    The number of curves must not have changed.
+	void Refit( int firstCurve, int endCurve );
+	void RefitDot( int i ) { Refit(i - 2, i + 2); }		// After CatmullRomSpline::ChangePoint(i, ...)
+
+	// The point on the curve nearest (x,y), if it is within maxDistance.
+	Hit Closest( float x, float y, float maxDistance = FLT_MAX ) const;
+
+	// The same for each of numPoints points, as (x,y) pairs, split among the threads
+	//    of the spline.  The results do not depend on the number of threads.
+	void Closest( const float* points, int numPoints, Hit* hits, float maxDistance = FLT_MAX ) const;
+
+	// Appends to curves the curves whose boxes overlap the box [minX,maxX] x [minY,maxY],
+	//    which are the only curves that can meet that box.
+	void Overlapping( float minX, float minY, float maxX, float maxY, std::vector<int>& curves ) const;
+
+private:
+	struct Box {
+		float minX, minY, maxX, maxY;
+	};
+
+	static Box controlPointBox( const float cp[8] );
+	Box groupBox( int g ) const;
+	void fitParents( int firstNode, int endNode );
+	static float distance2( const Box& box, float x, float y );
+
+private:
+	const CatmullRomSpline* spline;
+	int numCurves;
+	int numGroups;						// Group g is curves LeafCurves*g, ..., LeafCurves*g+LeafCurves-1
+	int firstLeaf;						// Node of leaf 0, a power of 2
+	std::vector<Box> boxes;				// Node 0 is unused; node 1 is the root
+	std::vector<int> leafGroups;		// The group of curves in each leaf
+	std::vector<int> groupLeaves;		// The leaf of each group
+};
+
+#endif	// CURVE_BVH_H
@@ -0,0 +1,251 @@
+/*
+ * CurveFile.cpp
+ *
+ * Binary file format for the curves of the CatmullRomSpline engine.
+ * See CurveFile.h.
+ *
+ * Software is "as-is" and carries no warranty.  It may be used without
+ *   restriction, but if you modify it, please change the filenames to
+ *   prevent confusion between different versions.
+ */
+
+#define _CRT_SECURE_NO_WARNINGS				// For fopen
+
+#include "CurveFile.h"
+#include "CatmullRomSpline.h"
+
+#include <assert.h>
+#include <float.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static_assert(sizeof(CurveFileHeader) == 120, "The header has no padding, so every compiler lays it out the same way");
+static_assert(sizeof(int) == sizeof(int32_t) && sizeof(float) == 4, "The arrays hold 32-bit ints and floats");
+
+static const char CurveFileMagic[8] = { 'C', 'R', 'S', 'P', 'L', 'I', 'N', 'E' };
+
+static uint64_t alignUp( uint64_t n )
+{
+	return (n + CurveFileAlignment - 1) / CurveFileAlignment * CurveFileAlignment;
+}
+
+void CurveFileLayout( CurveFileHeader& header )
+{
+	uint64_t sizes[CurveFileNumArrays] = {
+		2 * sizeof(float) * (uint64_t)header.numDots,
+		2 * sizeof(float) * (uint64_t)header.numControlPoints,
+		2 * sizeof(float) * (uint64_t)header.numPointsOnCurve,
+		sizeof(int32_t) * (uint64_t)header.numCurves,
+		sizeof(int32_t) * (uint64_t)header.numCurves };
+	uint64_t offset = alignUp(sizeof(CurveFileHeader));
+	for (int k = 0; k < CurveFileNumArrays; k++) {
+		header.offset[k] = offset;
+		offset = alignUp(offset + sizes[k]);
+	}
+	header.fileSize = offset;
+}
+
+CurveFile::CurveFile()
+	: data(nullptr), size(0), header(nullptr)
+#ifdef _WIN32
+	, fileHandle(INVALID_HANDLE_VALUE), mappingHandle(nullptr)
+#endif
+{
+}
+
+CurveFile::~CurveFile()
+{
+	Close();
+}
+
+bool CurveFile::Open( const char* filename )
+{
+	Close();
+#ifdef _WIN32
+	// FILE_SHARE_DELETE lets a writer rename a new file over this one while it is open
+	fileHandle = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING,
+							 FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (fileHandle == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart < (LONGLONG)sizeof(CurveFileHeader)
+		|| (unsigned long long)fileSize.QuadPart > (size_t)-1) {
+		Close();
+		return false;
+	}
+	size = (size_t)fileSize.QuadPart;
+	mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mappingHandle != nullptr) {
+		data = (const char*)MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+	}
+#else
+	int fd = open(filename, O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+	struct stat status;
+	if (fstat(fd, &status) == 0 && status.st_size >= (off_t)sizeof(CurveFileHeader)
+		&& (unsigned long long)status.st_size <= (size_t)-1) {
+		size = (size_t)status.st_size;
+		void* mapping = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+		data = (mapping != MAP_FAILED) ? (const char*)mapping : nullptr;
+	}
+	close(fd);				// The mapping keeps the file open
+#endif
+	if (data == nullptr) {
+		Close();
+		return false;
+	}
+	header = (const CurveFileHeader*)data;
+	if (!isValid()) {
+		Close();
+		return false;
+	}
+	return true;
+}
+
+void CurveFile::Close()
+{
+#ifdef _WIN32
+	if (data != nullptr) {
+		UnmapViewOfFile(data);
+	}
+	if (mappingHandle != nullptr) {
+		CloseHandle(mappingHandle);
+	}
+	if (fileHandle != INVALID_HANDLE_VALUE) {
+		CloseHandle(fileHandle);
+	}
+	mappingHandle = nullptr;
+	fileHandle = INVALID_HANDLE_VALUE;
+#else
+	if (data != nullptr) {
+		munmap((void*)data, size);
+	}
+#endif
+	data = nullptr;
+	size = 0;
+	header = nullptr;
+}
+
+// Checks the header, and the segment arrays, which say which entries of the
+//    array of curve points are drawn.  The other arrays are not read here.
+// The settings must be ones that CatmullRomSpline::Load can pass on to the
+//    spline: the comparisons are written so that NaNs fail them.
+bool CurveFile::isValid() const
+{
+	const CurveFileHeader& h = *header;
+	if (memcmp(h.magic, CurveFileMagic, sizeof(h.magic)) != 0 || h.version != CurveFileVersion
+		|| h.byteOrder != CurveFileByteOrder) {
+		return false;
+	}
+	if (h.mode < 0 || h.mode > 4 || h.tessellation < 0 || h.tessellation > 3
+		|| h.meshRes <= 0 || h.meshRes > CatmullRomSpline::MaxMeshRes || h.numDots < 0) {
+		return false;
+	}
+	if (!(h.alpha >= 0.0f && h.alpha <= 1.0f) || !(h.flatnessTolerance > 0.0f && h.flatnessTolerance <= FLT_MAX)) {
+		return false;
+	}
+	if ((h.numCurves > 0) != (h.mode != 0 && h.numDots > 1)) {
+		return false;				// The same rule as CatmullRomSpline::HasCurve
+	}
+	if (h.numCurves == 0) {
+		if (h.numControlPoints != 0 || h.numPointsOnCurve != 0) {
+			return false;
+		}
+	}
+	else if (h.numCurves != h.numDots - 1 || h.numControlPoints != 3 * (int64_t)h.numCurves + 1
+			 || h.numPointsOnCurve != (int64_t)h.meshRes * h.numCurves + 1) {
+		return false;
+	}
+
+	CurveFileHeader layout = h;
+	CurveFileLayout(layout);
+	if (memcmp(layout.offset, h.offset, sizeof(h.offset)) != 0 || layout.fileSize != h.fileSize
+		|| h.fileSize > size) {
+		return false;
+	}
+
+	const int* firsts = SegmentFirsts();
+	const int* counts = SegmentCounts();
+	for (int i = 0; i < h.numCurves; i++) {
+		if (firsts[i] != h.meshRes * i || counts[i] < 2 || counts[i] > h.meshRes + 1) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool writeBytes( FILE* file, const void* bytes, size_t n, uint64_t& position )
+{
+	position += n;
+	return n == 0 || fwrite(bytes, 1, n, file) == n;
+}
+
+// Writes zeros up to the given position, which must not be behind the current position
+static bool writePadding( FILE* file, uint64_t to, uint64_t& position )
+{
+	static const char zeros[CurveFileAlignment] = { 0 };
+	assert( position <= to );
+	while (position < to) {
+		size_t n = (to - position < sizeof(zeros)) ? (size_t)(to - position) : sizeof(zeros);
+		if (!writeBytes(file, zeros, n, position)) {
+			return false;
+		}
+	}
+	return position == to;
+}
+
+// On Windows this can fail while another process holds the old file: see CurveFile::Write.
+static bool replaceFile( const char* from, const char* to )
+{
+#ifdef _WIN32
+	return MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+	return rename(from, to) == 0;
+#endif
+}
+
+bool CurveFile::Write( const char* filename, CurveFileHeader& header,
+					   const std::vector<Chunk> arrays[CurveFileNumArrays] )
+{
+	memcpy(header.magic, CurveFileMagic, sizeof(header.magic));
+	header.version = CurveFileVersion;
+	header.byteOrder = CurveFileByteOrder;
+	header.reserved = 0;
+	CurveFileLayout(header);
+
+	std::string tempName = std::string(filename) + ".tmp";
+	FILE* file = fopen(tempName.c_str(), "wb");
+	if (file == nullptr) {
+		return false;
+	}
+	uint64_t position = 0;
+	bool ok = writeBytes(file, &header, sizeof(header), position);
+	for (int k = 0; k < CurveFileNumArrays && ok; k++) {
+		ok = writePadding(file, header.offset[k], position);
+		for (size_t j = 0; j < arrays[k].size() && ok; j++) {
+			ok = writeBytes(file, arrays[k][j].data, arrays[k][j].size, position);
+		}
+	}
+	ok = ok && writePadding(file, header.fileSize, position);
+	ok = (fclose(file) == 0) && ok;
+	ok = ok && replaceFile(tempName.c_str(), filename);
+	if (!ok) {
+		remove(tempName.c_str());
+	}
+	return ok;
+}
@@ -0,0 +1,140 @@
+/*
+ * CurveFile.h
+ *
+ * Binary file format for the curves of the CatmullRomSpline engine, and
+ * read-only access to such a file through a memory mapping.
+ *
+ * A curve file holds a header followed by the arrays of the spline: the
+ * dots, the Bezier control points, the points on the curve and, for
+ * glMultiDrawArrays, the first entry and the number of entries of each
+ * Bezier curve.  Each array starts at a multiple of CurveFileAlignment
+ * bytes, and holds the entries in the order of the dots, starting with
+ * dot 0, in the layout of CatmullRomSpline::CurvePoints() and so on: curve i
+ * has control points 3*i, ..., 3*i+3 and curve points MeshResolution()*i, ...
+ *
+ * CurveFile maps a file and gives the arrays in place, so opening even a
+ * curve with millions of dots reads only its header and its arrays of
+ * segments, and several processes can share one file.
+ * CatmullRomSpline::Save writes a file, and CatmullRomSpline::Load copies
+ * one into a spline to be edited.
+ *
+ * The numbers are stored in the byte order of the machine that wrote the
+ * file, and a file with the other byte order is rejected.
+ *
+ * Software is "as-is" and carries no warranty.  It may be used without
+ *   restriction, but if you modify it, please change the filenames to
+ *   prevent confusion between different versions.
+ */
+
+#ifndef CURVE_FILE_H
+#define CURVE_FILE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+const int CurveFileAlignment = 64;			// In bytes; also the size of a cache line
+const uint32_t CurveFileVersion = 1;
+const uint32_t CurveFileByteOrder = 0x01020304;
+
+// The arrays of a curve file, in the order they are stored
+enum CurveFileArray { CurveFileDots, CurveFileControlPoints, CurveFilePointsOnCurve,
+					  CurveFileSegmentFirsts, CurveFileSegmentCounts, CurveFileNumArrays };
+
+struct CurveFileHeader {
+	char magic[8];							// "CRSPLINE"
+	uint32_t version;						// CurveFileVersion
+	uint32_t byteOrder;						// CurveFileByteOrder
+	int32_t mode;							// CatmullRomSpline::Parametrization
+	int32_t tessellation;
+	int32_t meshRes;
+	int32_t numDots;
+	float alpha;
+	float flatnessTolerance;
+	float initialVelocity[2];
+	float finalVelocity[2];
+	int32_t numControlPoints;				// Zero if there is no curve
+	int32_t numPointsOnCurve;
+	int32_t numCurves;						// Entries of the segment arrays
+	int32_t reserved;
+	uint64_t offset[CurveFileNumArrays];	// Byte offset of each array
+	uint64_t fileSize;
+};
+
+// Sets the offsets and the file size of the header from its numbers of entries
+void CurveFileLayout( CurveFileHeader& header );
+
+class CurveFile {
+
+public:
+	// Part of an array to be written
+	struct Chunk {
+		const void* data;
+		size_t size;						// In bytes
+	};
+
+public:
+	CurveFile();
+	~CurveFile();
+
+	// Maps the file read-only.  Returns false if it cannot be read or is not a valid curve
+	//    file.  A valid file has settings the spline accepts: a MeshResolution() of at most
+	//    CatmullRomSpline::MaxMeshRes, an Alpha() in [0,1] and a finite, positive
+	//    FlatnessTolerance().
+	bool Open( const char* filename );
+	void Close();
+	bool IsOpen() const { return header != nullptr; }
+
+	// Writes a curve file with the given header, whose layout is set here.  Each
+	//    array is the concatenation of its chunks.  The file is written under a
+	//    temporary name and then renamed, so processes that have the old file
+	//    open keep seeing the old file.  Returns false on failure, leaving the old
+	//    file as it was.  On Windows, the rename can fail while another process
+	//    holds the old file: Open shares it for deletion, but Windows may refuse
+	//    to replace a file that is mapped.  Close it, or write to another name.
+	static bool Write( const char* filename, CurveFileHeader& header,
+					   const std::vector<Chunk> arrays[CurveFileNumArrays] );
+
+	const CurveFileHeader& Header() const { return *header; }
+	int GetMode() const { return header->mode; }
+	float Alpha() const { return header->alpha; }
+	int GetTessellation() const { return header->tessellation; }
+	int MeshResolution() const { return header->meshRes; }
+	float FlatnessTolerance() const { return header->flatnessTolerance; }
+	bool HasCurve() const { return header->numCurves > 0; }
+
+	// The same as for a CatmullRomSpline whose first dot is in slot 0
+	int NumDots() const { return header->numDots; }
+	const float* Dot( int i ) const { return Dots() + 2 * i; }
+	int NumControlPoints() const { return header->numControlPoints; }
+	const float* CurveControlPoints( int i ) const { return ControlPoints() + 6 * i; }
+	int NumPointsOnCurve() const { return header->numPointsOnCurve; }
+	const float* CurvePoints( int i ) const { return PointsOnCurve() + 2 * header->meshRes * i; }
+	int SegmentPointCount( int i ) const { return SegmentCounts()[i]; }
+
+	// The arrays, in place.  There are NumCurves() segments, one per Bezier curve.
+	int NumCurves() const { return header->numCurves; }
+	const float* Dots() const { return (const float*)array(CurveFileDots); }
+	const float* ControlPoints() const { return (const float*)array(CurveFileControlPoints); }
+	const float* PointsOnCurve() const { return (const float*)array(CurveFilePointsOnCurve); }
+	const int* SegmentFirsts() const { return (const int*)array(CurveFileSegmentFirsts); }
+	const int* SegmentCounts() const { return (const int*)array(CurveFileSegmentCounts); }
+
+private:
+	CurveFile( const CurveFile& ) = delete;
+	CurveFile& operator=( const CurveFile& ) = delete;
+
+	const char* array( CurveFileArray which ) const { return data + header->offset[which]; }
+	bool isValid() const;
+
+private:
+	const char* data;						// The mapped file
+	size_t size;
+	const CurveFileHeader* header;			// nullptr if no file is open
+#ifdef _WIN32
+	void* fileHandle;
+	void* mappingHandle;
+#endif
+};
+
+#endif	// CURVE_FILE_H
@@ -0,0 +1,441 @@
+/*
+ * CurveIntersection.cpp
+ *
+ * Finds the points where CatmullRomSplines cross each other or themselves.
+ * See CurveIntersection.h.
+ *
+ * Software is "as-is" and carries no warranty.  It may be used without
+ *   restriction, but if you modify it, please change the filenames to
+ *   prevent confusion between different versions.
+ */
+
+#include "CurveIntersection.h"
+#include "CatmullRomSpline.h"
+#include "CurveBVH.h"
+#include "ThreadPool.h"
+
+#include <float.h>
+#include <math.h>
+#include <algorithm>
+
+// A piece is flat when its inner control points are within this fraction of its
+//    chord from the points 1/3 and 2/3 along the chord, so that it bends by less
+//    than about this angle, in radians.  Where two curves cross twice close together
+//    they are nearly parallel, and pieces that are this straight tell the two apart.
+//    Pieces this fraction of the size of the two curves, or a few units in the last
+//    place of their coordinates, are flat in any case.
+static const float FlatnessFraction = 1.0e-3f;
+static const float MinFlatnessFraction = 1.0e-6f;
+static const float MinFlatnessUlps = 8.0f;
+
+// A crossing found by Newton's method is kept if the two curves are within this
+//    fraction of their size of each other there.
+static const double MaxResidualFraction = 1.0e-5;
+
+// Crossings of two chords a little beyond their ends are tried as well, since
+//    the curves are not quite straight.
+static const double ChordSlack = 0.01;
+
+static const int MaxDepth = 48;				// Of subdivision, counting both curves
+static const int MaxLoopDepth = 16;			// Of the search for a loop in one curve
+static const int MaxNewtonSteps = 16;
+static const double DuplicateParameter = 1.0e-5;	// Crossings this close on both curves are the same
+static const double JointFraction = 1.0e-4;	// Of the size of two curves, around the point where they join
+static const double EndParameter = 1.0e-9;	// A crossing this close to the end of a segment is at the next dot
+
+static const int BlockSegments = 256;		// Segments of the first spline per chunk of work
+
+namespace {
+
+struct Box {
+	float minX, minY, maxX, maxY;
+};
+
+struct ParamPair {
+	double s, t;
+};
+
+// Scratch space of one thread
+struct Workspace {
+	std::vector<int> candidates;
+	std::vector<ParamPair> found;
+	std::vector<ParamPair> crossings;
+};
+
+}
+
+static Box controlPointBox( const float cp[8] )
+{
+	Box box = { cp[0], cp[1], cp[0], cp[1] };
+	for (int k = 2; k < 8; k += 2) {
+		box.minX = Min(box.minX, cp[k]);
+		box.maxX = Max(box.maxX, cp[k]);
+		box.minY = Min(box.minY, cp[k + 1]);
+		box.maxY = Max(box.maxY, cp[k + 1]);
+	}
+	return box;
+}
+
+static float boxSize( const Box& box )
+{
+	return Max(box.maxX - box.minX, box.maxY - box.minY);
+}
+
+// Largest magnitude of a coordinate in the box
+static float boxMagnitude( const Box& box )
+{
+	return Max(Max(fabsf(box.minX), fabsf(box.maxX)), Max(fabsf(box.minY), fabsf(box.maxY)));
+}
+
+static float chordLength( const float cp[8] )
+{
+	return sqrtf((cp[6] - cp[0]) * (cp[6] - cp[0]) + (cp[7] - cp[1]) * (cp[7] - cp[1]));
+}
+
+// How far the inner control points are from the points 1/3 and 2/3 along the chord.
+//    The curve is within 3/4 of this of the chord, at the same parameter.
+static float flatness( const float cp[8] )
+{
+	float d = 0.0f;
+	for (int k = 0; k < 2; k++) {
+		d = Max(d, fabsf(3.0f * cp[2 + k] - 2.0f * cp[k] - cp[6 + k]));
+		d = Max(d, fabsf(3.0f * cp[4 + k] - cp[k] - 2.0f * cp[6 + k]));
+	}
+	return d * (1.0f / 3.0f);
+}
+
+// Splits a Bezier curve at t = 1/2 by de Casteljau's algorithm
+static void split( const float cp[8], float left[8], float right[8] )
+{
+	for (int k = 0; k < 2; k++) {
+		float p01 = 0.5f * (cp[k] + cp[2 + k]);
+		float p12 = 0.5f * (cp[2 + k] + cp[4 + k]);
+		float p23 = 0.5f * (cp[4 + k] + cp[6 + k]);
+		float p012 = 0.5f * (p01 + p12);
+		float p123 = 0.5f * (p12 + p23);
+		float mid = 0.5f * (p012 + p123);
+		left[k] = cp[k];
+		left[2 + k] = p01;
+		left[4 + k] = p012;
+		left[6 + k] = mid;
+		right[k] = mid;
+		right[2 + k] = p123;
+		right[4 + k] = p23;
+		right[6 + k] = cp[6 + k];
+	}
+}
+
+// Total angle the control polygon turns through.  The curve turns through no more.
+static double turning( const float cp[8] )
+{
+	double total = 0.0;
+	double lastX = 0.0, lastY = 0.0;
+	bool haveLast = false;
+	for (int k = 0; k < 6; k += 2) {
+		double x = cp[k + 2] - cp[k], y = cp[k + 3] - cp[k + 1];
+		if (x == 0.0 && y == 0.0) {
+			continue;
+		}
+		if (haveLast) {
+			total += fabs(atan2(lastX * y - lastY * x, lastX * x + lastY * y));
+		}
+		lastX = x;
+		lastY = y;
+		haveLast = true;
+	}
+	return total;
+}
+
+// Position and first derivative of the Bezier curve with the control points cp
+static void evaluate( const float cp[8], double t, double p[2], double d1[2] )
+{
+	double s = 1.0 - t;
+	for (int k = 0; k < 2; k++) {
+		double a = cp[k], b = cp[2 + k], c = cp[4 + k], d = cp[6 + k];
+		p[k] = s * s * s * a + 3.0 * s * t * (s * b + t * c) + t * t * t * d;
+		d1[k] = 3.0 * (s * s * (b - a) + 2.0 * s * t * (c - b) + t * t * (d - c));
+	}
+}
+
+// Where the chords of a and b cross, as fractions u and v along them
+static bool crossChords( const float a[8], const float b[8], double& u, double& v )
+{
+	double rx = (double)a[6] - a[0], ry = (double)a[7] - a[1];
+	double sx = (double)b[6] - b[0], sy = (double)b[7] - b[1];
+	double qx = (double)b[0] - a[0], qy = (double)b[1] - a[1];
+	double denom = rx * sy - ry * sx;
+	if (denom == 0.0) {
+		return false;			// Parallel, or a chord of zero length
+	}
+	u = (qx * sy - qy * sx) / denom;
+	v = (qx * ry - qy * rx) / denom;
+	if (!(u >= -ChordSlack && u <= 1.0 + ChordSlack && v >= -ChordSlack && v <= 1.0 + ChordSlack)) {
+		return false;
+	}
+	u = Min(Max(u, 0.0), 1.0);
+	v = Min(Max(v, 0.0), 1.0);
+	return true;
+}
+
+// Appends to found the places where the chords of flat pieces of a and b cross,
+//    with a for [a0, a1] and b for [b0, b1] of the curves they were split from.
+static void subdivide( const float a[8], double a0, double a1, const float b[8], double b0, double b1,
+					   float tolerance, int depth, std::vector<ParamPair>& found )
+{
+	Box boxA = controlPointBox(a);
+	Box boxB = controlPointBox(b);
+	if (boxA.minX > boxB.maxX + tolerance || boxB.minX > boxA.maxX + tolerance
+		|| boxA.minY > boxB.maxY + tolerance || boxB.minY > boxA.maxY + tolerance) {
+		return;
+	}
+	float flatA = flatness(a);
+	float flatB = flatness(b);
+	bool straightA = flatA <= Max(FlatnessFraction * chordLength(a), tolerance);
+	bool straightB = flatB <= Max(FlatnessFraction * chordLength(b), tolerance);
+	if ((straightA && straightB) || depth >= MaxDepth) {
+		double u, v;
+		if (crossChords(a, b, u, v)) {
+			ParamPair crossing = { a0 + u * (a1 - a0), b0 + v * (b1 - b0) };
+			found.push_back(crossing);
+		}
+		return;
+	}
+	float left[8], right[8];
+	if (!straightA && (straightB || flatA >= flatB)) {
+		split(a, left, right);
+		double mid = 0.5 * (a0 + a1);
+		subdivide(left, a0, mid, b, b0, b1, tolerance, depth + 1, found);
+		subdivide(right, mid, a1, b, b0, b1, tolerance, depth + 1, found);
+	}
+	else {
+		split(b, left, right);
+		double mid = 0.5 * (b0 + b1);
+		subdivide(a, a0, a1, left, b0, mid, tolerance, depth + 1, found);
+		subdivide(a, a0, a1, right, mid, b1, tolerance, depth + 1, found);
+	}
+}
+
+// Newton's method on A(s) - B(t) = 0 from (s,t).  Stops when a step no longer
+//    brings the curves closer, and returns the distance between them.
+static double polish( const float a[8], const float b[8], double& s, double& t )
+{
+	double pa[2], da[2], pb[2], db[2];
+	evaluate(a, s, pa, da);
+	evaluate(b, t, pb, db);
+	double fx = pa[0] - pb[0], fy = pa[1] - pb[1];
+	double residual = sqrt(fx * fx + fy * fy);
+	for (int step = 0; step < MaxNewtonSteps && residual > 0.0; step++) {
+		double det = db[0] * da[1] - da[0] * db[1];
+		if (det == 0.0) {
+			break;				// The curves are parallel here
+		}
+		double nextS = Min(Max(s + (fx * db[1] - db[0] * fy) / det, 0.0), 1.0);
+		double nextT = Min(Max(t + (da[1] * fx - da[0] * fy) / det, 0.0), 1.0);
+		evaluate(a, nextS, pa, da);
+		evaluate(b, nextT, pb, db);
+		double nextFx = pa[0] - pb[0], nextFy = pa[1] - pb[1];
+		double nextResidual = sqrt(nextFx * nextFx + nextFy * nextFy);
+		if (!(nextResidual < residual)) {
+			break;
+		}
+		s = nextS;
+		t = nextT;
+		fx = nextFx;
+		fy = nextFy;
+		residual = nextResidual;
+	}
+	return residual;
+}
+
+// Appends to crossings the points where curves a and b cross, in order of s.
+//    If skipJoint, the end of a is the start of b, and crossings there are left out.
+static void intersectPair( const float a[8], const float b[8], bool skipJoint, Workspace& work,
+						   std::vector<ParamPair>& crossings )
+{
+	Box boxA = controlPointBox(a);
+	Box boxB = controlPointBox(b);
+	float size = Max(boxSize(boxA), boxSize(boxB));
+	float magnitude = Max(boxMagnitude(boxA), boxMagnitude(boxB));
+	float tolerance = Max(MinFlatnessFraction * size, MinFlatnessUlps * FLT_EPSILON * magnitude);
+	work.found.clear();
+	subdivide(a, 0.0, 1.0, b, 0.0, 1.0, tolerance, 0, work.found);
+	if (work.found.empty()) {
+		return;
+	}
+
+	size_t first = crossings.size();
+	for (ParamPair crossing : work.found) {
+		if (polish(a, b, crossing.s, crossing.t) > MaxResidualFraction * size) {
+			continue;			// The chords crossed, but the curves only come near each other
+		}
+		if (skipJoint) {
+			double p[2], d1[2];
+			evaluate(a, crossing.s, p, d1);
+			double dx = p[0] - a[6], dy = p[1] - a[7];
+			if (sqrt(dx * dx + dy * dy) <= JointFraction * size && crossing.s > 0.5 && crossing.t < 0.5) {
+				continue;
+			}
+		}
+		crossings.push_back(crossing);
+	}
+
+	// The same crossing may be found from several pairs of pieces
+	std::sort(crossings.begin() + first, crossings.end(), []( const ParamPair& p, const ParamPair& q ) {
+		return p.s < q.s || (p.s == q.s && p.t < q.t);
+	});
+	size_t kept = first;
+	for (size_t k = first; k < crossings.size(); k++) {
+		bool duplicate = false;
+		for (size_t j = first; j < kept && !duplicate; j++) {
+			duplicate = fabs(crossings[k].s - crossings[j].s) <= DuplicateParameter
+						&& fabs(crossings[k].t - crossings[j].t) <= DuplicateParameter;
+		}
+		if (!duplicate) {
+			crossings[kept++] = crossings[k];
+		}
+	}
+	crossings.resize(kept);
+}
+
+// Appends to crossings the points where curve cp, for [t0, t1] of the curve it
+//    was split from, crosses itself.  Only a curve that turns through more than
+//    a half turn can make a loop.
+static void intersectLoop( const float cp[8], double t0, double t1, int depth, Workspace& work,
+						   std::vector<ParamPair>& crossings )
+{
+	if (depth >= MaxLoopDepth || turning(cp) <= 3.14159265358979323846) {
+		return;
+	}
+	float left[8], right[8];
+	split(cp, left, right);
+	double mid = 0.5 * (t0 + t1);
+	size_t first = crossings.size();
+	intersectPair(left, right, true, work, crossings);
+	for (size_t k = first; k < crossings.size(); k++) {
+		crossings[k].s = t0 + crossings[k].s * (mid - t0);
+		crossings[k].t = mid + crossings[k].t * (t1 - mid);
+	}
+	intersectLoop(left, t0, mid, depth + 1, work, crossings);
+	intersectLoop(right, mid, t1, depth + 1, work, crossings);
+}
+
+int IntersectBeziers( const float cpA[8], const float cpB[8], float* tA, float* tB, int maxHits )
+{
+	Workspace work;
+	intersectPair(cpA, cpB, false, work, work.crossings);
+	int numHits = Min((int)work.crossings.size(), maxHits);
+	for (int k = 0; k < numHits; k++) {
+		tA[k] = (float)work.crossings[k].s;
+		tB[k] = (float)work.crossings[k].t;
+	}
+	return numHits;
+}
+
+static int numSegments( const CatmullRomSpline& spline )
+{
+	return Max(spline.NumDots() - 1, 0);
+}
+
+// Appends the crossings of segments first, ..., end-1 of a with the segments of b.
+//    If a and b are the same spline, only segments segB >= segA are tried.
+static void intersectSegments( const CatmullRomSpline& a, int curveA, const CatmullRomSpline& b, int curveB,
+							   const CurveBVH& bvhB, int first, int end, Workspace& work,
+							   std::vector<CurveIntersection>& intersections )
+{
+	bool same = (&a == &b);
+	int endA = numSegments(a), endB = numSegments(b);
+	for (int segA = first; segA < end; segA++) {
+		float cpA[8];
+		a.SegmentControlPoints(segA, cpA);
+		Box box = controlPointBox(cpA);
+		float slack = MinFlatnessFraction * boxSize(box);
+		work.candidates.clear();
+		bvhB.Overlapping(box.minX - slack, box.minY - slack, box.maxX + slack, box.maxY + slack, work.candidates);
+		std::sort(work.candidates.begin(), work.candidates.end());
+
+		for (int segB : work.candidates) {
+			if (same && segB < segA) {
+				continue;
+			}
+			work.crossings.clear();
+			if (same && segB == segA) {
+				intersectLoop(cpA, 0.0, 1.0, 0, work, work.crossings);
+			}
+			else {
+				float cpB[8];
+				b.SegmentControlPoints(segB, cpB);
+				intersectPair(cpA, cpB, same && segB == segA + 1, work, work.crossings);
+			}
+			for (const ParamPair& crossing : work.crossings) {
+				// A crossing at a dot is reported at the start of the next segment
+				if ((crossing.s >= 1.0 - EndParameter && segA + 1 < endA)
+					|| (crossing.t >= 1.0 - EndParameter && segB + 1 < endB)) {
+					continue;
+				}
+				double p[2], d1[2];
+				evaluate(cpA, crossing.s, p, d1);
+				CurveIntersection hit = { curveA, segA, (float)crossing.s, curveB, segB, (float)crossing.t,
+										  (float)p[0], (float)p[1] };
+				intersections.push_back(hit);
+			}
+		}
+	}
+}
+
+// The segments of a are split into blocks of BlockSegments, so that the results
+//    are in the same order for any number of threads.
+static void intersectSplines( const CatmullRomSpline& a, int curveA, const CatmullRomSpline& b, int curveB,
+							  const CurveBVH& bvhB, std::vector<CurveIntersection>& intersections )
+{
+	int numSegs = numSegments(a);
+	if (numSegs == 0 || bvhB.NumCurves() == 0) {
+		return;
+	}
+	int numBlocks = (numSegs + BlockSegments - 1) / BlockSegments;
+	ThreadPool* threads = a.Threads();
+	if (threads == nullptr || numBlocks <= 1) {
+		Workspace work;
+		intersectSegments(a, curveA, b, curveB, bvhB, 0, numSegs, work, intersections);
+		return;
+	}
+	std::vector<std::vector<CurveIntersection>> blockIntersections(numBlocks);
+	threads->ParallelFor(0, numBlocks, 1, [&]( int firstBlock, int endBlock ) {
+		Workspace work;
+		for (int k = firstBlock; k < endBlock; k++) {
+			int end = Min((k + 1) * BlockSegments, numSegs);
+			intersectSegments(a, curveA, b, curveB, bvhB, k * BlockSegments, end, work, blockIntersections[k]);
+		}
+	});
+	for (const std::vector<CurveIntersection>& block : blockIntersections) {
+		intersections.insert(intersections.end(), block.begin(), block.end());
+	}
+}
+
+void IntersectCurves( const CatmullRomSpline& a, int curveA, const CatmullRomSpline& b, int curveB,
+					  std::vector<CurveIntersection>& intersections )
+{
+	CurveBVH bvhB;
+	bvhB.Build(b);
+	intersectSplines(a, curveA, b, curveB, bvhB, intersections);
+}
+
+void IntersectCurves( const CatmullRomSpline& a, int curveA, std::vector<CurveIntersection>& intersections )
+{
+	CurveBVH bvh;
+	bvh.Build(a);
+	intersectSplines(a, curveA, a, curveA, bvh, intersections);
+}
+
+void IntersectCurves( const CatmullRomSpline* const curves[], int numCurves,
+					  std::vector<CurveIntersection>& intersections )
+{
+	std::vector<CurveBVH> bvhs(numCurves);
+	for (int i = 0; i < numCurves; i++) {
+		bvhs[i].Build(*curves[i]);
+	}
+	for (int i = 0; i < numCurves; i++) {
+		for (int j = i; j < numCurves; j++) {
+			intersectSplines(*curves[i], i, *curves[j], j, bvhs[j], intersections);
+		}
+	}
+}
@@ -0,0 +1,69 @@
+/*
+ * CurveIntersection.h
+ *
+ * Finds the points where CatmullRomSplines cross each other or themselves.
+ *
+ * Each spline is a chain of Bezier curves, its segments.  The splines of a
+ * set are numbered, and an intersection gives, for each of the two
+ * splines, its number, the segment and the parameter t on that segment.
+ *
+ * Most pairs of segments are far apart.  A CurveBVH over the segments of
+ * one spline finds, for each segment of the other, the few segments whose
+ * boxes overlap its box, in O(log n) time.  Each pair that is left is
+ * refined by subdivision: a Bezier curve lies in the box of its control
+ * points, so two curves whose boxes do not meet do not cross, and otherwise
+ * the curve that is further from a straight line is split in half at
+ * t = 1/2, until both pieces are flat.  Where the chords of two flat pieces
+ * cross, Newton's method on the two cubics gives the crossing to full
+ * float precision.
+ *
+ * Two consecutive segments of a spline always meet at the dot between them,
+ * and that point is not reported.  A single segment can cross itself in a
+ * loop, which is found by splitting it until each piece turns by less than
+ * a half turn.  Curves that overlap along a stretch, or touch without
+ * crossing, give only some of their common points.
+ *
+ * Software is "as-is" and carries no warranty.  It may be used without
+ *   restriction, but if you modify it, please change the filenames to
+ *   prevent confusion between different versions.
+ */
+
+#ifndef CURVE_INTERSECTION_H
+#define CURVE_INTERSECTION_H
+
+#include <vector>
+
+class CatmullRomSpline;
+
+// Segment segA of spline curveA at parameter tA meets segment segB of spline
+//    curveB at parameter tB, at the point (x,y).
+struct CurveIntersection {
+	int curveA, segA;
+	float tA;
+	int curveB, segB;
+	float tB;
+	float x, y;
+};
+
+// The points where the Bezier curves with control points cpA and cpB cross.
+//    Stores at most maxHits pairs of parameters, in order of tA, and returns
+//    the number stored.
+int IntersectBeziers( const float cpA[8], const float cpB[8], float* tA, float* tB, int maxHits );
+
+// Appends the points where spline a, numbered curveA, crosses spline b, numbered
+//    curveB, in order of segA.  The work is split among the threads of spline a
+//    (see CatmullRomSpline::SetThreadCount), and the results do not depend on
+//    the number of threads.
+void IntersectCurves( const CatmullRomSpline& a, int curveA, const CatmullRomSpline& b, int curveB,
+					  std::vector<CurveIntersection>& intersections );
+
+// Appends the points where spline a, numbered curveA, crosses itself, with segA < segB,
+//    or segA == segB and tA < tB for a loop in one segment.
+void IntersectCurves( const CatmullRomSpline& a, int curveA, std::vector<CurveIntersection>& intersections );
+
+// Appends all the points where the numCurves splines cross each other or themselves,
+//    with curveA <= curveB.  The splines are numbered by their places in curves[].
+void IntersectCurves( const CatmullRomSpline* const curves[], int numCurves,
+					  std::vector<CurveIntersection>& intersections );
+
+#endif	// CURVE_INTERSECTION_H
@@ -0,0 +1,420 @@
+/*
+ * CurveStroker.cpp
+ *
+ * Triangle strips of a given width along the curve of a CatmullRomSpline.
+ * See CurveStroker.h.
+ *
+ * Software is "as-is" and carries no warranty.  It may be used without
+ *   restriction, but if you modify it, please change the filenames to
+ *   prevent confusion between different versions.
+ */
+
+#include "CurveStroker.h"
+#include "ThreadPool.h"
+
+#include <assert.h>
+#include <float.h>
+#include <math.h>
+
+static const float Pi = 3.14159265358979f;
+
+// Vertices of a round cap, of a join with a fan of RoundSteps steps, and of a beveled join
+static const int CapVertices = 2 * (CurveStroker::RoundSteps / 2 + 1);
+static const int FanVertices = 4 + 2 * (CurveStroker::RoundSteps + 1);
+static const int BevelVertices = 4 + 2 * 2;
+
+// Room in each slot beyond two vertices per point: two fans and two caps
+static const int SlotReserve = 2 * FanVertices + 2 * CapVertices;
+
+// Points closer than this many pixels are the same point
+static const float MinPixels = 1.0e-4f;
+
+// Curves per chunk of work given to a thread
+static const int MinCurvesPerChunk = 256;
+
+namespace {
+
+// Writes one strip, as (x,y) pairs.  Offsets from a point are given in pixels.
+struct StripWriter {
+	float* out;
+	int count;
+	float unitsX, unitsY;			// Units per pixel
+
+	void vertex( float x, float y )
+	{
+		out[2 * count] = x;
+		out[2 * count + 1] = y;
+		count++;
+	}
+	void offset( const float p[2], float ox, float oy )
+	{
+		vertex(p[0] + ox * unitsX, p[1] + oy * unitsY);
+	}
+	// p + offset, on the left of the curve, and then p - offset, on its right
+	void pair( const float p[2], float ox, float oy )
+	{
+		offset(p, ox, oy);
+		offset(p, -ox, -oy);
+	}
+};
+
+}
+
+// Writes a join at p from direction (u0x, u0y) to (u1x, u1y), unit vectors in
+//    pixels, with room for at most room vertices.  The join ends with the pair
+//    of vertices across the new direction if closing, or if it has a fan.
+static void writeJoin( StripWriter& strip, const float p[2], float u0x, float u0y, float u1x, float u1y,
+					   float halfWidth, CurveStroker::JoinStyle join, float miterLimit, int room, bool closing )
+{
+	static const float CosRoundStep = cosf(Pi / CurveStroker::RoundSteps);
+	float n0x = -u0y, n0y = u0x;		// Normals, on the left
+	float n1x = -u1y, n1y = u1x;
+	float c = u0x * u1x + u0y * u1y;
+	float cross = u0x * u1y - u0y * u1x;
+
+	// The miter is (n0 + n1) / (1 + c) half widths long, 1/cos(turn/2) times the half width
+	float miter2 = (c > -1.0f) ? 2.0f / (1.0f + c) : FLT_MAX;
+	bool single = (join == CurveStroker::RoundJoin) ? c >= CosRoundStep : miter2 <= miterLimit * miterLimit;
+	int steps = 1;
+	if (!single && join == CurveStroker::RoundJoin) {
+		float turn = atan2f(fabsf(cross), c);
+		steps = Min(Max((int)ceilf(turn * (CurveStroker::RoundSteps / Pi)), 1), (int)CurveStroker::RoundSteps);
+	}
+	if (!single && 4 + 2 * (steps + 1) > room) {
+		steps = 1;
+		single = BevelVertices > room;
+	}
+
+	if (single) {
+		// One pair of vertices on the bisector, no further out than the miter limit
+		float scale = halfWidth * Min(sqrtf(miter2), miterLimit);
+		float mx = n0x + n1x, my = n0y + n1y;
+		float length = sqrtf(mx * mx + my * my);
+		if (length > 0.0f) {
+			strip.pair(p, mx * (scale / length), my * (scale / length));
+		}
+		else {
+			strip.pair(p, n0x * halfWidth, n0y * halfWidth);
+		}
+		if (closing) {
+			strip.pair(p, n1x * halfWidth, n1y * halfWidth);
+		}
+		return;
+	}
+
+	// A fan around p on the outer side of the turn, from across the old direction
+	//    to across the new one.  The inner side is covered by the two line segments.
+	bool outerLeft = (cross <= 0.0f);			// Turning right
+	float sign = outerLeft ? 1.0f : -1.0f;
+	float angle = atan2f(cross, c) / (float)steps;
+	float cosStep = cosf(angle), sinStep = sinf(angle);
+	float ox = sign * n0x * halfWidth, oy = sign * n0y * halfWidth;
+	strip.pair(p, n0x * halfWidth, n0y * halfWidth);
+	for (int j = 0; j <= steps; j++) {
+		if (j == steps) {
+			ox = sign * n1x * halfWidth;
+			oy = sign * n1y * halfWidth;
+		}
+		if (outerLeft) {
+			strip.offset(p, ox, oy);
+			strip.vertex(p[0], p[1]);
+		}
+		else {
+			strip.vertex(p[0], p[1]);
+			strip.offset(p, ox, oy);
+		}
+		float rotatedX = ox * cosStep - oy * sinStep;
+		oy = ox * sinStep + oy * cosStep;
+		ox = rotatedX;
+	}
+	strip.pair(p, n1x * halfWidth, n1y * halfWidth);
+}
+
+// Writes the cap at the start (direction -1) or the end (direction +1) of the
+//    curve at p, where the curve goes in the direction (ux, uy).
+static void writeCap( StripWriter& strip, const float p[2], float ux, float uy, float halfWidth,
+					  CurveStroker::CapStyle cap, float direction )
+{
+	float nx = -uy, ny = ux;
+	if (cap == CurveStroker::ButtCap) {
+		strip.pair(p, nx * halfWidth, ny * halfWidth);
+	}
+	else if (cap == CurveStroker::SquareCap) {
+		float q[2] = { p[0] + direction * ux * halfWidth * strip.unitsX, p[1] + direction * uy * halfWidth * strip.unitsY };
+		strip.pair(q, nx * halfWidth, ny * halfWidth);
+	}
+	else {
+		// Pairs of points across a half circle, from its tip to its sides, or back again
+		const int halfSteps = CurveStroker::RoundSteps / 2;
+		for (int k = 0; k <= halfSteps; k++) {
+			int j = (direction < 0.0f) ? k : halfSteps - k;
+			float a = j * (0.5f * Pi / halfSteps);
+			float along = direction * cosf(a) * halfWidth, across = sinf(a) * halfWidth;
+			strip.offset(p, along * ux + across * nx, along * uy + across * ny);
+			strip.offset(p, along * ux - across * nx, along * uy - across * ny);
+		}
+	}
+}
+
+CurveStroker::CurveStroker()
+	: widthPixels(1.0f), pixelsPerUnitX(1.0f), pixelsPerUnitY(1.0f),
+	  join(RoundJoin), cap(RoundCap), miterLimit(4.0f), stale(true),
+	  spline(nullptr), capacity(0), meshRes(0), hasCurve(false), head(0), numCurves(0),
+	  verticesPerSlot(0)
+{
+}
+
+void CurveStroker::SetWidth( float newWidthPixels, float newPixelsPerUnitX, float newPixelsPerUnitY )
+{
+	assert( newWidthPixels > 0.0f && newPixelsPerUnitX > 0.0f && newPixelsPerUnitY > 0.0f );
+	if (newWidthPixels != widthPixels || newPixelsPerUnitX != pixelsPerUnitX || newPixelsPerUnitY != pixelsPerUnitY) {
+		widthPixels = newWidthPixels;
+		pixelsPerUnitX = newPixelsPerUnitX;
+		pixelsPerUnitY = newPixelsPerUnitY;
+		stale = true;
+	}
+}
+
+void CurveStroker::SetJoin( JoinStyle newJoin )
+{
+	stale = stale || newJoin != join;
+	join = newJoin;
+}
+
+void CurveStroker::SetCap( CapStyle newCap )
+{
+	stale = stale || newCap != cap;
+	cap = newCap;
+}
+
+void CurveStroker::SetMiterLimit( float limit )
+{
+	assert( limit >= 1.0f );
+	stale = stale || limit != miterLimit;
+	miterLimit = limit;
+}
+
+void CurveStroker::Build( const CatmullRomSpline& theSpline )
+{
+	spline = &theSpline;
+	capacity = spline->Capacity();
+	meshRes = spline->MeshResolution();
+	hasCurve = spline->HasCurve();
+	head = spline->Head();
+	numCurves = Max(spline->NumDots() - 1, 0);
+	stale = false;
+
+	verticesPerSlot = 2 * (meshRes + 1) + SlotReserve;
+	vertices.resize(2 * verticesPerSlot * capacity);
+	stripFirst.resize(capacity);
+	stripCount.assign(capacity, 0);
+	for (int s = 0; s < capacity; s++) {
+		stripFirst[s] = verticesPerSlot * s;
+	}
+	strokeCurves(*spline, 0, numCurves);
+	MarkAllDirty();
+}
+
+void CurveStroker::Update( const CatmullRomSpline& theSpline )
+{
+	if (stale || &theSpline != spline || theSpline.Capacity() != capacity
+		|| theSpline.MeshResolution() != meshRes || theSpline.HasCurve() != hasCurve) {
+		Build(theSpline);
+		return;
+	}
+
+	// The slots that held curves and no longer do get empty strips.  Slot s held
+	//    curve j = s - oldHead and now holds curve s - head (mod capacity), which
+	//    is offset less.  Curves before offset were removed from the front, unless
+	//    the new curves wrap around to their slots, and curves after offset+newNumCurves
+	//    were removed from the back.
+	int newHead = spline->Head();
+	int newNumCurves = Max(spline->NumDots() - 1, 0);
+	if (capacity > 0) {
+		int offset = newHead - head;
+		if (offset < 0) {
+			offset += capacity;
+		}
+		clearStrips(head, Max(newNumCurves - capacity + offset, 0), Min(offset, numCurves));
+		clearStrips(head, offset + newNumCurves, numCurves);
+	}
+	head = newHead;
+	numCurves = newNumCurves;
+
+	// A curve's strip ends with the join to the next curve, so it changes with the
+	//    curve after it.  The caps are at the first and the last curves.
+	DirtyRange curves[2];
+	int numRanges = spline->DirtyCurves(curves);
+	for (int k = 0; k < numRanges; k++) {
+		strokeCurves(*spline, Max(curves[k].first - 1, 0), Min(curves[k].end, numCurves));
+	}
+	if (numCurves > 0) {
+		strokeCurves(*spline, 0, 1);
+		strokeCurves(*spline, numCurves - 1, numCurves);
+	}
+}
+
+// Empties the strips of curves firstCurve, ..., endCurve-1 as they were numbered
+//    when the first curve was in slot oldHead
+void CurveStroker::clearStrips( int oldHead, int firstCurve, int endCurve )
+{
+	for (int j = firstCurve; j < endCurve; j++) {
+		int s = oldHead + j;
+		stripCount[(s < capacity) ? s : s - capacity] = 0;
+	}
+}
+
+void CurveStroker::MarkAllDirty()
+{
+	dirtyEntries.clear();
+	if (VertexCapacity() > 0) {
+		DirtyRange all = { 0, VertexCapacity() };
+		dirtyEntries.push_back(all);
+	}
+}
+
+void CurveStroker::markCurvesDirty( int firstCurve, int endCurve )
+{
+	// The curves are in at most two ranges of slots
+	int first = slot(firstCurve);
+	int count = endCurve - firstCurve;
+	DirtyRange slots[2] = { { first, Min(first + count, capacity) }, { 0, first + count - capacity } };
+	for (int k = 0; k < 2; k++) {
+		if (slots[k].IsEmpty()) {
+			continue;
+		}
+		DirtyRange entries = { verticesPerSlot * slots[k].first, verticesPerSlot * slots[k].end };
+		if (!dirtyEntries.empty() && entries.first <= dirtyEntries.back().end && dirtyEntries.back().first <= entries.end) {
+			dirtyEntries.back().first = Min(dirtyEntries.back().first, entries.first);
+			dirtyEntries.back().end = Max(dirtyEntries.back().end, entries.end);
+		}
+		else {
+			dirtyEntries.push_back(entries);
+		}
+	}
+}
+
+void CurveStroker::strokeCurves( const CatmullRomSpline& theSpline, int firstCurve, int endCurve )
+{
+	if (firstCurve >= endCurve) {
+		return;
+	}
+	auto task = [this, &theSpline]( int first, int end ) {
+		std::vector<float> scratch(4 * (meshRes + 1));
+		for (int i = first; i < end; i++) {
+			strokeCurve(theSpline, i, scratch);
+		}
+	};
+	ThreadPool* threads = theSpline.Threads();
+	if (threads == nullptr || endCurve - firstCurve <= MinCurvesPerChunk) {
+		task(firstCurve, endCurve);
+	}
+	else {
+		threads->ParallelFor(firstCurve, endCurve, MinCurvesPerChunk, task);
+	}
+	markCurvesDirty(firstCurve, endCurve);
+}
+
+// The points of curve i, or of the line from dot i to dot i+1 in the Polyline mode
+static const float* curvePoints( const CatmullRomSpline& spline, bool hasCurve, int i, float line[4], int& numPoints )
+{
+	if (hasCurve) {
+		numPoints = spline.SegmentPointCount(i);
+		return spline.CurvePoints(i);
+	}
+	for (int k = 0; k < 2; k++) {
+		line[k] = spline.Dot(i)[k];
+		line[2 + k] = spline.Dot(i + 1)[k];
+	}
+	numPoints = 2;
+	return line;
+}
+
+void CurveStroker::strokeCurve( const CatmullRomSpline& theSpline, int i, std::vector<float>& scratch )
+{
+	int s = slot(i);
+	StripWriter strip = { &vertices[2 * verticesPerSlot * s], 0, 1.0f / pixelsPerUnitX, 1.0f / pixelsPerUnitY };
+	float halfWidth = 0.5f * widthPixels;
+
+	// The points of the curve, leaving out points that repeat the one before them
+	float line[4];
+	int n;
+	const float* points = curvePoints(theSpline, hasCurve, i, line, n);
+	assert( n <= meshRes + 1 );
+	float* xs = scratch.data();
+	float* ys = xs + n;
+	float* ux = ys + n;
+	float* uy = ux + n;
+	int m = 0;
+	for (int k = 0; k < n; k++) {
+		float x = points[2 * k], y = points[2 * k + 1];
+		if (m > 0 && fabsf(x - xs[m - 1]) * pixelsPerUnitX + fabsf(y - ys[m - 1]) * pixelsPerUnitY <= MinPixels) {
+			if (k == n - 1 && m > 1) {
+				xs[m - 1] = x;			// Keep the end of the curve, where the next curve starts
+				ys[m - 1] = y;
+			}
+			continue;
+		}
+		xs[m] = x;
+		ys[m] = y;
+		m++;
+	}
+	if (m < 2) {
+		stripCount[s] = 0;
+		return;
+	}
+
+	// The directions of the line segments, in pixels
+	for (int k = 0; k < m - 1; k++) {
+		float dx = (xs[k + 1] - xs[k]) * pixelsPerUnitX;
+		float dy = (ys[k + 1] - ys[k]) * pixelsPerUnitY;
+		float r = 1.0f / sqrtf(dx * dx + dy * dy);
+		ux[k] = dx * r;
+		uy[k] = dy * r;
+	}
+
+	// The direction at the start of the next curve
+	bool hasNext = false;
+	float nextX = 0.0f, nextY = 0.0f;
+	if (i + 1 < numCurves) {
+		float nextLine[4];
+		int nextCount;
+		const float* next = curvePoints(theSpline, hasCurve, i + 1, nextLine, nextCount);
+		for (int k = 1; k < nextCount && !hasNext; k++) {
+			float dx = (next[2 * k] - next[0]) * pixelsPerUnitX;
+			float dy = (next[2 * k + 1] - next[1]) * pixelsPerUnitY;
+			if (fabsf(dx) + fabsf(dy) > MinPixels) {
+				float r = 1.0f / sqrtf(dx * dx + dy * dy);
+				nextX = dx * r;
+				nextY = dy * r;
+				hasNext = true;
+			}
+		}
+	}
+
+	float p[2] = { xs[0], ys[0] };
+	if (i == 0) {
+		writeCap(strip, p, ux[0], uy[0], halfWidth, cap, -1.0f);
+	}
+	else {
+		strip.pair(p, -uy[0] * halfWidth, ux[0] * halfWidth);	// The join was drawn by the curve before
+	}
+	// Each join leaves room for two vertices at each later point, and for the end
+	const int endRoom = Max(FanVertices, CapVertices);
+	for (int k = 1; k < m - 1; k++) {
+		p[0] = xs[k];
+		p[1] = ys[k];
+		int room = verticesPerSlot - strip.count - 2 * (m - 2 - k) - endRoom;
+		writeJoin(strip, p, ux[k - 1], uy[k - 1], ux[k], uy[k], halfWidth, join, miterLimit, room, false);
+	}
+	p[0] = xs[m - 1];
+	p[1] = ys[m - 1];
+	if (hasNext) {
+		writeJoin(strip, p, ux[m - 2], uy[m - 2], nextX, nextY, halfWidth, join, miterLimit, endRoom, true);
+	}
+	else {
+		writeCap(strip, p, ux[m - 2], uy[m - 2], halfWidth, cap, 1.0f);
+	}
+	assert( strip.count <= verticesPerSlot );
+	stripCount[s] = strip.count;
+}
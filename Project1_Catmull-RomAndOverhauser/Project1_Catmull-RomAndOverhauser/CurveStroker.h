@@ -0,0 +1,118 @@
+/*
+ * CurveStroker.h
+ *
+ * Turns the points on the curve of a CatmullRomSpline into triangle strips
+ * a given number of pixels wide, with miter or round joins and butt, square
+ * or round caps, so that the curve can be drawn as filled triangles instead
+ * of wide lines.  Wide and smooth lines are optional in core profiles and
+ * differ from driver to driver; triangles have the same width everywhere.
+ *
+ * The strips are laid out like the spline's arrays: the strip of the curve
+ * in slot s starts at vertex s*VerticesPerSlot(), so StripFirsts() and
+ * StripCounts() draw all of the strips with one call to glMultiDrawArrays.
+ * Each strip ends with the join to the next curve, or with the end cap, and
+ * the next strip starts where that join ends.  A curve is stroked in two
+ * passes: a straight loop computes the direction of every line segment, in
+ * pixels, which the compiler can vectorize, and a second pass writes the
+ * vertices.  A join that turns by less than a step of a round join is a
+ * single mitered pair of vertices, so the smooth parts of the curve take two
+ * vertices per point.  Sharper joins add a fan around the point; each slot
+ * has room for two of them and the caps, and further sharp joins in the
+ * same curve are beveled.
+ *
+ * Update() strokes again only the curves the spline has changed, together
+ * with the curves before them, whose joins they end, and the first and the
+ * last curves, whose caps may have moved.  DirtyEntries() gives the ranges
+ * of vertices to load into a VBO.  In the Polyline mode the strips follow the
+ * straight lines between the dots.
+ *
+ * Software is "as-is" and carries no warranty.  It may be used without
+ *   restriction, but if you modify it, please change the filenames to
+ *   prevent confusion between different versions.
+ */
+
+#ifndef CURVE_STROKER_H
+#define CURVE_STROKER_H
+
+#include <vector>
+#include "CatmullRomSpline.h"
+
+class CurveStroker {
+
+public:
+	enum JoinStyle { MiterJoin, RoundJoin };
+	enum CapStyle { ButtCap, SquareCap, RoundCap };
+
+	typedef CatmullRomSpline::DirtyRange DirtyRange;
+
+	static const int RoundSteps = 8;		// Line segments per half turn of a round join or cap
+
+public:
+	CurveStroker();
+
+	// The strips are widthPixels wide, drawn in a view with pixelsPerUnitX pixels per unit
+	//    of x and pixelsPerUnitY per unit of y.  Changing the width or the styles strokes
+	//    all of the curves again at the next Update().
+	void SetWidth( float widthPixels, float pixelsPerUnitX, float pixelsPerUnitY );
+	void SetJoin( JoinStyle join );
+	void SetCap( CapStyle cap );
+	void SetMiterLimit( float limit );		// Longest miter, in stroke widths; longer miters are beveled
+	float Width() const { return widthPixels; }
+	JoinStyle Join() const { return join; }
+	CapStyle Cap() const { return cap; }
+	float MiterLimit() const { return miterLimit; }
+
+	// Strokes all of the curves, on the threads of the spline (see CatmullRomSpline::SetThreadCount)
+	void Build( const CatmullRomSpline& spline );
+
+	// Strokes again the curves the spline has changed since its last ClearDirty(), and so
+	//    must be called before that.  Strokes all of them if the spline has been resized.
+	void Update( const CatmullRomSpline& spline );
+
+	// One triangle strip for each slot of the spline: NumStrips() strips, of StripCounts()[s]
+	//    vertices from StripFirsts()[s].  A slot without a curve has a strip of 0 vertices.
+	int NumStrips() const { return (int)stripFirst.size(); }
+	const int* StripFirsts() const { return stripFirst.data(); }
+	const int* StripCounts() const { return stripCount.data(); }
+
+	// The vertices, as (x,y) pairs.  There are VertexCapacity() of them.
+	int VerticesPerSlot() const { return verticesPerSlot; }
+	int VertexCapacity() const { return verticesPerSlot * capacity; }
+	const float* Vertices() const { return vertices.data(); }
+
+	// The ranges of vertices changed since the last call to ClearDirty()
+	const std::vector<DirtyRange>& DirtyEntries() const { return dirtyEntries; }
+	void ClearDirty() { dirtyEntries.clear(); }
+	void MarkAllDirty();
+
+private:
+	int slot( int i ) const { int s = head + i; return (s < capacity) ? s : s - capacity; }
+	void strokeCurves( const CatmullRomSpline& spline, int firstCurve, int endCurve );
+	void strokeCurve( const CatmullRomSpline& spline, int i, std::vector<float>& scratch );
+	void clearStrips( int oldHead, int firstCurve, int endCurve );
+	void markCurvesDirty( int firstCurve, int endCurve );
+
+private:
+	float widthPixels;
+	float pixelsPerUnitX, pixelsPerUnitY;
+	JoinStyle join;
+	CapStyle cap;
+	float miterLimit;
+	bool stale;						// The settings have changed since the curves were stroked
+
+	// The layout of the spline when it was last stroked
+	const CatmullRomSpline* spline;
+	int capacity;
+	int meshRes;
+	bool hasCurve;
+	int head;
+	int numCurves;
+
+	int verticesPerSlot;
+	std::vector<float> vertices;
+	std::vector<int> stripFirst;
+	std::vector<int> stripCount;
+	std::vector<DirtyRange> dirtyEntries;
+};
+
+#endif	// CURVE_STROKER_H
@@ -0,0 +1,173 @@
+/*
+ * DotGrid.cpp
+ *
+ * Uniform grid over the dots of a CatmullRomSpline.
+ * See DotGrid.h.
+ *
+ * Software is "as-is" and carries no warranty.  It may be used without
+ *   restriction, but if you modify it, please change the filenames to
+ *   prevent confusion between different versions.
+ */
+
+#include "DotGrid.h"
+#include "CatmullRomSpline.h"
+
+#include <assert.h>
+#include <math.h>
+
+// Cell coordinates are clamped to this, so dots far outside the window share the outer cells
+static const int MaxCellCoordinate = 1 << 30;
+
+DotGrid::DotGrid( float theCellSize )
+	: cellSize(theCellSize), firstSerial(0)
+{
+	assert( cellSize > 0.0f );
+}
+
+int DotGrid::cellCoordinate( float x ) const
+{
+	float c = floorf(x / cellSize);
+	if (!(c > -(float)MaxCellCoordinate)) {
+		return -MaxCellCoordinate;				// Also for NaN
+	}
+	return (c < (float)MaxCellCoordinate) ? (int)c : MaxCellCoordinate;
+}
+
+DotGrid::CellKey DotGrid::cellKey( float x, float y ) const
+{
+	return cellKey(cellCoordinate(x), cellCoordinate(y));
+}
+
+void DotGrid::insert( CellKey key, const Entry& entry )
+{
+	cells[key].push_back(entry);
+}
+
+// Removes the dot with the given serial number from its cell, which
+//    holds few dots, by moving the last dot of the cell into its place.
+void DotGrid::remove( CellKey key, uint32_t serial )
+{
+	auto cell = cells.find(key);
+	assert( cell != cells.end() );
+	std::vector<Entry>& entries = cell->second;
+	for (size_t k = 0; k < entries.size(); k++) {
+		if (entries[k].serial == serial) {
+			entries[k] = entries.back();
+			entries.pop_back();
+			break;
+		}
+	}
+	if (entries.empty()) {
+		cells.erase(cell);
+	}
+}
+
+void DotGrid::SetCellSize( float newCellSize )
+{
+	assert( newCellSize > 0.0f );
+	if (newCellSize == cellSize) {
+		return;
+	}
+	cellSize = newCellSize;
+	std::unordered_map<CellKey, std::vector<Entry>> oldCells;
+	oldCells.swap(cells);
+	for (auto& cell : oldCells) {
+		for (const Entry& entry : cell.second) {
+			CellKey key = cellKey(entry.x, entry.y);
+			insert(key, entry);
+			dotCells[entry.serial - firstSerial] = key;
+		}
+	}
+}
+
+void DotGrid::Build( const CatmullRomSpline& spline )
+{
+	Clear();
+	for (int i = 0; i < spline.NumDots(); i++) {
+		AddDot(spline.Dot(i)[0], spline.Dot(i)[1]);
+	}
+}
+
+void DotGrid::Clear()
+{
+	cells.clear();
+	dotCells.clear();
+	firstSerial = 0;
+}
+
+void DotGrid::AddDot( float x, float y )
+{
+	Entry entry = { x, y, firstSerial + (uint32_t)dotCells.size() };
+	CellKey key = cellKey(x, y);
+	insert(key, entry);
+	dotCells.push_back(key);
+}
+
+void DotGrid::MoveDot( int i, float x, float y )
+{
+	assert( i >= 0 && i < NumDots() );
+	uint32_t serial = firstSerial + (uint32_t)i;
+	CellKey oldKey = dotCells[i];
+	CellKey newKey = cellKey(x, y);
+	if (newKey == oldKey) {
+		for (Entry& entry : cells[oldKey]) {
+			if (entry.serial == serial) {
+				entry.x = x;
+				entry.y = y;
+				break;
+			}
+		}
+		return;
+	}
+	remove(oldKey, serial);
+	Entry entry = { x, y, serial };
+	insert(newKey, entry);
+	dotCells[i] = newKey;
+}
+
+void DotGrid::RemoveFirstDot()
+{
+	if (dotCells.empty()) {
+		return;
+	}
+	remove(dotCells.front(), firstSerial);
+	dotCells.pop_front();
+	firstSerial++;
+}
+
+void DotGrid::RemoveLastDot()
+{
+	if (dotCells.empty()) {
+		return;
+	}
+	remove(dotCells.back(), firstSerial + (uint32_t)(dotCells.size() - 1));
+	dotCells.pop_back();
+}
+
+int DotGrid::Nearest( float x, float y, float radiusX, float radiusY ) const
+{
+	assert( radiusX > 0.0f && radiusY > 0.0f );
+	int cx0 = cellCoordinate(x - radiusX), cx1 = cellCoordinate(x + radiusX);
+	int cy0 = cellCoordinate(y - radiusY), cy1 = cellCoordinate(y + radiusY);
+	float minDist2 = 1.0f;
+	int nearest = -1;
+	for (int cx = cx0; cx <= cx1; cx++) {
+		for (int cy = cy0; cy <= cy1; cy++) {
+			auto cell = cells.find(cellKey(cx, cy));
+			if (cell == cells.end()) {
+				continue;
+			}
+			for (const Entry& entry : cell->second) {
+				float dx = (entry.x - x) / radiusX;
+				float dy = (entry.y - y) / radiusY;
+				float dist2 = dx * dx + dy * dy;
+				int i = (int)(entry.serial - firstSerial);
+				if (dist2 < minDist2 || (dist2 == minDist2 && (nearest < 0 || i < nearest))) {
+					minDist2 = dist2;
+					nearest = i;
+				}
+			}
+		}
+	}
+	return nearest;
+}
@@ -0,0 +1,81 @@
+/*
+ * DotGrid.h
+ *
+ * Uniform grid over the dots of a CatmullRomSpline, for picking the dot
+ * nearest the mouse.
+ *
+ * The plane is divided into square cells of CellSize() units, and each cell
+ * that holds dots keeps their positions in a hash table, so the grid covers
+ * dots anywhere in the plane.  A query looks only at the cells within its
+ * radius: with cells about as large as the radius, that is 3x3 cells, and
+ * the time does not depend on the number of dots, only on how many dots
+ * are near the point.
+ *
+ * The grid is kept in step with the spline by the same edits: AddDot,
+ * MoveDot, RemoveFirstDot and RemoveLastDot take O(1) time.  Each dot is
+ * stored with a serial number, and dot i is the dot with serial number
+ * firstSerial+i, so removing the first dot does not renumber the others.
+ * Build() copies all the dots of a spline, after edits that change many
+ * dots at once (Load, SetMaxDots, ...).
+ *
+ * Software is "as-is" and carries no warranty.  It may be used without
+ *   restriction, but if you modify it, please change the filenames to
+ *   prevent confusion between different versions.
+ */
+
+#ifndef DOT_GRID_H
+#define DOT_GRID_H
+
+#include <stdint.h>
+#include <deque>
+#include <unordered_map>
+#include <vector>
+
+class CatmullRomSpline;
+
+class DotGrid {
+
+public:
+	explicit DotGrid( float cellSize = 1.0f / 64.0f );
+
+	// Changing the size of the cells moves all the dots into new cells
+	void SetCellSize( float cellSize );
+	float CellSize() const { return cellSize; }
+
+	void Build( const CatmullRomSpline& spline );
+	void Clear();
+
+	int NumDots() const { return (int)dotCells.size(); }
+
+	void AddDot( float x, float y );			// Becomes dot NumDots()
+	void MoveDot( int i, float x, float y );
+	void RemoveFirstDot();						// The other dots are renumbered from 0
+	void RemoveLastDot();
+
+	// The dot nearest (x,y) with (dx/radiusX)^2 + (dy/radiusY)^2 <= 1, or -1 if
+	//    there is none.  Distances are measured in units of the radii, so that
+	//    radii of n pixels in x and in y find the nearest dot in pixels.
+	//    Of dots at the same distance, the one with the lowest index is returned.
+	int Nearest( float x, float y, float radiusX, float radiusY ) const;
+
+private:
+	struct Entry {
+		float x, y;
+		uint32_t serial;
+	};
+	typedef int64_t CellKey;
+
+	int cellCoordinate( float x ) const;
+	CellKey cellKey( float x, float y ) const;
+	static CellKey cellKey( int cx, int cy ) { return (CellKey)(((uint64_t)(uint32_t)cx << 32) | (uint32_t)cy); }
+	void insert( CellKey key, const Entry& entry );
+	void remove( CellKey key, uint32_t serial );
+
+private:
+	float cellSize;
+	std::unordered_map<CellKey, std::vector<Entry>> cells;	// Only the cells that hold dots
+	std::deque<CellKey> dotCells;		// The cell of dot i
+	uint32_t firstSerial;				// Serial number of dot 0; serial numbers wrap around
+};
+
+#endif	// DOT_GRID_H
@@ -0,0 +1,104 @@
+/*
+ * FrameTimer.cpp
+ *
+ * Measures the CPU time and the GL time of each frame.
+ * See FrameTimer.h.
+ *
+ * Software is "as-is" and carries no warranty.  It may be used without
+ *   restriction, but if you modify it, please change the filenames to
+ *   prevent confusion between different versions.
+ */
+
+// Use the static library (so glew32.dll is not needed):
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+#include <algorithm>
+#include <chrono>
+
+#include "FrameTimer.h"
+
+FrameTimer::FrameTimer()
+	: hasQuery(false), query(0), frameStart(0.0)
+{
+}
+
+FrameTimer::~FrameTimer()
+{
+	Release();
+}
+
+void FrameTimer::Start()
+{
+	Release();
+	hasQuery = GLEW_VERSION_3_3 || GLEW_ARB_timer_query;
+	if (hasQuery) {
+		glGenQueries(1, &query);
+	}
+	timings.clear();
+}
+
+void FrameTimer::Release()
+{
+	if (hasQuery) {
+		glDeleteQueries(1, &query);
+		hasQuery = false;
+	}
+}
+
+void FrameTimer::BeginFrame()
+{
+	if (hasQuery) {
+		glBeginQuery(GL_TIME_ELAPSED, query);
+	}
+	frameStart = Seconds();
+}
+
+void FrameTimer::EndFrame()
+{
+	double issued = Seconds();
+	if (hasQuery) {
+		glEndQuery(GL_TIME_ELAPSED);
+	}
+	glFinish();
+	double finished = Seconds();
+	Timing timing = { 1000.0 * (issued - frameStart), 1000.0 * (finished - issued), -1.0 };
+	if (hasQuery) {
+		GLuint64 nanoseconds = 0;
+		glGetQueryObjectui64v(query, GL_QUERY_RESULT, &nanoseconds);
+		double milliseconds = 1.0e-6 * (double)nanoseconds;
+		if (milliseconds <= 1000.0 * (finished - frameStart)) {
+			timing.gpuMilliseconds = milliseconds;
+		}
+	}
+	timings.push_back(timing);
+}
+
+FrameTimer::Summary FrameTimer::Summarize( Measure measure ) const
+{
+	std::vector<double> times;
+	for (const Timing& timing : timings) {
+		double time = (measure == Cpu) ? timing.cpuMilliseconds
+					: (measure == Finish) ? timing.finishMilliseconds : timing.gpuMilliseconds;
+		if (time >= 0.0) {
+			times.push_back(time);
+		}
+	}
+	Summary summary = { 0.0, 0.0, 0.0 };
+	if (times.empty()) {
+		return summary;
+	}
+	for (double time : times) {
+		summary.mean += time;
+		summary.largest = std::max(summary.largest, time);
+	}
+	summary.mean /= (double)times.size();
+	std::nth_element(times.begin(), times.begin() + times.size() / 2, times.end());
+	summary.median = times[times.size() / 2];
+	return summary;
+}
+
+double FrameTimer::Seconds()
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
@@ -0,0 +1,69 @@
+/*
+ * FrameTimer.h
+ *
+ * Measures the time of each frame three ways: the CPU time from BeginFrame()
+ * to EndFrame(), which is the time to update the buffers and to issue the
+ * GL calls; the time glFinish() then waits for the GL to finish drawing;
+ * and the GPU time of the GL commands of the frame, from a GL_TIME_ELAPSED
+ * query.
+ *
+ * Each frame is finished before the next one begins, so that the times of a
+ * frame are its own.  That is slower than a window's frame loop, where the
+ * CPU goes on to the next frame while the GPU draws, but it is what timing
+ * needs.  A software rasterizer such as Mesa's llvmpipe draws when the
+ * commands are flushed, outside the query, so there the finish time is the
+ * drawing time and the query times mean little.  A query time longer than
+ * the whole frame is discarded.  Timer queries need OpenGL 3.3 or
+ * ARB_timer_query; without them the GPU times are negative.
+ *
+ * Software is "as-is" and carries no warranty.  It may be used without
+ *   restriction, but if you modify it, please change the filenames to
+ *   prevent confusion between different versions.
+ */
+
+#ifndef FRAME_TIMER_H
+#define FRAME_TIMER_H
+
+#include <vector>
+
+class FrameTimer {
+
+public:
+	struct Timing {
+		double cpuMilliseconds;
+		double finishMilliseconds;	// The wait in glFinish()
+		double gpuMilliseconds;		// Negative if unknown
+	};
+
+	// The mean, the median and the largest of the times of the frames
+	struct Summary {
+		double mean, median, largest;
+	};
+
+	enum Measure { Cpu, Finish, Gpu };
+
+public:
+	FrameTimer();
+	~FrameTimer();
+
+	// Makes the query.  Needs a current context.
+	void Start();
+	void Release();
+
+	void BeginFrame();
+	void EndFrame();				// Waits for the GL to finish the frame
+
+	const std::vector<Timing>& Timings() const { return timings; }
+	Summary Summarize( Measure measure ) const;
+
+	// A clock for measuring CPU times, in seconds
+	static double Seconds();
+
+private:
+	bool hasQuery;
+	unsigned int query;
+	double frameStart;
+	std::vector<Timing> timings;
+};
+
+#endif	// FRAME_TIMER_H
@@ -0,0 +1,95 @@
+/*
+ * GlStateCache.cpp
+ *
+ * Makes OpenGL calls, skipping those that do not change the state.
+ * See GlStateCache.h.
+ *
+ * Software is "as-is" and carries no warranty.  It may be used without
+ *   restriction, but if you modify it, please change the filenames to
+ *   prevent confusion between different versions.
+ */
+
+// Use the static library (so glew32.dll is not needed):
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+#include "GlStateCache.h"
+
+static_assert(sizeof(GLint) == sizeof(int) && sizeof(GLsizei) == sizeof(int), "GLint and GLsizei must be int");
+
+static const unsigned int Unknown = ~0u;
+
+void GlStateCache::Invalidate()
+{
+	program = Unknown;
+	vao = Unknown;
+	colorLocation = Unknown;
+	color[0] = color[1] = color[2] = -1.0f;
+	pointSize = -1.0f;
+}
+
+void GlStateCache::UseProgram( unsigned int newProgram )
+{
+	if (newProgram == program) {
+		counts.skipped++;
+		return;
+	}
+	glUseProgram(newProgram);
+	program = newProgram;
+	counts.calls++;
+}
+
+void GlStateCache::BindVertexArray( unsigned int newVao )
+{
+	if (newVao == vao) {
+		counts.skipped++;
+		return;
+	}
+	glBindVertexArray(newVao);
+	vao = newVao;
+	counts.calls++;
+}
+
+void GlStateCache::Color( unsigned int location, float red, float green, float blue )
+{
+	if (location == colorLocation && red == color[0] && green == color[1] && blue == color[2]) {
+		counts.skipped++;
+		return;
+	}
+	glVertexAttrib3f(location, red, green, blue);
+	colorLocation = location;
+	color[0] = red;
+	color[1] = green;
+	color[2] = blue;
+	counts.calls++;
+}
+
+void GlStateCache::PointSize( float size )
+{
+	if (size == pointSize) {
+		counts.skipped++;
+		return;
+	}
+	glPointSize(size);
+	pointSize = size;
+	counts.calls++;
+}
+
+void GlStateCache::DrawArrays( unsigned int mode, int first, int count )
+{
+	glDrawArrays(mode, first, count);
+	counts.calls++;
+}
+
+void GlStateCache::MultiDrawArrays( unsigned int mode, const int* firsts, const int* drawCounts, int drawCount )
+{
+	glMultiDrawArrays(mode, firsts, drawCounts, drawCount);
+	counts.calls++;
+}
+
+GlStateCache::Counts GlStateCache::EndFrame()
+{
+	Counts frame = counts;
+	counts.calls = counts.skipped = 0;
+	return frame;
+}
@@ -0,0 +1,55 @@
+/*
+ * GlStateCache.h
+ *
+ * Makes the OpenGL calls that draw, and the calls that set the state the
+ * draws use, skipping calls that set state to what it already is: the
+ * program, the vertex array, the generic color attribute and the point
+ * size.  It counts the calls it makes and the calls it skips, for a report
+ * of the GL calls per frame.
+ *
+ * The cache assumes that nothing else changes this state.  Call Invalidate()
+ * after code that does, or after a new context is made current.
+ *
+ * Software is "as-is" and carries no warranty.  It may be used without
+ *   restriction, but if you modify it, please change the filenames to
+ *   prevent confusion between different versions.
+ */
+
+#ifndef GL_STATE_CACHE_H
+#define GL_STATE_CACHE_H
+
+class GlStateCache {
+
+public:
+	struct Counts {
+		int calls;				// GL calls made
+		int skipped;			// Calls that would have set state to what it already was
+	};
+
+public:
+	GlStateCache() { Invalidate(); counts.calls = counts.skipped = 0; }
+
+	void Invalidate();
+
+	void UseProgram( unsigned int program );
+	void BindVertexArray( unsigned int vao );
+	void Color( unsigned int location, float red, float green, float blue );	// glVertexAttrib3f
+	void PointSize( float size );
+
+	void DrawArrays( unsigned int mode, int first, int count );
+	void MultiDrawArrays( unsigned int mode, const int* firsts, const int* drawCounts, int drawCount );
+
+	// The counts since the last call
+	Counts EndFrame();
+
+private:
+	// The state as last set.  Invalidate() sets values that no call sets.
+	unsigned int program;
+	unsigned int vao;
+	unsigned int colorLocation;
+	float color[3];
+	float pointSize;
+	Counts counts;
+};
+
+#endif	// GL_STATE_CACHE_H
@@ -0,0 +1,293 @@
+/*
+ * HeadlessContext.cpp
+ *
+ * An OpenGL context without a window, rendering into a framebuffer object.
+ * See HeadlessContext.h.
+ *
+ * Software is "as-is" and carries no warranty.  It may be used without
+ *   restriction, but if you modify it, please change the filenames to
+ *   prevent confusion between different versions.
+ */
+
+#define _CRT_SECURE_NO_WARNINGS				// For fopen
+
+// Use the static library (so glew32.dll is not needed):
+#define GLEW_STATIC
+#include <GL/glew.h>
+#ifdef _WIN32
+#include <GLFW/glfw3.h>
+#else
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+#include "HeadlessContext.h"
+
+bool check_for_opengl_errors();
+
+HeadlessContext::HeadlessContext()
+	: width(0), height(0), framebuffer(0)
+#ifdef _WIN32
+	, window(nullptr)
+#else
+	, display(nullptr), context(nullptr)
+#endif
+{
+	renderbuffers[0] = renderbuffers[1] = 0;
+}
+
+HeadlessContext::~HeadlessContext()
+{
+	Destroy();
+}
+
+bool HeadlessContext::Create( int newWidth, int newHeight )
+{
+	Destroy();
+	if (newWidth <= 0 || newHeight <= 0 || !makeCurrent()) {
+		release();
+		return false;
+	}
+
+	// A GLEW built for GLX or WGL may report that it found no display after it has
+	//    loaded the functions, so what matters is whether framebuffers are there.
+	glewExperimental = GL_TRUE;
+	glewInit();
+	if (!(GLEW_VERSION_3_0 || GLEW_ARB_framebuffer_object)) {
+		fprintf(stderr, "The OpenGL context has no framebuffer objects.\n");
+		release();
+		return false;
+	}
+	width = newWidth;
+	height = newHeight;
+
+	glGenRenderbuffers(2, renderbuffers);
+	glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[0]);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[1]);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+	glGenFramebuffers(1, &framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffers[0]);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, renderbuffers[1]);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+		fprintf(stderr, "The framebuffer is not complete.\n");
+		Destroy();
+		return false;
+	}
+	glDrawBuffer(GL_COLOR_ATTACHMENT0);
+	glReadBuffer(GL_COLOR_ATTACHMENT0);
+	glViewport(0, 0, width, height);
+	check_for_opengl_errors();
+	return true;
+}
+
+void HeadlessContext::Destroy()
+{
+	if (framebuffer != 0) {
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		glDeleteFramebuffers(1, &framebuffer);
+		glDeleteRenderbuffers(2, renderbuffers);
+		framebuffer = 0;
+		renderbuffers[0] = renderbuffers[1] = 0;
+	}
+	width = height = 0;
+	release();
+}
+
+#ifdef _WIN32
+
+bool HeadlessContext::makeCurrent()
+{
+	if (!glfwInit()) {
+		return false;
+	}
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	GLFWwindow* hidden = glfwCreateWindow(1, 1, "ConnectDotsModern", NULL, NULL);
+	if (hidden == NULL) {
+		fprintf(stderr, "Could not make a hidden GLFW window.\n");
+		return false;
+	}
+	window = hidden;
+	glfwMakeContextCurrent(hidden);
+	return true;
+}
+
+void HeadlessContext::release()
+{
+	if (window != nullptr) {
+		glfwDestroyWindow((GLFWwindow*)window);
+		glfwTerminate();
+		window = nullptr;
+	}
+}
+
+#else
+
+// True if the space-separated list of EGL extensions has the extension
+static bool hasExtension( const char* extensions, const char* extension )
+{
+	size_t length = strlen(extension);
+	for (const char* s = extensions; s != nullptr && (s = strstr(s, extension)) != nullptr; s += length) {
+		if ((s == extensions || s[-1] == ' ') && (s[length] == ' ' || s[length] == '\0')) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool HeadlessContext::makeCurrent()
+{
+	// The surfaceless platform needs no display server.  Without it, a driver with
+	//    EGL_KHR_surfaceless_context may still make a context on the default display.
+	EGLDisplay eglDisplay = EGL_NO_DISPLAY;
+	const char* clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+	if (hasExtension(clientExtensions, "EGL_MESA_platform_surfaceless")) {
+		PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+			(PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+		if (getPlatformDisplay != nullptr) {
+			eglDisplay = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+		}
+	}
+	if (eglDisplay == EGL_NO_DISPLAY) {
+		eglDisplay = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	}
+	EGLint major, minor;
+	if (eglDisplay == EGL_NO_DISPLAY || !eglInitialize(eglDisplay, &major, &minor)) {
+		fprintf(stderr, "Could not open an EGL display.\n");
+		return false;
+	}
+	display = eglDisplay;
+	const char* extensions = eglQueryString(eglDisplay, EGL_EXTENSIONS);
+	if (!hasExtension(extensions, "EGL_KHR_surfaceless_context") || !eglBindAPI(EGL_OPENGL_API)) {
+		fprintf(stderr, "EGL cannot make an OpenGL context without a surface.\n");
+		return false;
+	}
+
+	// The demo draws with a compatibility profile, like the context of a GLFW window
+	EGLConfig config = (EGLConfig)0;		// EGL_NO_CONFIG_KHR
+	if (!hasExtension(extensions, "EGL_KHR_no_config_context")) {
+		const EGLint configAttributes[] = { EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+		EGLint numConfigs = 0;
+		if (!eglChooseConfig(eglDisplay, configAttributes, &config, 1, &numConfigs) || numConfigs == 0) {
+			fprintf(stderr, "EGL has no configuration for OpenGL.\n");
+			return false;
+		}
+	}
+	const EGLint contextAttributes[] = {
+		EGL_CONTEXT_OPENGL_PROFILE_MASK_KHR, EGL_CONTEXT_OPENGL_COMPATIBILITY_PROFILE_BIT_KHR, EGL_NONE };
+	EGLContext eglContext = eglCreateContext(eglDisplay, config, EGL_NO_CONTEXT, contextAttributes);
+	if (eglContext == EGL_NO_CONTEXT) {
+		fprintf(stderr, "Could not make an EGL context.\n");
+		return false;
+	}
+	context = eglContext;
+	return eglMakeCurrent(eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, eglContext) == EGL_TRUE;
+}
+
+void HeadlessContext::release()
+{
+	if (context != nullptr) {
+		eglMakeCurrent((EGLDisplay)display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+		eglDestroyContext((EGLDisplay)display, (EGLContext)context);
+		context = nullptr;
+	}
+	if (display != nullptr) {
+		eglTerminate((EGLDisplay)display);
+		display = nullptr;
+	}
+}
+
+#endif
+
+void HeadlessContext::ReadPixels( std::vector<unsigned char>& rgb ) const
+{
+	// OpenGL gives the bottom row first
+	std::vector<unsigned char> rgba((size_t)4 * width * height);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, rgba.data());
+	rgb.resize((size_t)3 * width * height);
+	for (int y = 0; y < height; y++) {
+		const unsigned char* from = &rgba[(size_t)4 * width * (height - 1 - y)];
+		unsigned char* to = &rgb[(size_t)3 * width * y];
+		for (int x = 0; x < width; x++) {
+			to[3 * x] = from[4 * x];
+			to[3 * x + 1] = from[4 * x + 1];
+			to[3 * x + 2] = from[4 * x + 2];
+		}
+	}
+	check_for_opengl_errors();
+}
+
+bool HeadlessContext::SaveImage( const char* filename ) const
+{
+	std::vector<unsigned char> rgb;
+	ReadPixels(rgb);
+	FILE* file = fopen(filename, "wb");
+	if (file == nullptr) {
+		return false;
+	}
+	fprintf(file, "P6\n%d %d\n255\n", width, height);
+	bool written = (fwrite(rgb.data(), 1, rgb.size(), file) == rgb.size());
+	return (fclose(file) == 0) && written;
+}
+
+// Reads the next number of the header of a PPM file, skipping comments
+static bool readPpmNumber( FILE* file, int* number )
+{
+	int c;
+	while ((c = fgetc(file)) == '#' || c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+		if (c == '#') {
+			while ((c = fgetc(file)) != '\n' && c != EOF) {
+			}
+		}
+	}
+	if (c < '0' || c > '9') {
+		return false;
+	}
+	*number = 0;
+	for (; c >= '0' && c <= '9'; c = fgetc(file)) {
+		*number = 10 * *number + (c - '0');
+	}
+	return true;				// The one whitespace character after the number has been read
+}
+
+bool HeadlessContext::CompareImage( const char* filename, int tolerance, Difference* difference ) const
+{
+	FILE* file = fopen(filename, "rb");
+	if (file == nullptr) {
+		return false;
+	}
+	int fileWidth, fileHeight, maxValue;
+	bool valid = (fgetc(file) == 'P' && fgetc(file) == '6' && readPpmNumber(file, &fileWidth)
+				  && readPpmNumber(file, &fileHeight) && readPpmNumber(file, &maxValue)
+				  && fileWidth == width && fileHeight == height && maxValue == 255);
+	std::vector<unsigned char> golden((size_t)3 * width * height);
+	valid = valid && (fread(golden.data(), 1, golden.size(), file) == golden.size());
+	fclose(file);
+	if (!valid) {
+		return false;
+	}
+
+	std::vector<unsigned char> rgb;
+	ReadPixels(rgb);
+	difference->pixels = 0;
+	difference->largest = 0;
+	for (size_t i = 0; i < rgb.size(); i += 3) {
+		int pixel = 0;
+		for (int k = 0; k < 3; k++) {
+			pixel = std::max(pixel, abs((int)rgb[i + k] - (int)golden[i + k]));
+		}
+		difference->largest = std::max(difference->largest, pixel);
+		if (pixel > tolerance) {
+			difference->pixels++;
+		}
+	}
+	return true;
+}
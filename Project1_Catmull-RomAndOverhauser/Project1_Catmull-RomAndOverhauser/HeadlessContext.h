@@ -0,0 +1,78 @@
+/*
+ * HeadlessContext.h
+ *
+ * An OpenGL context without a window, which renders into a framebuffer
+ * object, so that the demo can replay a scene and be timed on machines
+ * with no display and no GPU.
+ *
+ * On Linux the context comes from EGL on Mesa's surfaceless platform
+ * (EGL_MESA_platform_surfaceless), which needs no display server and runs
+ * on the llvmpipe software rasterizer when there is no GPU; link with -lEGL.
+ * Windows has no EGL, so there the context belongs to a hidden GLFW window;
+ * with Mesa's opengl32.dll beside the program it is llvmpipe too.
+ *
+ * The framebuffer has an RGBA color buffer and a depth buffer of the given
+ * size, and stays bound, so the default framebuffer is never drawn into.
+ * SaveImage() and CompareImage() read it back into binary PPM files, for
+ * comparison with golden images.
+ *
+ * Software is "as-is" and carries no warranty.  It may be used without
+ *   restriction, but if you modify it, please change the filenames to
+ *   prevent confusion between different versions.
+ */
+
+#ifndef HEADLESS_CONTEXT_H
+#define HEADLESS_CONTEXT_H
+
+#include <vector>
+
+class HeadlessContext {
+
+public:
+	// How a rendered image differs from a golden image
+	struct Difference {
+		int pixels;				// Pixels with a channel differing by more than the tolerance
+		int largest;			// The largest difference in a channel
+	};
+
+public:
+	HeadlessContext();
+	~HeadlessContext();
+
+	// Makes the context current, loads the OpenGL functions with GLEW and binds a
+	//    framebuffer of width by height pixels.  Returns false on failure.
+	bool Create( int width, int height );
+	void Destroy();
+	int Width() const { return width; }
+	int Height() const { return height; }
+
+	// Reads the framebuffer as rows of RGB bytes, top row first, as in a PPM file
+	void ReadPixels( std::vector<unsigned char>& rgb ) const;
+
+	// Writes the framebuffer to a binary PPM file.  Returns false on failure.
+	bool SaveImage( const char* filename ) const;
+
+	// Compares the framebuffer with a PPM file of the same size.  Returns false if the
+	//    file cannot be read or has another size.
+	bool CompareImage( const char* filename, int tolerance, Difference* difference ) const;
+
+private:
+	HeadlessContext( const HeadlessContext& ) = delete;
+	HeadlessContext& operator=( const HeadlessContext& ) = delete;
+
+	bool makeCurrent();
+	void release();
+
+private:
+	int width, height;
+	unsigned int framebuffer;
+	unsigned int renderbuffers[2];	// Color and depth
+#ifdef _WIN32
+	void* window;					// The hidden GLFWwindow
+#else
+	void* display;					// EGLDisplay
+	void* context;					// EGLContext
+#endif
+};
+
+#endif	// HEADLESS_CONTEXT_H
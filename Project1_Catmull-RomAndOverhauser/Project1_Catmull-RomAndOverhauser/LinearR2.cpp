@@ -25,11 +25,19 @@
 
 #include <assert.h>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LINEAR_R2_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#define LINEAR_R2_NEON
+#include <arm_neon.h>
+#endif
+
 // ******************************************************
 // * VectorR2 class - math library functions			*
 // * * * * * * * * * * * * * * * * * * * * * * * * * * **
 
-const VectorR2 VectorR2::Zero;
+// VectorR2T<T>::Zero is defined in LinearR2.h
 // Deprecated due to unsafeness of global initialization
 //const VectorR2 VectorR2::UnitX( 1.0, 0.0);
 //const VectorR2 VectorR2::UnitY( 0.0, 1.0);
@@ -43,26 +51,99 @@ const VectorR2 VectorR2::Zero;
 // * Matrix2x2 class - math library functions			*
 // * * * * * * * * * * * * * * * * * * * * * * * * * * **
 
+// The batch transforms over float handle 4 points per iteration, then the
+//    remaining points one at a time.  With separate arrays, a vector holds 4 x's
+//    or 4 y's.  With (x,y) pairs, a vector holds 2 points (x0,y0,x1,y1): it is
+//    multiplied by (m11,m22,m11,m22), and the same vector with x and y
+//    swapped by (m12,m21,m12,m21).
+
+template<> void Matrix2x2T<float>::TransformArrays( int n, const float* srcX, const float* srcY,
+													 float* destX, float* destY ) const
+{
+	int i = 0;
+#if defined(LINEAR_R2_SSE2)
+	__m128 a11 = _mm_set1_ps(m11), a12 = _mm_set1_ps(m12);
+	__m128 a21 = _mm_set1_ps(m21), a22 = _mm_set1_ps(m22);
+	for ( ; i+4<=n; i+=4 ) {
+		__m128 x = _mm_loadu_ps(srcX+i);
+		__m128 y = _mm_loadu_ps(srcY+i);
+		_mm_storeu_ps(destX+i, _mm_add_ps(_mm_mul_ps(a11, x), _mm_mul_ps(a12, y)));
+		_mm_storeu_ps(destY+i, _mm_add_ps(_mm_mul_ps(a21, x), _mm_mul_ps(a22, y)));
+	}
+#elif defined(LINEAR_R2_NEON)
+	float32x4_t a11 = vdupq_n_f32(m11), a12 = vdupq_n_f32(m12);
+	float32x4_t a21 = vdupq_n_f32(m21), a22 = vdupq_n_f32(m22);
+	for ( ; i+4<=n; i+=4 ) {
+		float32x4_t x = vld1q_f32(srcX+i);
+		float32x4_t y = vld1q_f32(srcY+i);
+		vst1q_f32(destX+i, vmlaq_f32(vmulq_f32(a11, x), a12, y));
+		vst1q_f32(destY+i, vmlaq_f32(vmulq_f32(a21, x), a22, y));
+	}
+#endif
+	const float b11 = m11, b12 = m12, b21 = m21, b22 = m22;
+	for ( ; i<n; i++ ) {
+		float x = srcX[i];
+		float y = srcY[i];
+		destX[i] = b11*x + b12*y;
+		destY[i] = b21*x + b22*y;
+	}
+}
+
+template<> void Matrix2x2T<float>::TransformPairs( int n, const float* src, float* dest ) const
+{
+	int i = 0;
+#if defined(LINEAR_R2_SSE2)
+	__m128 diag = _mm_setr_ps(m11, m22, m11, m22);
+	__m128 offDiag = _mm_setr_ps(m12, m21, m12, m21);
+	for ( ; i+4<=n; i+=4 ) {
+		__m128 p = _mm_loadu_ps(src+2*i);
+		__m128 q = _mm_loadu_ps(src+2*i+4);
+		__m128 pSwap = _mm_shuffle_ps(p, p, _MM_SHUFFLE(2,3,0,1));
+		__m128 qSwap = _mm_shuffle_ps(q, q, _MM_SHUFFLE(2,3,0,1));
+		_mm_storeu_ps(dest+2*i, _mm_add_ps(_mm_mul_ps(diag, p), _mm_mul_ps(offDiag, pSwap)));
+		_mm_storeu_ps(dest+2*i+4, _mm_add_ps(_mm_mul_ps(diag, q), _mm_mul_ps(offDiag, qSwap)));
+	}
+#elif defined(LINEAR_R2_NEON)
+	const float diagEntries[4] = { m11, m22, m11, m22 };
+	const float offDiagEntries[4] = { m12, m21, m12, m21 };
+	float32x4_t diag = vld1q_f32(diagEntries);
+	float32x4_t offDiag = vld1q_f32(offDiagEntries);
+	for ( ; i+4<=n; i+=4 ) {
+		float32x4_t p = vld1q_f32(src+2*i);
+		float32x4_t q = vld1q_f32(src+2*i+4);
+		vst1q_f32(dest+2*i, vmlaq_f32(vmulq_f32(diag, p), offDiag, vrev64q_f32(p)));
+		vst1q_f32(dest+2*i+4, vmlaq_f32(vmulq_f32(diag, q), offDiag, vrev64q_f32(q)));
+	}
+#endif
+	const float b11 = m11, b12 = m12, b21 = m21, b22 = m22;
+	for ( ; i<n; i++ ) {
+		float x = src[2*i];
+		float y = src[2*i+1];
+		dest[2*i] = b11*x + b12*y;
+		dest[2*i+1] = b21*x + b22*y;
+	}
+}
+
 
 // ******************************************************
 // * LinearMapR2 class - math library functions			*
 // * * * * * * * * * * * * * * * * * * * * * * * * * * **
 
 
-LinearMapR2 LinearMapR2::Inverse() const			// Returns inverse
+template<class T> LinearMapR2T<T> LinearMapR2T<T>::Inverse() const			// Returns inverse
 {
 
 
-	register double detInv = 1.0/(m11*m22 - m12*m21) ;
+	register T detInv = (T)1.0/(m11*m22 - m12*m21) ;
 
-	return( LinearMapR2( m22*detInv, -m21*detInv, -m12*detInv, m11*detInv ) );
+	return( LinearMapR2T<T>( m22*detInv, -m21*detInv, -m12*detInv, m11*detInv ) );
 }
 
-LinearMapR2& LinearMapR2::Invert() 			// Converts into inverse.
+template<class T> LinearMapR2T<T>& LinearMapR2T<T>::Invert() 			// Converts into inverse.
 {
-	register double detInv = 1.0/(m11*m22 - m12*m21) ;
+	register T detInv = (T)1.0/(m11*m22 - m12*m21) ;
 
-	double temp;
+	T temp;
 	temp = m11*detInv;
 	m11= m22*detInv;
 	m22=temp;
@@ -72,7 +153,7 @@ LinearMapR2& LinearMapR2::Invert() 			// Converts into inverse.
 	return ( *this );
 }
 
-VectorR2 LinearMapR2::Solve(const VectorR2& u) const	// Returns solution
+template<class T> VectorR2T<T> LinearMapR2T<T>::Solve(const VectorR2T<T>& u) const	// Returns solution
 {												
 	// Just uses Inverse() for now.
 	return ( Inverse()*u );
@@ -95,9 +176,19 @@ VectorR2 LinearMapR2::Solve(const VectorR2& u) const	// Returns solution
 //  Stream Output Routines										 *
 // * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
 
-ostream& operator<< ( ostream& os, const VectorR2& u )
+template<class T> ostream& operator<< ( ostream& os, const VectorR2T<T>& u )
 {
 	return (os << "<" << u.x << "," << u.y << ">");
 }
 
+// ***************************************************************
+//  Instantiations for double and for float						 *
+// * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+
+template class LinearMapR2T<double>;
+template class LinearMapR2T<float>;
+
+template ostream& operator<< ( ostream& os, const VectorR2T<double>& u );
+template ostream& operator<< ( ostream& os, const VectorR2T<float>& u );
+
 
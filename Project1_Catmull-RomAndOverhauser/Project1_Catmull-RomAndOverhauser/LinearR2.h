@@ -36,6 +36,11 @@
 //
 //	  B.2 RotationMapR2 - orthonormal 2x2 matrix
 //
+// The classes are templates over the scalar type, VectorR2T<T> etc.
+//    VectorR2, VectorHgR2, Matrix2x2, LinearMapR2 and RotationMapR2 are
+//    the classes over double, as before, and VectorR2f etc. the classes
+//    over float.  The functions in LinearR2.cpp are instantiated for both.
+//
 
 #ifndef LINEAR_R2_H
 #define LINEAR_R2_H
@@ -46,218 +51,245 @@
 #include "MathMisc.h"
 using namespace std;
 
-class VectorR2;				// R2 Vector
-class VectorHgR2;
-class Matrix2x2;
-class LinearMapR2;			// 2x2 real matrix
+template<class T> class VectorR2T;				// R2 Vector
+template<class T> class VectorHgR2T;
+template<class T> class Matrix2x2T;
+template<class T> class LinearMapR2T;			// 2x2 real matrix
 class AffineMapR3;			// Affine Map (3x4 Matrix)
-class RotationMapR2;		// 2x2 rotation map
+template<class T> class RotationMapR2T;		// 2x2 rotation map
+
+typedef VectorR2T<double> VectorR2;
+typedef VectorHgR2T<double> VectorHgR2;
+typedef Matrix2x2T<double> Matrix2x2;
+typedef LinearMapR2T<double> LinearMapR2;
+typedef RotationMapR2T<double> RotationMapR2;
+
+typedef VectorR2T<float> VectorR2f;
+typedef VectorHgR2T<float> VectorHgR2f;
+typedef Matrix2x2T<float> Matrix2x2f;
+typedef LinearMapR2T<float> LinearMapR2f;
+typedef RotationMapR2T<float> RotationMapR2f;
 
 // **************************************
-// VectorR2 class                       *
+// VectorR2T class                       *
 // * * * * * * * * * * * * * * * * * * **
 
-class VectorR2 {
+template<class T> class VectorR2T {
 
 public:
-	double x, y;		// The x & y  coordinates.
+	typedef T Scalar;
+	T x, y;		// The x & y  coordinates.
 
 public:
-	VectorR2( ) : x(0.0), y(0.0) {}
-	VectorR2( double xVal, double yVal )
+	VectorR2T( ) : x(0.0), y(0.0) {}
+	VectorR2T( T xVal, T yVal )
 		: x(xVal), y(yVal) {}
-	VectorR2( const VectorHgR2& uH );
+	VectorR2T( const VectorHgR2T<T>& uH );
+	template<class U> explicit VectorR2T( const VectorR2T<U>& u )	// Converts between float and double
+		: x((T)u.x), y((T)u.y) {}
 
-	VectorR2& SetZero() { x=0.0; y=0.0; return *this;}
-	VectorR2& Set( double xx, double yy ) 
+	VectorR2T<T>& SetZero() { x=0.0; y=0.0; return *this;}
+	VectorR2T<T>& Set( T xx, T yy ) 
 			{ x=xx; y=yy; return *this;}
-	VectorR2& SetUnitX() { x=1.0; y=0.0; return *this;}
-	VectorR2& SetUnitY() { x=0.0; y=1.0; return *this;}
-	VectorR2& SetNegUnitX() { x=-1.0; y=0.0; return *this;}
-	VectorR2& SetNegUnitY() { x=0.0; y=-1.0; return *this;}
-	VectorR2& Load( const double* v );
-	VectorR2& Load( const float* v );
+	VectorR2T<T>& SetUnitX() { x=1.0; y=0.0; return *this;}
+	VectorR2T<T>& SetUnitY() { x=0.0; y=1.0; return *this;}
+	VectorR2T<T>& SetNegUnitX() { x=-1.0; y=0.0; return *this;}
+	VectorR2T<T>& SetNegUnitY() { x=0.0; y=-1.0; return *this;}
+	VectorR2T<T>& Load( const double* v );
+	VectorR2T<T>& Load( const float* v );
 	void Dump( double* v ) const;
 	void Dump( float* v ) const;
 
-	static const VectorR2 Zero;
+	static const VectorR2T<T> Zero;
 	// Deprecated due to unsafeness of global initialization
-	//static const VectorR2 UnitX;
-	//static const VectorR2 UnitY;
-	//static const VectorR2 NegUnitX;
-	//static const VectorR2 NegUnitY;
+	//static const VectorR2T UnitX;
+	//static const VectorR2T UnitY;
+	//static const VectorR2T NegUnitX;
+	//static const VectorR2T NegUnitY;
 
-	VectorR2& operator+= ( const VectorR2& v ) 
+	VectorR2T<T>& operator+= ( const VectorR2T<T>& v ) 
 		{ x+=v.x; y+=v.y; return(*this); } 
-	VectorR2& operator-= ( const VectorR2& v ) 
+	VectorR2T<T>& operator-= ( const VectorR2T<T>& v ) 
 		{ x-=v.x; y-=v.y; return(*this); }
-	VectorR2& operator*= ( double m ) 
+	VectorR2T<T>& operator*= ( T m ) 
 		{ x*=m; y*=m; return(*this); }
-	VectorR2& operator/= ( double m ) 
-			{ register double mInv = 1.0/m; 
+	VectorR2T<T>& operator/= ( T m ) 
+			{ register T mInv = (T)1.0/m; 
 			  x*=mInv; y*=mInv;
 			  return(*this); }
-	VectorR2 operator- () const { return ( VectorR2(-x, -y) ); }
-	VectorR2& ArrayProd(const VectorR2&);		// Component-wise product
-
-	VectorR2& AddScaled( const VectorR2& u, double s );
-
-	double Norm() const { return ( sqrt( x*x + y*y ) ); }
-	double L1Norm() const { return (Max(fabs(x),fabs(y))); }
-	double Dist( const VectorR2& u ) const;	// Distance from u
-	double DistSq( const VectorR2& u ) const;	// Distance from u
-	double NormSq() const { return ( x*x + y*y ); }
-	double MaxAbs() const;
-	VectorR2& Normalize () { *this /= Norm(); return *this;}	// No error checking
-	VectorR2& MakeUnit();		// Normalize() with error checking
-	VectorR2& ReNormalize();
-	bool IsUnit( double tolerance = 1.0e-15 ) const
-		{ register double norm = Norm();
+	VectorR2T<T> operator- () const { return ( VectorR2T<T>(-x, -y) ); }
+	VectorR2T<T>& ArrayProd(const VectorR2T<T>&);		// Component-wise product
+
+	VectorR2T<T>& AddScaled( const VectorR2T<T>& u, T s );
+
+	T Norm() const { return ( sqrt( x*x + y*y ) ); }
+	T L1Norm() const { return (Max(fabs(x),fabs(y))); }
+	T Dist( const VectorR2T<T>& u ) const;	// Distance from u
+	T DistSq( const VectorR2T<T>& u ) const;	// Distance from u
+	T NormSq() const { return ( x*x + y*y ); }
+	T MaxAbs() const;
+	VectorR2T<T>& Normalize () { *this /= Norm(); return *this;}	// No error checking
+	VectorR2T<T>& MakeUnit();		// Normalize() with error checking
+	VectorR2T<T>& ReNormalize();
+	bool IsUnit( T tolerance = 1.0e-15 ) const
+		{ register T norm = Norm();
 		  return ( 1.0+tolerance>=norm && norm>=1.0-tolerance ); }
 	bool IsZero() const { return ( x==0.0 && y==0.0 ); }
-	bool NearZero(double tolerance) const { return( MaxAbs()<=tolerance );}
+	bool NearZero(T tolerance) const { return( MaxAbs()<=tolerance );}
 							// tolerance should be non-negative
 
-	VectorR2& Rotate( double theta );	// rotate through angle theta
-	VectorR2& Rotate( double costheta, double sintheta );
+	VectorR2T<T>& Rotate( T theta );	// rotate through angle theta
+	VectorR2T<T>& Rotate( T costheta, T sintheta );
 
 };
 
-inline VectorR2 operator+( const VectorR2& u, const VectorR2& v );
-inline VectorR2 operator-( const VectorR2& u, const VectorR2& v ); 
-inline VectorR2 operator*( const VectorR2& u, double m); 
-inline VectorR2 operator*( double m, const VectorR2& u); 
-inline VectorR2 operator/( const VectorR2& u, double m); 
-inline bool operator==( const VectorR2& u, const VectorR2& v ); 
+template<class T> inline VectorR2T<T> operator+( const VectorR2T<T>& u, const VectorR2T<T>& v );
+template<class T> inline VectorR2T<T> operator-( const VectorR2T<T>& u, const VectorR2T<T>& v ); 
+template<class T> inline VectorR2T<T> operator*( const VectorR2T<T>& u, typename VectorR2T<T>::Scalar m); 
+template<class T> inline VectorR2T<T> operator*( typename VectorR2T<T>::Scalar m, const VectorR2T<T>& u); 
+template<class T> inline VectorR2T<T> operator/( const VectorR2T<T>& u, typename VectorR2T<T>::Scalar m); 
+template<class T> inline bool operator==( const VectorR2T<T>& u, const VectorR2T<T>& v ); 
 
-inline double operator^ (const VectorR2& u, const VectorR2& v ); // Dot Product
-inline double InnerProduct(const VectorR2& u, const VectorR2& v ) { return (u^v); }
-inline VectorR2 ArrayProd ( const VectorR2& u, const VectorR2& v );
+template<class T> inline T operator^ (const VectorR2T<T>& u, const VectorR2T<T>& v ); // Dot Product
+template<class T> inline T InnerProduct(const VectorR2T<T>& u, const VectorR2T<T>& v ) { return (u^v); }
+template<class T> inline VectorR2T<T> ArrayProd ( const VectorR2T<T>& u, const VectorR2T<T>& v );
 
-inline double CrossR2( const VectorR2& u, const VectorR2& v );	// A scalar valued cross product on two R2 vectors
+template<class T> inline T CrossR2( const VectorR2T<T>& u, const VectorR2T<T>& v );	// A scalar valued cross product on two R2 vectors
 
-inline double Mag(const VectorR2& u) { return u.Norm(); }
-inline double Dist(const VectorR2& u, const VectorR2& v) { return u.Dist(v); }
-inline double DistSq(const VectorR2& u, const VectorR2& v) { return u.DistSq(v); }
-inline double NormalizeError (const VectorR2&);
+template<class T> inline T Mag(const VectorR2T<T>& u) { return u.Norm(); }
+template<class T> inline T Dist(const VectorR2T<T>& u, const VectorR2T<T>& v) { return u.Dist(v); }
+template<class T> inline T DistSq(const VectorR2T<T>& u, const VectorR2T<T>& v) { return u.DistSq(v); }
+template<class T> inline T NormalizeError (const VectorR2T<T>&);
 
 // ****************************************
-// VectorHgR2 class                       *
+// VectorHgR2T class                       *
 // * * * * * * * * * * * * * * * * * * * **
 
-class VectorHgR2 {
+template<class T> class VectorHgR2T {
 
 public:
-	double x, y, w;		// The x & y & w coordinates.
+	T x, y, w;		// The x & y & w coordinates.
 
 public:
-	VectorHgR2( ) : x(0.0), y(0.0), w(1.0) {}
-	VectorHgR2( double xVal, double yVal )
+	VectorHgR2T( ) : x(0.0), y(0.0), w(1.0) {}
+	VectorHgR2T( T xVal, T yVal )
 		: x(xVal), y(yVal), w(1.0) {}
-	VectorHgR2( double xVal, double yVal, double wVal )
+	VectorHgR2T( T xVal, T yVal, T wVal )
 		: x(xVal), y(yVal), w(wVal) {}
-	VectorHgR2 ( const VectorR2& u ) : x(u.x), y(u.y), w(1.0) {}
+	VectorHgR2T ( const VectorR2T<T>& u ) : x(u.x), y(u.y), w(1.0) {}
 };
 
 // ********************************************************************
-// Matrix2x2     - base class for 2x2 matrices                        *
+// Matrix2x2T     - base class for 2x2 matrices                        *
 // * * * * * * * * * * * * * * * * * * * * * **************************
 
-class Matrix2x2 {
+template<class T> class Matrix2x2T {
 
 public:
-	double m11, m12, m21, m22;	
+	typedef T Scalar;
+	T m11, m12, m21, m22;	
 									
 	// Implements a 2x2 matrix: m_i_j - row-i and column-j entry
 
 	// Deprecated due to unsafeness of global initialization
-	//static const Matrix2x2 Identity;
+	//static const Matrix2x2T Identity;
 
 public:
 
-	inline Matrix2x2();
-	inline Matrix2x2( const VectorR2&, const VectorR2& );	// Sets by columns!
-	inline Matrix2x2( double, double, double, double );	// Sets by columns
+	inline Matrix2x2T();
+	inline Matrix2x2T( const VectorR2T<T>&, const VectorR2T<T>& );	// Sets by columns!
+	inline Matrix2x2T( T, T, T, T );	// Sets by columns
 
 	inline void SetIdentity ();		// Set to the identity map
 	inline void SetZero ();			// Set to the zero map
-	inline void Set( const VectorR2&, const VectorR2& );
-	inline void Set( double, double, double, double );
-	inline void SetByRows( const VectorR2&, const VectorR2& );
-	inline void SetByRows( double, double, double, double );
-	inline void SetColumn1 ( double, double );
-	inline void SetColumn2 ( double, double );
-	inline void SetColumn1 ( const VectorR2& );
-	inline void SetColumn2 ( const VectorR2& );
-	inline VectorR2 Column1() const;
-	inline VectorR2 Column2() const;
-
-	inline void SetRow1 ( double, double );
-	inline void SetRow2 ( double, double );
-	inline void SetRow1 ( const VectorR2& );
-	inline void SetRow2 ( const VectorR2& );
-	inline VectorR2 Row1() const;
-	inline VectorR2 Row2() const;
-
-	inline void SetDiagonal( double, double );
-	inline void SetDiagonal( const VectorR2& );
-	inline double Diagonal( int );
+	inline void Set( const VectorR2T<T>&, const VectorR2T<T>& );
+	inline void Set( T, T, T, T );
+	inline void SetByRows( const VectorR2T<T>&, const VectorR2T<T>& );
+	inline void SetByRows( T, T, T, T );
+	inline void SetColumn1 ( T, T );
+	inline void SetColumn2 ( T, T );
+	inline void SetColumn1 ( const VectorR2T<T>& );
+	inline void SetColumn2 ( const VectorR2T<T>& );
+	inline VectorR2T<T> Column1() const;
+	inline VectorR2T<T> Column2() const;
+
+	inline void SetRow1 ( T, T );
+	inline void SetRow2 ( T, T );
+	inline void SetRow1 ( const VectorR2T<T>& );
+	inline void SetRow2 ( const VectorR2T<T>& );
+	inline VectorR2T<T> Row1() const;
+	inline VectorR2T<T> Row2() const;
+
+	inline void SetDiagonal( T, T );
+	inline void SetDiagonal( const VectorR2T<T>& );
+	inline T Diagonal( int );
 
 	inline void MakeTranspose();					// Transposes it.
-	inline void operator*= (const Matrix2x2& B);	// Matrix product
-	inline Matrix2x2& ReNormalize();
+	inline void operator*= (const Matrix2x2T<T>& B);	// Matrix product
+	inline Matrix2x2T<T>& ReNormalize();
+
+	inline void Transform( VectorR2T<T>* ) const;
+	inline void Transform( const VectorR2T<T>& src, VectorR2T<T>* dest) const;
 
-	inline void Transform( VectorR2* ) const;
-	inline void Transform( const VectorR2& src, VectorR2* dest) const;
+	// Batch transforms of n points, stored as separate arrays of x's and y's
+	//    or as interleaved (x,y) pairs.  dest may be the same as src.
+	//    The float versions are vectorized, in LinearR2.cpp.
+	void TransformArrays( int n, const T* srcX, const T* srcY, T* destX, T* destY ) const;
+	void TransformPairs( int n, const T* src, T* dest ) const;
 
-	double Trace() const { return m11+m22; }
+	T Trace() const { return m11+m22; }
 
 };
 
-inline double NormalizeError( const Matrix2x2& );
-inline VectorR2 operator* ( const Matrix2x2&, const VectorR2& );
+template<class T> inline T NormalizeError( const Matrix2x2T<T>& );
+template<class T> inline VectorR2T<T> operator* ( const Matrix2x2T<T>&, const VectorR2T<T>& );
 
-ostream& operator<< ( ostream& os, const Matrix2x2& A );
+template<class T> ostream& operator<< ( ostream& os, const Matrix2x2T<T>& A );
 
 
 // *****************************************
-// LinearMapR2 class                       *
+// LinearMapR2T class                       *
 // * * * * * * * * * * * * * * * * * * * * *
 
-class LinearMapR2 : public Matrix2x2 {
+template<class T> class LinearMapR2T : public Matrix2x2T<T> {
 
 public:
+	using Matrix2x2T<T>::m11;		// Members of the (dependent) base class
+	using Matrix2x2T<T>::m12;
+	using Matrix2x2T<T>::m21;
+	using Matrix2x2T<T>::m22;
+	using Matrix2x2T<T>::SetZero;
 
-	LinearMapR2();
-	LinearMapR2( const VectorR2&, const VectorR2& );	// Sets by columns!
-	LinearMapR2( double, double, double, double );	// Sets by columns
-	LinearMapR2 ( const Matrix2x2& );
+	LinearMapR2T();
+	LinearMapR2T( const VectorR2T<T>&, const VectorR2T<T>& );	// Sets by columns!
+	LinearMapR2T( T, T, T, T );	// Sets by columns
+	LinearMapR2T ( const Matrix2x2T<T>& );
 
 	inline void Negate();
-	inline LinearMapR2& operator+= (const Matrix2x2& );
-	inline LinearMapR2& operator-= (const Matrix2x2& );
-	inline LinearMapR2& operator*= (double);
-	inline LinearMapR2& operator/= (double);
-	inline LinearMapR2& operator*= (const Matrix2x2& );	// Matrix product
-
-	inline LinearMapR2 Transpose() const;
-	inline double Determinant () const;		// Returns the determinant
-	LinearMapR2 Inverse() const;			// Returns inverse
-	LinearMapR2& Invert();					// Converts into inverse.
-	VectorR2 Solve(const VectorR2&) const;	// Returns solution
-	LinearMapR2 PseudoInverse() const;		// Returns pseudo-inverse TO DO
-	VectorR2 PseudoSolve(const VectorR2&);	// Finds least squares solution TO DO
+	inline LinearMapR2T<T>& operator+= (const Matrix2x2T<T>& );
+	inline LinearMapR2T<T>& operator-= (const Matrix2x2T<T>& );
+	inline LinearMapR2T<T>& operator*= (T);
+	inline LinearMapR2T<T>& operator/= (T);
+	inline LinearMapR2T<T>& operator*= (const Matrix2x2T<T>& );	// Matrix product
+
+	inline LinearMapR2T<T> Transpose() const;
+	inline T Determinant () const;		// Returns the determinant
+	LinearMapR2T<T> Inverse() const;			// Returns inverse
+	LinearMapR2T<T>& Invert();					// Converts into inverse.
+	VectorR2T<T> Solve(const VectorR2T<T>&) const;	// Returns solution
+	LinearMapR2T<T> PseudoInverse() const;		// Returns pseudo-inverse TO DO
+	VectorR2T<T> PseudoSolve(const VectorR2T<T>&);	// Finds least squares solution TO DO
 };
 	
-inline LinearMapR2 operator+ ( const LinearMapR2&, const LinearMapR2&);
-inline LinearMapR2 operator- ( const Matrix2x2& );
-inline LinearMapR2 operator- ( const LinearMapR2&, const LinearMapR2&);
-inline LinearMapR2 operator* ( const LinearMapR2&, double);
-inline LinearMapR2 operator* ( double, const LinearMapR2& );
-inline LinearMapR2 operator/ ( const LinearMapR2&, double );
-inline LinearMapR2 operator* ( const Matrix2x2&, const LinearMapR2& ); 
-inline LinearMapR2 operator* ( const LinearMapR2&, const Matrix2x2& ); 
-inline LinearMapR2 operator* ( const LinearMapR2&, const LinearMapR2& ); 
+template<class T> inline LinearMapR2T<T> operator+ ( const LinearMapR2T<T>&, const LinearMapR2T<T>&);
+template<class T> inline LinearMapR2T<T> operator- ( const Matrix2x2T<T>& );
+template<class T> inline LinearMapR2T<T> operator- ( const LinearMapR2T<T>&, const LinearMapR2T<T>&);
+template<class T> inline LinearMapR2T<T> operator* ( const LinearMapR2T<T>&, typename Matrix2x2T<T>::Scalar );
+template<class T> inline LinearMapR2T<T> operator* ( typename Matrix2x2T<T>::Scalar, const LinearMapR2T<T>& );
+template<class T> inline LinearMapR2T<T> operator/ ( const LinearMapR2T<T>&, typename Matrix2x2T<T>::Scalar );
+template<class T> inline LinearMapR2T<T> operator* ( const Matrix2x2T<T>&, const LinearMapR2T<T>& ); 
+template<class T> inline LinearMapR2T<T> operator* ( const LinearMapR2T<T>&, const Matrix2x2T<T>& ); 
+template<class T> inline LinearMapR2T<T> operator* ( const LinearMapR2T<T>&, const LinearMapR2T<T>& ); 
 								// Matrix product (composition)
 
 
@@ -265,25 +297,31 @@ inline LinearMapR2 operator* ( const LinearMapR2&, const LinearMapR2& );
 // RotationMapR2class                        *
 // * * * * * * * * * * * * * * * * * * * * * *
 
-class RotationMapR2 : public Matrix2x2 {
+template<class T> class RotationMapR2T : public Matrix2x2T<T> {
 
 public:
+	using Matrix2x2T<T>::m11;		// Members of the (dependent) base class
+	using Matrix2x2T<T>::m12;
+	using Matrix2x2T<T>::m21;
+	using Matrix2x2T<T>::m22;
+	using Matrix2x2T<T>::SetIdentity;
+	using Matrix2x2T<T>::MakeTranspose;
 
-	RotationMapR2();
-	RotationMapR2( const VectorR2&, const VectorR2& );	// Sets by columns!
-	RotationMapR2( double, double, double, double );	// Sets by columns!
+	RotationMapR2T();
+	RotationMapR2T( const VectorR2T<T>&, const VectorR2T<T>& );	// Sets by columns!
+	RotationMapR2T( T, T, T, T );	// Sets by columns!
 
-	RotationMapR2& SetZero();	// IT IS AN ERROR TO USE THIS FUNCTION!
+	RotationMapR2T<T>& SetZero();	// IT IS AN ERROR TO USE THIS FUNCTION!
 
-	inline RotationMapR2& operator*= (const RotationMapR2& );	// Matrix product
+	inline RotationMapR2T<T>& operator*= (const RotationMapR2T<T>& );	// Matrix product
 
-	inline RotationMapR2 Transpose() const;
-	inline RotationMapR2 Inverse() const { return Transpose(); }; // Returns the transpose
-	inline RotationMapR2& Invert() { MakeTranspose(); return *this; };	// Transposes it.
-	inline VectorR2 Invert(const VectorR2&) const;	// Returns solution
+	inline RotationMapR2T<T> Transpose() const;
+	inline RotationMapR2T<T> Inverse() const { return Transpose(); }; // Returns the transpose
+	inline RotationMapR2T<T>& Invert() { MakeTranspose(); return *this; };	// Transposes it.
+	inline VectorR2T<T> Invert(const VectorR2T<T>&) const;	// Returns solution
 };
 	
-inline RotationMapR2 operator* ( const RotationMapR2&, const RotationMapR2& ); 
+template<class T> inline RotationMapR2T<T> operator* ( const RotationMapR2T<T>&, const RotationMapR2T<T>& ); 
 										// Matrix product (composition)
 
 
@@ -294,31 +332,31 @@ inline RotationMapR2 operator* ( const RotationMapR2&, const RotationMapR2& );
 
 // Returns the angle between vectors u and v.
 //		Use AngleUnit if both vectors are unit vectors
-inline double Angle( const VectorR2& u, const VectorR2& v);
-inline double AngleUnit( const VectorR2& u, const VectorR2& v );
+template<class T> inline T Angle( const VectorR2T<T>& u, const VectorR2T<T>& v);
+template<class T> inline T AngleUnit( const VectorR2T<T>& u, const VectorR2T<T>& v );
 
 // Returns a righthanded orthonormal basis to complement vector  u
 //		The vector u must be unit.
-inline VectorR2 GetOrtho( const VectorR2& u );
+template<class T> inline VectorR2T<T> GetOrtho( const VectorR2T<T>& u );
 
 // Projections
 
-inline VectorR2 ProjectToUnit ( const VectorR2& u, const VectorR2& v); 
+template<class T> inline VectorR2T<T> ProjectToUnit ( const VectorR2T<T>& u, const VectorR2T<T>& v); 
 			// Project u onto v
-inline VectorR2 ProjectPerpUnit ( const VectorR2& u, const VectorR2 & v); 
+template<class T> inline VectorR2T<T> ProjectPerpUnit ( const VectorR2T<T>& u, const VectorR2T<T> & v); 
 			// Project perp to v
 // v must be a unit vector.
 
-// Projection maps (LinearMapR2's)
+// Projection maps (LinearMapR2T's)
 
-inline LinearMapR2 VectorProjectMap( const VectorR2& u );
+template<class T> inline LinearMapR2T<T> VectorProjectMap( const VectorR2T<T>& u );
 
-inline LinearMapR2 PerpProjectMap ( const VectorR2& u );
+template<class T> inline LinearMapR2T<T> PerpProjectMap ( const VectorR2T<T>& u );
 // u - must be unit vector.  
 
 // Rotation Maps
 
-inline RotationMapR2 RotateToMap( const VectorR2& fromVec, const VectorR2& toVec);
+template<class T> inline RotationMapR2T<T> RotateToMap( const VectorR2T<T>& fromVec, const VectorR2T<T>& toVec);
 // fromVec and toVec should be unit vectors
 
 
@@ -327,176 +365,178 @@ inline RotationMapR2 RotateToMap( const VectorR2& fromVec, const VectorR2& toVec
 // * Stream Output Routines	(Prototypes)						 *
 // * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
 
-ostream& operator<< ( ostream& os, const VectorR2& u );
+template<class T> ostream& operator<< ( ostream& os, const VectorR2T<T>& u );
 
 
+template<class T> const VectorR2T<T> VectorR2T<T>::Zero;
+
 // *****************************************************
-// * VectorR2 class - inlined functions				   *
+// * VectorR2T class - inlined functions				   *
 // * * * * * * * * * * * * * * * * * * * * * * * * * * *
 
-inline VectorR2& VectorR2::Load( const double* v ) 
+template<class T> inline VectorR2T<T>& VectorR2T<T>::Load( const double* v ) 
 {
-	x = *v; 
-	y = *(v+1);
+	x = (T)*v; 
+	y = (T)*(v+1);
 	return *this;
 }
 
-inline VectorR2& VectorR2::Load( const float* v ) 
+template<class T> inline VectorR2T<T>& VectorR2T<T>::Load( const float* v ) 
 {
 	x = *v; 
 	y = *(v+1);
 	return *this;
 }
 
-inline 	void VectorR2::Dump( double* v ) const
+template<class T> inline 	void VectorR2T<T>::Dump( double* v ) const
 {
 	*v = x; 
 	*(v+1) = y;
 }
 
-inline 	void VectorR2::Dump( float* v ) const
+template<class T> inline 	void VectorR2T<T>::Dump( float* v ) const
 {
 	*v = (float)x; 
 	*(v+1) = (float)y;
 }
 
-inline VectorR2& VectorR2::ArrayProd (const VectorR2& v)		// Component-wise Product
+template<class T> inline VectorR2T<T>& VectorR2T<T>::ArrayProd (const VectorR2T<T>& v)		// Component-wise Product
 {
 	x *= v.x;
 	y *= v.y;
 	return ( *this );
 }
 
-inline VectorR2& VectorR2::MakeUnit ()	 // Convert to unit vector (or leave zero).
+template<class T> inline VectorR2T<T>& VectorR2T<T>::MakeUnit ()	 // Convert to unit vector (or leave zero).
 {
-	double nSq = NormSq();
+	T nSq = NormSq();
 	if (nSq != 0.0) {
 		*this /= sqrt(nSq);
 	}
 	return *this;
 }
 
-inline VectorR2& VectorR2::ReNormalize()			// Convert near unit back to unit
+template<class T> inline VectorR2T<T>& VectorR2T<T>::ReNormalize()			// Convert near unit back to unit
 {
-	double nSq = NormSq();
-	register double mFact = 1.0-0.5*(nSq-1.0);	// Multiplicative factor
+	T nSq = NormSq();
+	register T mFact = (T)1.0-(T)0.5*(nSq-(T)1.0);	// Multiplicative factor
 	*this *= mFact;
 	return *this;
 }
 
 // Rotate through angle theta
-inline VectorR2& VectorR2::Rotate( double theta )
+template<class T> inline VectorR2T<T>& VectorR2T<T>::Rotate( T theta )
 {
-	double costheta = cos(theta);
-	double sintheta = sin(theta);
-	double tempx = x*costheta - y*sintheta;
+	T costheta = cos(theta);
+	T sintheta = sin(theta);
+	T tempx = x*costheta - y*sintheta;
 	y = y*costheta + x*sintheta;
 	x = tempx;
 	return *this;
 }
 
-inline VectorR2& VectorR2::Rotate( double costheta, double sintheta )
+template<class T> inline VectorR2T<T>& VectorR2T<T>::Rotate( T costheta, T sintheta )
 {
-	double tempx = x*costheta + y*sintheta;
+	T tempx = x*costheta + y*sintheta;
 	y = y*costheta - x*sintheta;
 	x = tempx;
 	return *this;
 }
 
-inline double VectorR2::MaxAbs() const
+template<class T> inline T VectorR2T<T>::MaxAbs() const
 {
-	register double m;
+	register T m;
 	m = (x>=0.0) ? x : -x;
 	if ( y>m ) m=y;
 	else if ( -y >m ) m = -y;
 	return m;
 }
 
-inline VectorR2 operator+( const VectorR2& u, const VectorR2& v ) 
+template<class T> inline VectorR2T<T> operator+( const VectorR2T<T>& u, const VectorR2T<T>& v ) 
 { 
-	return VectorR2(u.x+v.x, u.y+v.y ); 
+	return VectorR2T<T>(u.x+v.x, u.y+v.y ); 
 }
-inline VectorR2 operator-( const VectorR2& u, const VectorR2& v ) 
+template<class T> inline VectorR2T<T> operator-( const VectorR2T<T>& u, const VectorR2T<T>& v ) 
 { 
-	return VectorR2(u.x-v.x, u.y-v.y ); 
+	return VectorR2T<T>(u.x-v.x, u.y-v.y ); 
 }
-inline VectorR2 operator*( const VectorR2& u, register double m) 
+template<class T> inline VectorR2T<T> operator*( const VectorR2T<T>& u, register typename VectorR2T<T>::Scalar m) 
 { 
-	return VectorR2( u.x*m, u.y*m ); 
+	return VectorR2T<T>( u.x*m, u.y*m ); 
 }
-inline VectorR2 operator*( register double m, const VectorR2& u) 
+template<class T> inline VectorR2T<T> operator*( register typename VectorR2T<T>::Scalar m, const VectorR2T<T>& u) 
 { 
-	return VectorR2( u.x*m, u.y*m ); 
+	return VectorR2T<T>( u.x*m, u.y*m ); 
 }
-inline VectorR2 operator/( const VectorR2& u, double m) 
+template<class T> inline VectorR2T<T> operator/( const VectorR2T<T>& u, typename VectorR2T<T>::Scalar m) 
 { 
-	register double mInv = 1.0/m;
-	return VectorR2( u.x*mInv, u.y*mInv ); 
+	register T mInv = (T)1.0/m;
+	return VectorR2T<T>( u.x*mInv, u.y*mInv ); 
 }
 
-inline bool operator==( const VectorR2& u, const VectorR2& v ) 
+template<class T> inline bool operator==( const VectorR2T<T>& u, const VectorR2T<T>& v ) 
 {
 	return ( u.x==v.x && u.y==v.y );
 }
 
-inline double operator^ ( const VectorR2& u, const VectorR2& v ) // Dot Product
+template<class T> inline T operator^ ( const VectorR2T<T>& u, const VectorR2T<T>& v ) // Dot Product
 { 
 	return ( u.x*v.x + u.y*v.y ); 
 }
 
-inline VectorR2 ArrayProd ( const VectorR2& u, const VectorR2& v )
+template<class T> inline VectorR2T<T> ArrayProd ( const VectorR2T<T>& u, const VectorR2T<T>& v )
 {
-	return ( VectorR2( u.x*v.x, u.y*v.y ) );
+	return ( VectorR2T<T>( u.x*v.x, u.y*v.y ) );
 }
 
 // A scalar valued cross product on two R2 vectors
-inline double CrossR2( const VectorR2& u, const VectorR2& v )
+template<class T> inline T CrossR2( const VectorR2T<T>& u, const VectorR2T<T>& v )
 {
 	return ( u.x*v.y - u.y*v.x );
 }
 
 
-inline VectorR2& VectorR2::AddScaled( const VectorR2& u, double s ) 
+template<class T> inline VectorR2T<T>& VectorR2T<T>::AddScaled( const VectorR2T<T>& u, T s ) 
 {
 	x += s*u.x;
 	y += s*u.y;
 	return(*this);
 }
 
-inline VectorR2::VectorR2( const VectorHgR2& uH ) 
+template<class T> inline VectorR2T<T>::VectorR2T( const VectorHgR2T<T>& uH ) 
 : x(uH.x), y(uH.y)
 { 
 	*this /= uH.w; 
 }
 
-inline double NormalizeError (const VectorR2& u)
+template<class T> inline T NormalizeError (const VectorR2T<T>& u)
 {
-	register double discrepancy;
-	discrepancy = u.x*u.x + u.y*u.y - 1.0;
+	register T discrepancy;
+	discrepancy = u.x*u.x + u.y*u.y - (T)1.0;
 	if ( discrepancy < 0.0 ) {
 		discrepancy = -discrepancy;
 	}
 	return discrepancy;
 }
 
-inline double VectorR2::Dist( const VectorR2& u ) const 	// Distance from u
+template<class T> inline T VectorR2T<T>::Dist( const VectorR2T<T>& u ) const 	// Distance from u
 {
 	return sqrt( DistSq(u) );
 }
 
-inline double VectorR2::DistSq( const VectorR2& u ) const	// Distance from u
+template<class T> inline T VectorR2T<T>::DistSq( const VectorR2T<T>& u ) const	// Distance from u
 {
 	return ( (x-u.x)*(x-u.x) + (y-u.y)*(y-u.y) );
 }
 
 
 // *********************************************************
-// * Matrix2x2 class - inlined functions				   *
+// * Matrix2x2T class - inlined functions				   *
 // * * * * * * * * * * * * * * * * * * * * * * * * * * *****
 
-inline Matrix2x2::Matrix2x2() {}
+template<class T> inline Matrix2x2T<T>::Matrix2x2T() {}
 
-inline Matrix2x2::Matrix2x2( const VectorR2& u, const VectorR2& v )
+template<class T> inline Matrix2x2T<T>::Matrix2x2T( const VectorR2T<T>& u, const VectorR2T<T>& v )
 {
 	m11 = u.x;		// Column 1
 	m21 = u.y;
@@ -504,7 +544,7 @@ inline Matrix2x2::Matrix2x2( const VectorR2& u, const VectorR2& v )
 	m22 = v.y;
 }
 
-inline Matrix2x2::Matrix2x2( double a11, double a21, double a12, double a22 )
+template<class T> inline Matrix2x2T<T>::Matrix2x2T( T a11, T a21, T a12, T a22 )
 					// Values specified in column order!!!
 {
 	m11 = a11;		// Row 1
@@ -513,13 +553,13 @@ inline Matrix2x2::Matrix2x2( double a11, double a21, double a12, double a22 )
 	m22 = a22;
 }
 
-inline void Matrix2x2::SetIdentity ( )
+template<class T> inline void Matrix2x2T<T>::SetIdentity ( )
 {
 	m11 = m22 = 1.0;
 	m12 = m21 = 0.0;
 }
 
-inline void Matrix2x2::Set( const VectorR2& u, const VectorR2& v )
+template<class T> inline void Matrix2x2T<T>::Set( const VectorR2T<T>& u, const VectorR2T<T>& v )
 {
 	m11 = u.x;		// Column 1
 	m21 = u.y;
@@ -527,7 +567,7 @@ inline void Matrix2x2::Set( const VectorR2& u, const VectorR2& v )
 	m22 = v.y;
 }
 
-inline void Matrix2x2::Set( double a11, double a21, double a12, double a22 )
+template<class T> inline void Matrix2x2T<T>::Set( T a11, T a21, T a12, T a22 )
 					// Values specified in column order!!!
 {
 	m11 = a11;		// Row 1
@@ -536,12 +576,12 @@ inline void Matrix2x2::Set( double a11, double a21, double a12, double a22 )
 	m22 = a22;
 }
 
-inline void Matrix2x2::SetZero( ) 
+template<class T> inline void Matrix2x2T<T>::SetZero( ) 
 {
 	m11 = m12 = m21 = m22 = 0.0;
 }
 
-inline void Matrix2x2::SetByRows( const VectorR2& u, const VectorR2& v )
+template<class T> inline void Matrix2x2T<T>::SetByRows( const VectorR2T<T>& u, const VectorR2T<T>& v )
 {
 	m11 = u.x;		// Row 1
 	m12 = u.y;
@@ -549,7 +589,7 @@ inline void Matrix2x2::SetByRows( const VectorR2& u, const VectorR2& v )
 	m22 = v.y;
 }
 
-inline void Matrix2x2::SetByRows( double a11, double a12, double a21, double a22 )
+template<class T> inline void Matrix2x2T<T>::SetByRows( T a11, T a12, T a21, T a22 )
 					// Values specified in row order!!!
 {
 	m11 = a11;		// Row 1
@@ -558,78 +598,78 @@ inline void Matrix2x2::SetByRows( double a11, double a12, double a21, double a22
 	m22 = a22;
 }
 
-inline void Matrix2x2::SetColumn1 ( double x, double y )
+template<class T> inline void Matrix2x2T<T>::SetColumn1 ( T x, T y )
 {
 	m11 = x; m21 = y;
 }
 
-inline void Matrix2x2::SetColumn2 ( double x, double y )
+template<class T> inline void Matrix2x2T<T>::SetColumn2 ( T x, T y )
 {
 	m12 = x; m22 = y;
 }
 
-inline void Matrix2x2::SetColumn1 ( const VectorR2& u )
+template<class T> inline void Matrix2x2T<T>::SetColumn1 ( const VectorR2T<T>& u )
 {
 	m11 = u.x; m21 = u.y;
 }
 
-inline void Matrix2x2::SetColumn2 ( const VectorR2& u )
+template<class T> inline void Matrix2x2T<T>::SetColumn2 ( const VectorR2T<T>& u )
 {
 	m12 = u.x; m22 = u.y;
 }
 
-VectorR2 Matrix2x2::Column1() const
+template<class T> VectorR2T<T> Matrix2x2T<T>::Column1() const
 {
-	return ( VectorR2(m11, m21) );
+	return ( VectorR2T<T>(m11, m21) );
 }
 
-VectorR2 Matrix2x2::Column2() const
+template<class T> VectorR2T<T> Matrix2x2T<T>::Column2() const
 {
-	return ( VectorR2(m12, m22) );
+	return ( VectorR2T<T>(m12, m22) );
 }
 
-inline void Matrix2x2::SetRow1 ( double x, double y )
+template<class T> inline void Matrix2x2T<T>::SetRow1 ( T x, T y )
 {
 	m11 = x; m12 = y;
 }
 
-inline void Matrix2x2::SetRow2 ( double x, double y )
+template<class T> inline void Matrix2x2T<T>::SetRow2 ( T x, T y )
 {
 	m21 = x; m22 = y;
 }
 
-inline void Matrix2x2::SetRow1 ( const VectorR2& u )
+template<class T> inline void Matrix2x2T<T>::SetRow1 ( const VectorR2T<T>& u )
 {
 	m11 = u.x; m12 = u.y;
 }
 
-inline void Matrix2x2::SetRow2 ( const VectorR2& u )
+template<class T> inline void Matrix2x2T<T>::SetRow2 ( const VectorR2T<T>& u )
 {
 	m21 = u.x; m22 = u.y;
 }
 
-VectorR2 Matrix2x2::Row1() const
+template<class T> VectorR2T<T> Matrix2x2T<T>::Row1() const
 {
-	return ( VectorR2(m11, m12) );
+	return ( VectorR2T<T>(m11, m12) );
 }
 
-VectorR2 Matrix2x2::Row2() const
+template<class T> VectorR2T<T> Matrix2x2T<T>::Row2() const
 {
-	return ( VectorR2(m21, m22) );
+	return ( VectorR2T<T>(m21, m22) );
 }
 
-inline void Matrix2x2::SetDiagonal( double x, double y )
+template<class T> inline void Matrix2x2T<T>::SetDiagonal( T x, T y )
 {
 	m11 = x;
 	m22 = y;
 }
 
-inline void Matrix2x2::SetDiagonal( const VectorR2& u )
+template<class T> inline void Matrix2x2T<T>::SetDiagonal( const VectorR2T<T>& u )
 {
 	SetDiagonal ( u.x, u.y );
 }
 
-inline double Matrix2x2::Diagonal( int i ) 
+template<class T> inline T Matrix2x2T<T>::Diagonal( int i ) 
 {
 	switch (i) {
 	case 0:
@@ -641,17 +681,17 @@ inline double Matrix2x2::Diagonal( int i )
 		return 0.0;
 	}
 }
-inline void Matrix2x2::MakeTranspose()	// Transposes it.
+template<class T> inline void Matrix2x2T<T>::MakeTranspose()	// Transposes it.
 {
-	register double temp;
+	register T temp;
 	temp = m12;
 	m12 = m21;
 	m21=temp;
 }
 
-inline void Matrix2x2::operator*= (const Matrix2x2& B)	// Matrix product
+template<class T> inline void Matrix2x2T<T>::operator*= (const Matrix2x2T<T>& B)	// Matrix product
 {
-	double t1;		// temporary value
+	T t1;		// temporary value
 
 	t1 =  m11*B.m11 + m12*B.m21;
 	m12 = m11*B.m12 + m12*B.m22;
@@ -662,19 +702,19 @@ inline void Matrix2x2::operator*= (const Matrix2x2& B)	// Matrix product
 	m21 = t1;
 }
 
-inline Matrix2x2& Matrix2x2::ReNormalize()	// Re-normalizes nearly orthonormal matrix
+template<class T> inline Matrix2x2T<T>& Matrix2x2T<T>::ReNormalize()	// Re-normalizes nearly orthonormal matrix
 {
-	register double alpha = m11*m11+m21*m21;	// First column's norm squared
-	register double beta  = m12*m12+m22*m22;	// Second column's norm squared
-	alpha = 1.0 - 0.5*(alpha-1.0);				// Get mult. factor
-	beta  = 1.0 - 0.5*(beta-1.0);
+	register T alpha = m11*m11+m21*m21;	// First column's norm squared
+	register T beta  = m12*m12+m22*m22;	// Second column's norm squared
+	alpha = (T)1.0 - (T)0.5*(alpha-(T)1.0);				// Get mult. factor
+	beta  = (T)1.0 - (T)0.5*(beta-(T)1.0);
 	m11 *= alpha;								// Renormalize first column
 	m21 *= alpha;
 	m12 *= beta;								// Renormalize second column
 	m22 *= beta;
 	alpha = m11*m12+m21*m22;					// Columns' inner product
-	alpha *= 0.5;								//    times 1/2
-	register double temp;
+	alpha *= (T)0.5;								//    times 1/2
+	register T temp;
 	temp = m11-alpha*m12;						// Subtract alpha times other column
 	m12 -= alpha*m11;
 	m11 = temp;
@@ -686,15 +726,15 @@ inline Matrix2x2& Matrix2x2::ReNormalize()	// Re-normalizes nearly orthonormal m
 
 // Gives a measure of how far the matrix is from being normalized.
 //		Mostly intended for diagnostic purposes.
-inline double NormalizeError( const Matrix2x2& A)
+template<class T> inline T NormalizeError( const Matrix2x2T<T>& A)
 {
-	register double discrepancy;
-	register double newdisc;
-	discrepancy = A.m11*A.m11 + A.m21*A.m21 -1.0;	// First column - inner product - 1
+	register T discrepancy;
+	register T newdisc;
+	discrepancy = A.m11*A.m11 + A.m21*A.m21 -(T)1.0;	// First column - inner product - 1
 	if (discrepancy<0.0) {
 		discrepancy = -discrepancy;
 	}
-	newdisc = A.m12*A.m12 + A.m22*A.m22 - 1.0;		// Second column inner product - 1
+	newdisc = A.m12*A.m12 + A.m22*A.m22 - (T)1.0;		// Second column inner product - 1
 	if ( newdisc<0.0 ) {
 		newdisc = -newdisc;
 	}
@@ -711,50 +751,77 @@ inline double NormalizeError( const Matrix2x2& A)
 	return discrepancy;
 }
 
-inline VectorR2 operator* ( const Matrix2x2& A, const VectorR2& u)
+template<class T> inline VectorR2T<T> operator* ( const Matrix2x2T<T>& A, const VectorR2T<T>& u)
 {
-	return(VectorR2 ( A.m11*u.x + A.m12*u.y,
+	return(VectorR2T<T> ( A.m11*u.x + A.m12*u.y,
 					  A.m21*u.x + A.m22*u.y ) ); 
 }
 	
-inline void Matrix2x2::Transform( VectorR2* u ) const {
-	double newX;
+template<class T> inline void Matrix2x2T<T>::Transform( VectorR2T<T>* u ) const {
+	T newX;
 	newX = m11*u->x + m12*u->y;
 	u->y = m21*u->x + m22*u->y;
 	u->x = newX;
 }
 
-inline void Matrix2x2::Transform( const VectorR2& src, VectorR2* dest ) const {
+template<class T> inline void Matrix2x2T<T>::Transform( const VectorR2T<T>& src, VectorR2T<T>* dest ) const {
 	dest->x = m11*src.x + m12*src.y;
 	dest->y = m21*src.x + m22*src.y;
 }
 
+template<class T> inline void Matrix2x2T<T>::TransformArrays( int n, const T* srcX, const T* srcY,
+															   T* destX, T* destY ) const
+{
+	const T a11 = m11, a12 = m12, a21 = m21, a22 = m22;
+	for ( int i=0; i<n; i++ ) {
+		T x = srcX[i];
+		T y = srcY[i];
+		destX[i] = a11*x + a12*y;
+		destY[i] = a21*x + a22*y;
+	}
+}
+
+template<class T> inline void Matrix2x2T<T>::TransformPairs( int n, const T* src, T* dest ) const
+{
+	const T a11 = m11, a12 = m12, a21 = m21, a22 = m22;
+	for ( int i=0; i<2*n; i+=2 ) {
+		T x = src[i];
+		T y = src[i+1];
+		dest[i] = a11*x + a12*y;
+		dest[i+1] = a21*x + a22*y;
+	}
+}
+
+template<> void Matrix2x2T<float>::TransformArrays( int n, const float* srcX, const float* srcY,
+													 float* destX, float* destY ) const;
+template<> void Matrix2x2T<float>::TransformPairs( int n, const float* src, float* dest ) const;
+
 
 
 // ******************************************************
-// * LinearMapR2 class - inlined functions				*
+// * LinearMapR2T class - inlined functions				*
 // * * * * * * * * * * * * * * * * * * * * * * * * * * **
 
-inline LinearMapR2::LinearMapR2()
+template<class T> inline LinearMapR2T<T>::LinearMapR2T()
 {
 	SetZero();
 	return;
 }	
 
-inline LinearMapR2::LinearMapR2( const VectorR2& u, const VectorR2& v )
-:Matrix2x2 ( u, v )
+template<class T> inline LinearMapR2T<T>::LinearMapR2T( const VectorR2T<T>& u, const VectorR2T<T>& v )
+:Matrix2x2T<T> ( u, v )
 { }
 
-inline LinearMapR2::LinearMapR2(double a11, double a21, double a12, double a22)
+template<class T> inline LinearMapR2T<T>::LinearMapR2T(T a11, T a21, T a12, T a22)
 					// Values specified in column order!!!
-:Matrix2x2 ( a11, a21, a12, a22 )
+:Matrix2x2T<T> ( a11, a21, a12, a22 )
 { }
 
-inline LinearMapR2::LinearMapR2 ( const Matrix2x2& A )
-: Matrix2x2 (A) 
+template<class T> inline LinearMapR2T<T>::LinearMapR2T ( const Matrix2x2T<T>& A )
+: Matrix2x2T<T> (A) 
 {}
 
-inline void LinearMapR2::Negate ()
+template<class T> inline void LinearMapR2T<T>::Negate ()
 {
 	m11 = -m11;
 	m12 = -m12;
@@ -762,7 +829,7 @@ inline void LinearMapR2::Negate ()
 	m22 = -m22;
 }
 	
-inline LinearMapR2& LinearMapR2::operator+= (const Matrix2x2& B)
+template<class T> inline LinearMapR2T<T>& LinearMapR2T<T>::operator+= (const Matrix2x2T<T>& B)
 {
 	m11 += B.m11;
 	m12 += B.m12;
@@ -771,7 +838,7 @@ inline LinearMapR2& LinearMapR2::operator+= (const Matrix2x2& B)
 	return ( *this );
 }
 
-inline LinearMapR2& LinearMapR2::operator-= (const Matrix2x2& B)
+template<class T> inline LinearMapR2T<T>& LinearMapR2T<T>::operator-= (const Matrix2x2T<T>& B)
 {
 	m11 -= B.m11;
 	m12 -= B.m12;
@@ -780,24 +847,24 @@ inline LinearMapR2& LinearMapR2::operator-= (const Matrix2x2& B)
 	return( *this );
 }
 
-inline LinearMapR2 operator+ (const LinearMapR2& A, const LinearMapR2& B)
+template<class T> inline LinearMapR2T<T> operator+ (const LinearMapR2T<T>& A, const LinearMapR2T<T>& B)
 {
-	return( LinearMapR2( A.m11+B.m11, A.m21+B.m21,
+	return( LinearMapR2T<T>( A.m11+B.m11, A.m21+B.m21,
 						 A.m12+B.m12, A.m22+B.m22 ) );
 }
 
-inline LinearMapR2 operator- (const Matrix2x2& A)
+template<class T> inline LinearMapR2T<T> operator- (const Matrix2x2T<T>& A)
 {
-	return( LinearMapR2( -A.m11, -A.m21, -A.m12, -A.m22 ) );
+	return( LinearMapR2T<T>( -A.m11, -A.m21, -A.m12, -A.m22 ) );
 }
 
-inline LinearMapR2 operator- (const LinearMapR2& A, const LinearMapR2& B)
+template<class T> inline LinearMapR2T<T> operator- (const LinearMapR2T<T>& A, const LinearMapR2T<T>& B)
 {
-	return( LinearMapR2( A.m11-B.m11, A.m21-B.m21,
+	return( LinearMapR2T<T>( A.m11-B.m11, A.m21-B.m21,
 						 A.m12-B.m12, A.m22-B.m22 ) );
 }
 
-inline LinearMapR2& LinearMapR2::operator*= (register double b)
+template<class T> inline LinearMapR2T<T>& LinearMapR2T<T>::operator*= (register T b)
 {
 	m11 *= b;
 	m12 *= b;
@@ -806,111 +873,111 @@ inline LinearMapR2& LinearMapR2::operator*= (register double b)
 	return ( *this);
 }
 
-inline LinearMapR2 operator* ( const LinearMapR2& A, register double b)
+template<class T> inline LinearMapR2T<T> operator* ( const LinearMapR2T<T>& A, register typename Matrix2x2T<T>::Scalar b)
 {
-	return( LinearMapR2( A.m11*b, A.m21*b,
+	return( LinearMapR2T<T>( A.m11*b, A.m21*b,
 						 A.m12*b, A.m22*b ) );
 }
 
-inline LinearMapR2 operator* ( register double b, const LinearMapR2& A)
+template<class T> inline LinearMapR2T<T> operator* ( register typename Matrix2x2T<T>::Scalar b, const LinearMapR2T<T>& A)
 {
-	return( LinearMapR2( A.m11*b, A.m21*b,
+	return( LinearMapR2T<T>( A.m11*b, A.m21*b,
 						 A.m12*b, A.m22*b ) );
 }
 
-inline LinearMapR2 operator/ ( const LinearMapR2& A, double b)
+template<class T> inline LinearMapR2T<T> operator/ ( const LinearMapR2T<T>& A, typename Matrix2x2T<T>::Scalar b)
 {
-	register double bInv = 1.0/b;
+	register T bInv = (T)1.0/b;
 	return ( A*bInv );
 }
 
-inline LinearMapR2& LinearMapR2::operator/= (register double b)
+template<class T> inline LinearMapR2T<T>& LinearMapR2T<T>::operator/= (register T b)
 {
-	register double bInv = 1.0/b;
+	register T bInv = (T)1.0/b;
 	return ( *this *= bInv );
 }
 
-inline LinearMapR2 LinearMapR2::Transpose() const	// Returns the transpose
+template<class T> inline LinearMapR2T<T> LinearMapR2T<T>::Transpose() const	// Returns the transpose
 {
-	return (LinearMapR2( m11, m12, m21, m22 ) );
+	return (LinearMapR2T<T>( m11, m12, m21, m22 ) );
 }
 
-inline LinearMapR2& LinearMapR2::operator*= (const Matrix2x2& B)	// Matrix product
+template<class T> inline LinearMapR2T<T>& LinearMapR2T<T>::operator*= (const Matrix2x2T<T>& B)	// Matrix product
 {
-	(*this).Matrix2x2::operator*=(B);
+	(*this).Matrix2x2T<T>::operator*=(B);
 
 	return( *this );
 }
 
-inline LinearMapR2 operator* ( const LinearMapR2& A, const Matrix2x2& B)
+template<class T> inline LinearMapR2T<T> operator* ( const LinearMapR2T<T>& A, const Matrix2x2T<T>& B)
 {
-	LinearMapR2 AA(A);
-	AA.Matrix2x2::operator*=(B);
+	LinearMapR2T<T> AA(A);
+	AA.Matrix2x2T<T>::operator*=(B);
 	return AA;
 }
 
-inline LinearMapR2 operator* ( const Matrix2x2& A, const LinearMapR2& B)
+template<class T> inline LinearMapR2T<T> operator* ( const Matrix2x2T<T>& A, const LinearMapR2T<T>& B)
 {
-	LinearMapR2 AA(A);
-	AA.Matrix2x2::operator*=(B);
+	LinearMapR2T<T> AA(A);
+	AA.Matrix2x2T<T>::operator*=(B);
 	return AA;
 }
 
-inline LinearMapR2 operator* ( const LinearMapR2& A, const LinearMapR2& B)
+template<class T> inline LinearMapR2T<T> operator* ( const LinearMapR2T<T>& A, const LinearMapR2T<T>& B)
 {
-	LinearMapR2 AA(A);
-	AA.Matrix2x2::operator*=(B);
+	LinearMapR2T<T> AA(A);
+	AA.Matrix2x2T<T>::operator*=(B);
 	return AA;
 }
 
-inline double LinearMapR2::Determinant () const		// Returns the determinant
+template<class T> inline T LinearMapR2T<T>::Determinant () const		// Returns the determinant
 {
 	return ( m11*m22 - m12*m21 );
 }
 
 // ******************************************************
-// * RotationMapR2 class - inlined functions			*
+// * RotationMapR2T class - inlined functions			*
 // * * * * * * * * * * * * * * * * * * * * * * * * * * **
 
-inline RotationMapR2::RotationMapR2()
+template<class T> inline RotationMapR2T<T>::RotationMapR2T()
 {
 	SetIdentity();
 	return;
 }
 	
-inline RotationMapR2::RotationMapR2( const VectorR2& u, const VectorR2& v )
-:Matrix2x2 ( u, v )
+template<class T> inline RotationMapR2T<T>::RotationMapR2T( const VectorR2T<T>& u, const VectorR2T<T>& v )
+:Matrix2x2T<T> ( u, v )
 { }
 
-inline RotationMapR2::RotationMapR2( 
-							 double a11, double a21, double a12, double a22 )
+template<class T> inline RotationMapR2T<T>::RotationMapR2T( 
+							 T a11, T a21, T a12, T a22 )
 					// Values specified in column order!!!
-:Matrix2x2 ( a11, a21, a12, a22 )
+:Matrix2x2T<T> ( a11, a21, a12, a22 )
 { }
 
-inline RotationMapR2 RotationMapR2::Transpose() const	// Returns the transpose
+template<class T> inline RotationMapR2T<T> RotationMapR2T<T>::Transpose() const	// Returns the transpose
 {
-	return ( RotationMapR2( m11, m12,
+	return ( RotationMapR2T<T>( m11, m12,
 							m21, m22 ) );
 }
 
-inline VectorR2 RotationMapR2::Invert(const VectorR2& u) const  // Returns solution
+template<class T> inline VectorR2T<T> RotationMapR2T<T>::Invert(const VectorR2T<T>& u) const  // Returns solution
 {
-	return (VectorR2( m11*u.x + m21*u.y,			// Multiply with Transpose
+	return (VectorR2T<T>( m11*u.x + m21*u.y,			// Multiply with Transpose
 					  m12*u.x + m22*u.y ) );
 }
 
-inline RotationMapR2& RotationMapR2::operator*= (const RotationMapR2& B)  // Matrix product
+template<class T> inline RotationMapR2T<T>& RotationMapR2T<T>::operator*= (const RotationMapR2T<T>& B)  // Matrix product
 {
-	(*this).Matrix2x2::operator*=(B);
+	(*this).Matrix2x2T<T>::operator*=(B);
 
 	return( *this );
 }
 
-inline RotationMapR2 operator* ( const RotationMapR2& A, const RotationMapR2& B)
+template<class T> inline RotationMapR2T<T> operator* ( const RotationMapR2T<T>& A, const RotationMapR2T<T>& B)
 {
-	RotationMapR2 AA(A);
-	AA.Matrix2x2::operator*=(B);
+	RotationMapR2T<T> AA(A);
+	AA.Matrix2x2T<T>::operator*=(B);
 	return AA;
 }
 
@@ -921,38 +988,38 @@ inline RotationMapR2 operator* ( const RotationMapR2& A, const RotationMapR2& B)
 
 // Returns a righthanded orthonormal basis to complement vector  u
 //		The vector u must be unit.
-inline VectorR2 GetOrtho( const VectorR2& u )
+template<class T> inline VectorR2T<T> GetOrtho( const VectorR2T<T>& u )
 {
-	return VectorR2 ( -u.y, u.x );
+	return VectorR2T<T> ( -u.y, u.x );
 }
 
 // Returns the projection of u onto unit v
-inline VectorR2 ProjectToUnit ( const VectorR2& u, const VectorR2& v)
+template<class T> inline VectorR2T<T> ProjectToUnit ( const VectorR2T<T>& u, const VectorR2T<T>& v)
 {
 	return (u^v)*v;
 }
 
 // Returns the projection of u onto the plane perpindicular to the unit vector v
-inline VectorR2 ProjectPerpUnit ( const VectorR2& u, const VectorR2& v)
+template<class T> inline VectorR2T<T> ProjectPerpUnit ( const VectorR2T<T>& u, const VectorR2T<T>& v)
 {
 	return ( u - ((u^v)*v) );
 }
 
 // Returns the projection of u onto the plane perpindicular to the unit vector v
 //    This one is more stable when u and v are nearly equal.
-inline VectorR2 ProjectPerpUnitDiff ( const VectorR2& u, const VectorR2& v)
+template<class T> inline VectorR2T<T> ProjectPerpUnitDiff ( const VectorR2T<T>& u, const VectorR2T<T>& v)
 {
-	VectorR2 ans = u;
+	VectorR2T<T> ans = u;
 	ans -= v;
 	ans -= ((ans^v)*v);
 	return ans;				// ans = (u-v) - ((u-v)^v)*v
 }
 
 // Returns the solid angle between vectors u and v.
-inline double Angle( const VectorR2& u, const VectorR2& v)
+template<class T> inline T Angle( const VectorR2T<T>& u, const VectorR2T<T>& v)
 {
-	double nSqU = u.NormSq();
-	double nSqV = v.NormSq();
+	T nSqU = u.NormSq();
+	T nSqV = v.NormSq();
 	if ( nSqU==0.0 && nSqV==0.0 ) {
 		return (0.0);
 	}
@@ -961,38 +1028,38 @@ inline double Angle( const VectorR2& u, const VectorR2& v)
 	}
 }
 
-inline double AngleUnit( const VectorR2& u, const VectorR2& v )
+template<class T> inline T AngleUnit( const VectorR2T<T>& u, const VectorR2T<T>& v )
 {
 	return ( atan2 ( (ProjectPerpUnit(v,u)).Norm(), u^v ) );
 }
 
-// Projection maps (LinearMapR2's)
+// Projection maps (LinearMapR2T's)
 
 // VectorProjectMap returns map projecting onto a given vector u.
 //		u should be a unit vector (otherwise the returned map is
 //		scaled according to the magnitude of u.
-inline LinearMapR2 VectorProjectMap( const VectorR2& u )
+template<class T> inline LinearMapR2T<T> VectorProjectMap( const VectorR2T<T>& u )
 {
-	double xy = u.x*u.y;
-	return( LinearMapR2( u.x*u.x, xy, xy, u.y*u.y ) ) ;
+	T xy = u.x*u.y;
+	return( LinearMapR2T<T>( u.x*u.x, xy, xy, u.y*u.y ) ) ;
 }
 
 // PlaneProjectMap returns map projecting onto a given plane.
 //		The plane is the plane orthognal to u.
 //		u must be a unit vector (otherwise the returned map is
 //		garbage).
-inline LinearMapR2 PerpProjectMap ( const VectorR2& u )
+template<class T> inline LinearMapR2T<T> PerpProjectMap ( const VectorR2T<T>& u )
 {
-	double nxy = -u.x*u.y;
-	return ( LinearMapR2 ( 1.0-u.x*u.x, nxy, nxy, 1.0-u.y*u.y ) );
+	T nxy = -u.x*u.y;
+	return ( LinearMapR2T<T> ( (T)1.0-u.x*u.x, nxy, nxy, (T)1.0-u.y*u.y ) );
 }
 
 // fromVec and toVec should be unit vectors
-inline RotationMapR2 RotateToMap( const VectorR2& fromVec, const VectorR2& toVec)
+template<class T> inline RotationMapR2T<T> RotateToMap( const VectorR2T<T>& fromVec, const VectorR2T<T>& toVec)
 {
-	double costheta = fromVec.x*toVec.x + fromVec.y*toVec.y;
-	double sintheta = fromVec.x*toVec.y - fromVec.y*toVec.x;
-	return( RotationMapR2( costheta, sintheta, -sintheta, costheta ) );
+	T costheta = fromVec.x*toVec.x + fromVec.y*toVec.y;
+	T sintheta = fromVec.x*toVec.y - fromVec.y*toVec.x;
+	return( RotationMapR2T<T>( costheta, sintheta, -sintheta, costheta ) );
 }
 
 #endif	// LINEAR_R2_H
@@ -0,0 +1,178 @@
+/*
+ * SceneScript.cpp
+ *
+ * A text file of input events and frames, for replaying a scene.
+ * See SceneScript.h.
+ *
+ * Software is "as-is" and carries no warranty.  It may be used without
+ *   restriction, but if you modify it, please change the filenames to
+ *   prevent confusion between different versions.
+ */
+
+#define _CRT_SECURE_NO_WARNINGS				// For fopen and sscanf
+
+#include <GLFW/glfw3.h>						// For the key codes
+
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "SceneScript.h"
+
+static const int MaxRepeatDepth = 8;
+
+SceneScript::SceneScript()
+	: width(800), height(600)
+{
+}
+
+bool SceneScript::Open( const char* name )
+{
+	filename = name;
+	width = 800;
+	height = 600;
+	steps.clear();
+
+	FILE* file = fopen(name, "r");
+	if (file == nullptr) {
+		printf("Could not open %s.\n", name);
+		return false;
+	}
+	std::vector<std::string> lines;
+	char buffer[1024];
+	while (fgets(buffer, sizeof(buffer), file) != nullptr) {
+		char* comment = strchr(buffer, '#');
+		if (comment != nullptr) {
+			*comment = '\0';
+		}
+		lines.push_back(buffer);
+	}
+	fclose(file);
+
+	size_t next = 0;
+	return parse(lines, next, 0, steps);
+}
+
+int SceneScript::NumFrames() const
+{
+	int frames = 0;
+	for (const Step& step : steps) {
+		if (step.command == Frame) {
+			frames += step.count;
+		}
+	}
+	return frames;
+}
+
+// Reads the commands from lines[next] to the end, or to the "end" of a repeat when
+//    depth > 0, into block.
+bool SceneScript::parse( const std::vector<std::string>& lines, size_t& next, int depth, std::vector<Step>& block )
+{
+	for (; next < lines.size(); next++) {
+		size_t line = next;
+		const char* text = lines[line].c_str();
+		char command[32], argument[1024];
+		if (sscanf(text, "%31s", command) != 1) {
+			continue;			// Blank
+		}
+		Step step;
+		step.key = 0;
+		step.x = step.y = 0.0f;
+		step.count = 1;
+		step.tolerance = 0;
+		int numRead;
+		if (strcmp(command, "size") == 0) {
+			if (sscanf(text, "%*s %d %d", &width, &height) != 2 || width <= 0 || height <= 0) {
+				return error(line, "size needs a width and a height");
+			}
+			if (!steps.empty() || !block.empty() || depth > 0) {
+				return error(line, "size must come before the events");
+			}
+			continue;
+		}
+		else if (strcmp(command, "key") == 0) {
+			step.command = Key;
+			if (sscanf(text, "%*s %1023s", argument) != 1) {
+				return error(line, "key needs a key");
+			}
+			if (strcmp(argument, "escape") == 0) {
+				step.key = GLFW_KEY_ESCAPE;
+			}
+			else if (strlen(argument) == 1 && isgraph((unsigned char)argument[0])) {
+				step.key = toupper((unsigned char)argument[0]);		// The key codes of GLFW for printable keys
+			}
+			else {
+				return error(line, "the key is one character or \"escape\"");
+			}
+		}
+		else if (strcmp(command, "click") == 0 || strcmp(command, "drag") == 0 || strcmp(command, "move") == 0) {
+			step.command = (command[0] == 'c') ? Click : (command[0] == 'd') ? Drag : Move;
+			if (sscanf(text, "%*s %f %f", &step.x, &step.y) != 2) {
+				return error(line, "the position needs x and y");
+			}
+		}
+		else if (strcmp(command, "moveby") == 0) {
+			step.command = MoveBy;
+			numRead = sscanf(text, "%*s %f %f %d", &step.x, &step.y, &step.count);
+			if (numRead < 2 || step.count < 0) {
+				return error(line, "moveby needs dx and dy, and a count that is not negative");
+			}
+		}
+		else if (strcmp(command, "release") == 0) {
+			step.command = Release;
+		}
+		else if (strcmp(command, "frame") == 0) {
+			step.command = Frame;
+			numRead = sscanf(text, "%*s %d", &step.count);
+			if (step.count < 0) {
+				return error(line, "the number of frames is negative");
+			}
+		}
+		else if (strcmp(command, "image") == 0) {
+			step.command = Image;
+			numRead = sscanf(text, "%*s %1023s %d", argument, &step.tolerance);
+			if (numRead < 1 || step.tolerance < 0) {
+				return error(line, "image needs a file name, and a tolerance that is not negative");
+			}
+			step.file = argument;
+		}
+		else if (strcmp(command, "repeat") == 0) {
+			int repeats;
+			if (sscanf(text, "%*s %d", &repeats) != 1 || repeats < 0) {
+				return error(line, "repeat needs a count that is not negative");
+			}
+			if (depth == MaxRepeatDepth) {
+				return error(line, "the repeats are nested too deeply");
+			}
+			std::vector<Step> repeated;
+			next++;
+			if (!parse(lines, next, depth + 1, repeated)) {
+				return false;
+			}
+			if (next == lines.size()) {
+				return error(line, "repeat has no end");
+			}
+			for (int k = 0; k < repeats; k++) {
+				block.insert(block.end(), repeated.begin(), repeated.end());
+			}
+			continue;			// next is at the "end"
+		}
+		else if (strcmp(command, "end") == 0) {
+			if (depth == 0) {
+				return error(line, "end without repeat");
+			}
+			return true;
+		}
+		else {
+			return error(line, "unknown command");
+		}
+		block.push_back(step);
+	}
+	return true;
+}
+
+bool SceneScript::error( size_t line, const char* message ) const
+{
+	printf("%s:%d: %s.\n", filename.c_str(), (int)line + 1, message);
+	return false;
+}
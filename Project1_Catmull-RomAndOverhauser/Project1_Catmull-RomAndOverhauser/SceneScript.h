@@ -0,0 +1,74 @@
+/*
+ * SceneScript.h
+ *
+ * A text file of input events and frames, for replaying a scene in the
+ * demo without a window.  Each line is one command; '#' starts a comment.
+ * Positions are in pixels, from the top left corner, like the cursor
+ * positions of GLFW.
+ *
+ *     size width height     The size of the framebuffer (800 600 if not given).
+ *                               Only before the first event.
+ *     key k                 Presses a key: a character, as in "key t" or
+ *                               "key =", or "escape".  "escape" and "x",
+ *                               which close the window, end the replay.
+ *     click x y             Moves the cursor and clicks the left button.
+ *     drag x y              Moves the cursor and presses the right button.
+ *     move x y              Moves the cursor.
+ *     moveby dx dy [n]      Moves the cursor by (dx, dy), n times (default 1).
+ *     release               Releases the right button.
+ *     frame [n]             Draws n frames (default 1).
+ *     image file [tol]      Compares the frame with a PPM image, allowing each
+ *                               color channel to differ by tol (default 0), or
+ *                               writes the image when recording.
+ *     repeat n  ...  end    Repeats the commands between them n times.
+ *
+ * Open() reads the whole file and unrolls the repeats into Steps().
+ *
+ * Software is "as-is" and carries no warranty.  It may be used without
+ *   restriction, but if you modify it, please change the filenames to
+ *   prevent confusion between different versions.
+ */
+
+#ifndef SCENE_SCRIPT_H
+#define SCENE_SCRIPT_H
+
+#include <string>
+#include <vector>
+
+class SceneScript {
+
+public:
+	enum Command { Key, Click, Drag, Move, MoveBy, Release, Frame, Image };
+
+	struct Step {
+		Command command;
+		int key;					// A GLFW key code, for Key
+		float x, y;					// The position, or the move for MoveBy
+		int count;					// Moves of MoveBy, frames of Frame
+		std::string file;			// The image of Image
+		int tolerance;
+	};
+
+public:
+	SceneScript();
+
+	// Reads a script.  Returns false, after printing the line that cannot be read,
+	//    if the file cannot be opened or is not a valid script.
+	bool Open( const char* filename );
+
+	int Width() const { return width; }
+	int Height() const { return height; }
+	const std::vector<Step>& Steps() const { return steps; }
+	int NumFrames() const;
+
+private:
+	bool parse( const std::vector<std::string>& lines, size_t& next, int depth, std::vector<Step>& block );
+	bool error( size_t line, const char* message ) const;
+
+private:
+	std::string filename;
+	int width, height;
+	std::vector<Step> steps;
+};
+
+#endif	// SCENE_SCRIPT_H
@@ -0,0 +1,124 @@
+/*
+ * ThreadPool.cpp
+ *
+ * A fixed set of worker threads for the CatmullRomSpline engine.
+ * See ThreadPool.h.
+ *
+ * Software is "as-is" and carries no warranty.  It may be used without
+ *   restriction, but if you modify it, please change the filenames to
+ *   prevent confusion between different versions.
+ */
+
+#include "ThreadPool.h"
+
+#include <assert.h>
+
+// The range is split into about ChunksPerThread chunks per thread, so that
+//    a thread that finishes early takes some of the work of the others.
+static const int ChunksPerThread = 4;
+
+ThreadPool::ThreadPool( int numThreads )
+	: stopping(false), generation(0), busyWorkers(0),
+	  callTask(nullptr), callFirst(0), callEnd(0), chunkSize(1), numChunks(0), nextChunk(0)
+{
+	assert( numThreads >= 0 );
+	if (numThreads == 0) {
+		numThreads = HardwareThreads();
+	}
+	for (int k = 1; k < numThreads; k++) {
+		workers.push_back(std::thread(&ThreadPool::workerLoop, this));
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	workReady.notify_all();
+	for (size_t k = 0; k < workers.size(); k++) {
+		workers[k].join();
+	}
+}
+
+int ThreadPool::HardwareThreads()
+{
+	int n = (int)std::thread::hardware_concurrency();
+	return (n > 0) ? n : 1;
+}
+
+void ThreadPool::ParallelFor( int first, int end, int minChunk, const std::function<void( int, int )>& task )
+{
+	assert( minChunk > 0 );
+	int count = end - first;
+	if (count <= 0) {
+		return;
+	}
+	int size = (count + ChunksPerThread * NumThreads() - 1) / (ChunksPerThread * NumThreads());
+	size = (size > minChunk) ? size : minChunk;
+	if (workers.empty() || size >= count) {
+		task(first, end);
+		return;
+	}
+
+	std::lock_guard<std::mutex> callLock(callMutex);
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		callTask = &task;
+		callFirst = first;
+		callEnd = end;
+		chunkSize = size;
+		numChunks = (count + size - 1) / size;
+		nextChunk = 0;
+		busyWorkers = (int)workers.size();
+		generation++;
+	}
+	workReady.notify_all();
+
+	runChunks();
+
+	std::unique_lock<std::mutex> lock(mutex);
+	workDone.wait(lock, [this] { return busyWorkers == 0; });
+	callTask = nullptr;
+}
+
+// Runs chunks of the current call until there are none left
+void ThreadPool::runChunks()
+{
+	for (;;) {
+		int k = nextChunk++;
+		if (k >= numChunks) {
+			return;
+		}
+		int chunkFirst = callFirst + k * chunkSize;
+		int chunkEnd = (k + 1 < numChunks) ? chunkFirst + chunkSize : callEnd;
+		(*callTask)(chunkFirst, chunkEnd);
+	}
+}
+
+void ThreadPool::workerLoop()
+{
+	unsigned seen = 0;
+	for (;;) {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			workReady.wait(lock, [this, seen] { return stopping || generation != seen; });
+			if (stopping) {
+				return;
+			}
+			seen = generation;
+		}
+
+		runChunks();
+
+		bool last;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			last = (--busyWorkers == 0);
+		}
+		if (last) {
+			workDone.notify_one();
+		}
+	}
+}
@@ -0,0 +1,67 @@
+/*
+ * ThreadPool.h
+ *
+ * A fixed set of worker threads for the CatmullRomSpline engine.
+ *
+ * ParallelFor splits a range of indices into consecutive chunks and runs a
+ * task on each chunk, on the worker threads and on the calling thread, and
+ * returns when all of the chunks are done.  The chunks do not depend on
+ * which thread runs them, so a task that writes only the entries of its own
+ * chunk gives the same results with any number of threads.
+ *
+ * Software is "as-is" and carries no warranty.  It may be used without
+ *   restriction, but if you modify it, please change the filenames to
+ *   prevent confusion between different versions.
+ */
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool {
+
+public:
+	// numThreads counts the calling thread, so numThreads-1 worker threads are started.
+	//    0 uses one thread per core.
+	explicit ThreadPool( int numThreads );
+	~ThreadPool();
+
+	int NumThreads() const { return (int)workers.size() + 1; }
+
+	// Calls task(first, end) on chunks of [first, end) with at least minChunk indices
+	//    each, except maybe the last, and waits for all of them.  Calls from several
+	//    threads at once are run one after the other.
+	void ParallelFor( int first, int end, int minChunk, const std::function<void( int, int )>& task );
+
+	static int HardwareThreads();		// At least 1
+
+private:
+	ThreadPool( const ThreadPool& ) = delete;
+	ThreadPool& operator=( const ThreadPool& ) = delete;
+
+	void workerLoop();
+	void runChunks();
+
+private:
+	std::vector<std::thread> workers;
+	std::mutex callMutex;				// Held for the whole of a ParallelFor call
+	std::mutex mutex;
+	std::condition_variable workReady;
+	std::condition_variable workDone;
+	bool stopping;
+	unsigned generation;				// Incremented for each ParallelFor call
+	int busyWorkers;					// Workers still running chunks of this call
+
+	// The current call
+	const std::function<void( int, int )>* callTask;
+	int callFirst, callEnd, chunkSize, numChunks;
+	std::atomic<int> nextChunk;
+};
+
+#endif	// THREAD_POOL_H